@@ -0,0 +1,34 @@
+; vectors
+(define v (make-vector 3 0))
+(vector-set! v 1 "one")
+(display v)                       ; #(0 "one" 0)
+(display (vector-length v))       ; 3
+(display (vector-ref v 1))        ; "one"
+(display (vector->list (list->vector (list 1 2 3))))    ; (1 2 3)
+
+; hash tables
+(define table (make-hash-table 'equal))
+(hash-set! table "a" 1)
+(hash-set! table (list 1 2) "list key")
+(display (hash-ref table "a"))                ; 1
+(display (hash-ref table (list 1 2)))         ; "list key"
+(display (hash-ref table "missing" "none"))   ; "none"
+(display (hash-count table))                  ; 2
+(display (hash-contains? table "a"))          ; #t
+(hash-remove! table "a")
+(display (hash-ref table "a" "none"))         ; "none"
+
+; strings
+(define s (string-append "hello" ", " "world"))
+(display s)                               ; "hello, world"
+(display (string-length s))               ; 12
+(display (substring s 7))                 ; "world"
+(display (substring s 0 5))               ; "hello"
+(display (string-contains s "world"))     ; 7
+
+; a string builder appends in place
+(define b (make-string-builder))
+(string-builder-append! b "a" "b")
+(string-builder-append! b "c")
+(display (string-builder-length b))       ; 3
+(display (builder->string b))      ; "abc"
@@ -0,0 +1,13 @@
+(import functools)
+
+; the results of pmap and preduce keep the order of the list, however the chunks are scheduled
+(define range (lambda (from to) (if (< from (- to 1)) (cons from (range (+ from 1) to)) (list from))))
+(define numbers (range 0 100))
+
+(display (functools.pmap (lambda (x) (* x x)) (list 1 2 3)))    ; (1 4 9)
+(display (eq? (functools.pmap (lambda (x) (* x x)) numbers)
+              (functools.map (lambda (x) (* x x)) numbers)))    ; #t
+
+(display (functools.preduce + numbers 0))    ; 4950
+; string-append is associative but not commutative, so the order shows
+(display (functools.preduce string-append (list "a" "b" "c" "d" "e" "f" "g" "h" "i" "j") ""))    ; "abcdefghij"
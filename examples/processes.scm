@@ -0,0 +1,26 @@
+; forked processes talk through their mailboxes
+(define parent (current-pid))
+(define echo (fork (lambda () (send parent (list "got" (receive))))))
+(send echo 1)
+(display (receive))    ; ("got" 1)
+
+; nobody sends anything, so receive gives up after 50 ms
+(display (receive 50))    ; #f
+
+; a message is copied, the receiver's vector is not the sender's
+(define v (make-vector 2 0))
+(define doubler (fork (lambda ()
+                        (define w (receive))
+                        (vector-set! w 0 99)
+                        (send parent w))))
+(send doubler v)
+(display (receive))    ; #(99 0)
+(display v)            ; #(0 0)
+
+; a future runs in a process of its own, touch waits for its value
+(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define f (future (fib 20)))
+(define g (future (fib 15)))
+(display (touch f))    ; 6765
+(display (touch g))    ; 610
+(display (touch f))    ; 6765, a future keeps its value
@@ -0,0 +1,20 @@
+; vectors that contain themselves are compared without walking around the cycle forever
+(define v (make-vector 1 0))
+(vector-set! v 0 v)
+(define w (make-vector 1 0))
+(vector-set! w 0 w)
+
+(display (eq? v w))    ; #t
+
+; a cycle does not make vectors equal that differ elsewhere
+(define x (make-vector 2 0))
+(vector-set! x 0 x)
+(define y (make-vector 2 1))
+(vector-set! y 0 y)
+
+(display (eq? x y))    ; #f
+
+; equal keys of an equal hash table may collide
+(define table (make-hash-table 'equal))
+(hash-set! table v "cycle")
+(display (hash-ref table w))    ; "cycle"
@@ -9,3 +9,13 @@
     (if (pair? l)
       (reduce f (cdr l) (f (car l) init))
       (f (car l) init))))
+
+; f is applied to the elements in parallel, the results keep the order of l
+(define pmap
+  (lambda (f l)
+    (parallel-map f l)))
+
+; f must be associative: (preduce f (list x0 x1 ... xn) init) is (f ... (f (f init x0) x1) ... xn)
+(define preduce
+  (lambda (f l init)
+    (parallel-reduce f l init)))
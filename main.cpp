@@ -2,29 +2,95 @@
 #include "src/Runtime.hpp"
 #include "src/Process.hpp"
 #include "src/ModuleLoader.hpp"
+#include "src/ProgramImage.hpp"
+#include "src/CompileTrace.hpp"
 #include <cstdlib>
+#include <new>
 #include "src/REPL.hpp"
 
 using namespace std;
 
+// counts the allocations for --time-phases, only ./iris replaces the operator new, libiris keeps the default.
+// every form that allocates or frees is replaced, and none is inlined, so that the compiler only ever sees the
+// operator new and operator delete pairs of the standard and not a free of what it takes for a new
+[[gnu::noinline]] void *operator new(size_t size) {
+    if (CompileTrace::timePhases) {
+        CompileTrace::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+[[gnu::noinline]] void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void *ptr) noexcept {
+    ::operator delete(ptr);
+}
+
+[[gnu::noinline]] void operator delete[](void *ptr, size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+const char *USAGE = "usage: iris [--time-phases] [--dump=tokens|ast|il|bytecode]... [path/to/file.scm]";
+
 int main(int argc, const char *argv[]) {
+    utils::isPrintingErrors = true;
+
+    string path;
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument == "--time-phases") {
+            CompileTrace::timePhases = true;
+        } else if (argument.starts_with("--dump=")) {
+            string kind = argument.substr(string("--dump=").size());
+            if (!CompileTrace::DUMPS.count(kind)) {
+                cerr << "unknown dump " << kind << "\n" << USAGE << endl;
+                return 2;
+            }
+            CompileTrace::dumps.insert(kind);
+        } else if (argument.starts_with("--") || !path.empty()) {
+            cerr << "unexpected argument " << argument << "\n" << USAGE << endl;
+            return 2;
+        } else {
+            path = argument;
+        }
+    }
 
     // run script
-    if(argc == 2) {
+    if(!path.empty()) {
         char actualpath[PATH_MAX+1];
-        realpath(argv[1], actualpath);
+        realpath(path.c_str(), actualpath);
 
         Runtime runtime;
 
         // the executable file located in cmake-build-debug
-        Module module = Module::loadModule(actualpath);
-
-        Process process0 = runtime.createProcess(module);
+        // the module, and the nodes of its AST, are dropped once the image is built
+        auto image = make_shared<const ProgramImage>(Module::loadModule(actualpath));
+        if (CompileTrace::timePhases) {
+            CompileTrace::timePhases = false;
+            CompileTrace::report(cerr);
+        }
+        cout.flush();
 
-        runtime.addProcess(process0);
+        auto processPtr = runtime.createProcess(image);
+        runtime.addProcess(processPtr);
         runtime.schedule();
 //    runtime.execute(process0);
-        return 0;
+        // stopped by a resource limit
+        return processPtr->error.empty() ? 0 : 1;
     }
 
     // REPL
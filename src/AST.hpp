@@ -5,14 +5,17 @@
 #ifndef IRIS_AST_HPP
 #define IRIS_AST_HPP
 
-#include "Heap.hpp"
+#include "NodeArena.hpp"
 #include "SourceCodeMapper.hpp"
 
 class AST {
 public:
     AST() {};
 
-    AST(const string &source, string &moduleName, string &path) : source(source), moduleName(moduleName) {
+    // the ids of the nodes start at firstNodeId, see Module::nextNodeId
+    AST(const string &source, string &moduleName, string &path, NodeId firstNodeId = 0) : nodes(firstNodeId),
+                                                                                          moduleName(moduleName),
+                                                                                          source(source) {
         this->sourceCodeMapper.addModule(moduleName, source, path);
     };
 
@@ -20,12 +23,12 @@ public:
 //    AST(const AST &ast);
 
 
-    Heap heap;
+    NodeArena nodes;
     string moduleName;
     string source;
     map<Handle, int> handleSourceIndexesMap;
     map<string, string> moduleAliasPathMap;
-    map<string, string> natives; // Not supported yet
+    map<string, string> natives; // namespace -> enabled, see NativeRegistry
     map<string, string> varUniqueOriginNameMap;
     // Fort the definedVar Origin Name is unique, but for other variables,
     // origin name could be duplicated, and this is exactly why we need unique name
@@ -34,9 +37,9 @@ public:
     vector<Handle> tailcalls;
     SourceCodeMapper sourceCodeMapper;
 
-    Handle getTopApplicationHandle();
+    Handle getTopApplicationHandle() const;
 
-    Handle getTopLambdaHandle();
+    Handle getTopLambdaHandle() const;
 
     vector<Handle> getLambdaHandles();
 
@@ -46,7 +49,7 @@ public:
 
     void mergeAST(AST anotherAST);
 
-    shared_ptr<IrisObject> get(Handle handle);
+    shared_ptr<IrisObject> get(const Handle &handle);
 
     bool isNativeCall(string nativeCall);
 
@@ -64,11 +67,11 @@ public:
 
     void deleteHandle(HandleOrStr hos);
 
-    Handle makeString(string prefix, Handle parentHandle);
+    Handle makeString(string prefix, Handle parentHandle, string content);
 };
 
 Handle AST::makeLambda(string prefix, Handle parentHandle) {
-    Handle lambdaHandle = this->heap.makeLambda(prefix, parentHandle);
+    Handle lambdaHandle = this->nodes.makeLambda(prefix, parentHandle);
     this->addLambdaHandle(lambdaHandle);
     this->setHandleSourceIndexMapping(lambdaHandle, this->sourceCodeMapper.getIndex(parentHandle));
 
@@ -76,21 +79,21 @@ Handle AST::makeLambda(string prefix, Handle parentHandle) {
 }
 
 Handle AST::makeApplication(string prefix, Handle parentHandle) {
-    Handle applicationHandle = this->heap.makeApplication(prefix, parentHandle);
+    Handle applicationHandle = this->nodes.makeApplication(prefix, parentHandle);
     this->setHandleSourceIndexMapping(applicationHandle, this->sourceCodeMapper.getIndex(parentHandle));
 
     return applicationHandle;
 }
 
 Handle AST::makeQuote(string prefix, Handle parentHandle) {
-    Handle quoteHandle = this->heap.makeQuote(prefix, parentHandle);
+    Handle quoteHandle = this->nodes.makeQuote(prefix, parentHandle);
     this->setHandleSourceIndexMapping(quoteHandle, this->sourceCodeMapper.getIndex(parentHandle));
 
     return quoteHandle;
 }
 
-Handle AST::makeString(string prefix, Handle parentHandle) {
-    Handle stringHandle = this->heap.makeString(prefix, parentHandle);
+Handle AST::makeString(string prefix, Handle parentHandle, string content) {
+    Handle stringHandle = this->nodes.makeString(prefix, content);
     this->setHandleSourceIndexMapping(stringHandle, this->sourceCodeMapper.getIndex(parentHandle));
 
     return stringHandle;
@@ -99,14 +102,14 @@ Handle AST::makeString(string prefix, Handle parentHandle) {
 void AST::deleteHandleRecursivly(HandleOrStr hos) {
     try {
         if(typeOfStr(hos) == Type::HANDLE) {
-            if(this->heap.hasHandle(hos)) {
+            if(this->nodes.hasHandle(hos)) {
                 auto childrenHoses = IrisObject::getChildrenHosesOrBodies(this->get(hos));
                 for (auto hos : childrenHoses) {
                     this->deleteHandleRecursivly(hos);
                 }
                 // make sure hos still havn't deleted
-                if(this->heap.hasHandle(hos)) {
-                    this->heap.deleteHandle(hos);
+                if(this->nodes.hasHandle(hos)) {
+                    this->nodes.deleteHandle(hos);
                 }
             }
         }
@@ -117,8 +120,8 @@ void AST::deleteHandleRecursivly(HandleOrStr hos) {
 
 void AST::deleteHandle(HandleOrStr hos) {
     if(typeOfStr(hos) == Type::HANDLE) {
-        if(this->heap.hasHandle(hos)) {
-            this->heap.deleteHandle(hos);
+        if(this->nodes.hasHandle(hos)) {
+            this->nodes.deleteHandle(hos);
         }
     }
 }
@@ -129,22 +132,18 @@ void AST::setHandleSourceIndexMapping(Handle handle, int index) {
 }
 
 
-shared_ptr<IrisObject> AST::get(Handle handle) {
-    try {
-        return this->heap.get(handle);
-    } catch (exception &e){
-        throw e;
-    }
+shared_ptr<IrisObject> AST::get(const Handle &handle) {
+    return this->nodes.get(handle);
 }
 
-Handle AST::getTopApplicationHandle() {
+Handle AST::getTopApplicationHandle() const {
     // ((lambda () " + code + "))
     // the first sList
     Handle topApplicationHandle;
-    for (auto &[handle, schemeObjPtr] : this->heap.dataMap) {
-        if (schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION &&
-            static_pointer_cast<ApplicationObject>(schemeObjPtr)->parentHandle == TOP_NODE_HANDLE) {
-            topApplicationHandle = handle;
+    for (auto &nodePtr : this->nodes.getNodes()) {
+        if (nodePtr != nullptr && nodePtr->irisObjectType == IrisObjectType::APPLICATION &&
+            nodePtr->parentHandle == TOP_NODE_HANDLE) {
+            topApplicationHandle = nodePtr->selfHandle;
             break;
         }
     }
@@ -155,17 +154,17 @@ Handle AST::getTopApplicationHandle() {
 }
 
 
-Handle AST::getTopLambdaHandle() {
+Handle AST::getTopLambdaHandle() const {
     // ((lambda () " + code + "))
     // return the first lambda, which is the top lambda
-    auto topAppObjPtr = static_pointer_cast<ApplicationObject>(this->heap.get(this->getTopApplicationHandle()));
+    auto topAppObjPtr = static_pointer_cast<ApplicationObject>(this->nodes.get(this->getTopApplicationHandle()));
     return topAppObjPtr->childrenHoses[0];
 }
 
 vector<HandleOrStr> AST::getTopLambdaBodies() {
     // return by value !!!!!!!!!!!!!!
     Handle topLambdaHandle = this->getTopLambdaHandle();
-    auto topLambdaObjptr = static_pointer_cast<LambdaObject>(this->heap.get(topLambdaHandle));
+    auto topLambdaObjptr = static_pointer_cast<LambdaObject>(this->nodes.get(topLambdaHandle));
     return topLambdaObjptr->bodies;
 }
 
@@ -193,27 +192,29 @@ void AST::mergeAST(AST anotherAST) {
     Handle anotherTopApplicationHandle = anotherAST.getTopApplicationHandle();
     vector<HandleOrStr> anotherTopLambdaBodies = anotherAST.getTopLambdaBodies();
 
-    // merge heap
-    for (auto &[handle, schemeObjPtr] : anotherAST.heap.dataMap) {
-        this->heap.set(handle, schemeObjPtr);
+    // merge the nodes
+    for (auto &nodePtr : anotherAST.nodes.getNodes()) {
+        if (nodePtr != nullptr) {
+            this->nodes.set(nodePtr->selfHandle, nodePtr);
+        }
     }
 
     // append the thisTopLambdaBodies to the otherTopLambdaBodies
     anotherTopLambdaBodies.insert(anotherTopLambdaBodies.end(), thisTopLambdaBodies.begin(), thisTopLambdaBodies.end());
 
-    auto thisTopLambdaObjPtr = static_pointer_cast<LambdaObject>(this->heap.get(thisTopLambdaHandle));
+    auto thisTopLambdaObjPtr = static_pointer_cast<LambdaObject>(this->nodes.get(thisTopLambdaHandle));
     thisTopLambdaObjPtr->setBodies(anotherTopLambdaBodies);
 
     // Now we have, this ((lambda () (this bodies + anthoer bodies))
     // Then we need to change other's bodies' handles' parentHandle to thisLambda
     for (auto &handle : anotherTopLambdaBodies) {
         // only handle exists in the bodies
-        this->heap.get(handle)->parentHandle = thisTopLambdaHandle;
+        this->nodes.get(handle)->parentHandle = thisTopLambdaHandle;
     }
 
     // we add them to the heap of thisAST
-    this->heap.deleteHandle(anotherTopLambdaHandle);
-    this->heap.deleteHandle(anotherTopApplicationHandle);
+    this->nodes.deleteHandle(anotherTopLambdaHandle);
+    this->nodes.deleteHandle(anotherTopApplicationHandle);
 
     // the heap have been merge, but not the other fields of ast
     // merge each field one by one
@@ -258,9 +259,9 @@ void AST::mergeAST(AST anotherAST) {
 
 vector<Handle> AST::getLambdaHandles() {
     vector<Handle> lambdaHandles;
-    for (auto &[handle, schemeObjPtr] : this->heap.dataMap) {
-        if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
-            lambdaHandles.push_back(handle);
+    for (auto &nodePtr : this->nodes.getNodes()) {
+        if (nodePtr != nullptr && nodePtr->irisObjectType == IrisObjectType::LAMBDA) {
+            lambdaHandles.push_back(nodePtr->selfHandle);
         }
     }
     this->lambdaHandles = lambdaHandles;
@@ -269,8 +270,10 @@ vector<Handle> AST::getLambdaHandles() {
 
 vector<Handle> AST::getHandles() {
     vector<Handle> result;
-    for (auto &[handle, _] : this->heap.dataMap) {
-        result.push_back(handle);
+    for (auto &nodePtr : this->nodes.getNodes()) {
+        if (nodePtr != nullptr) {
+            result.push_back(nodePtr->selfHandle);
+        }
     }
     return result;
 }
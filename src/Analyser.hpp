@@ -9,61 +9,56 @@
 #include "Parser.hpp"
 #include "Utils.hpp"
 #include "Transfer.hpp"
+#include "CompileTrace.hpp"
 #include <map>
 #include <set>
 
 string ANALYZER_PREFIX = "_!!!analyzer_prefix!!!_";
 string ANALYZER_PREFIX_TITLE = "Analyzer Error";
 
+// the variables a lambda binds: its parameters, and what is defined in its body outside of nested lambdas
 class Scope {
 public:
-    Handle parentHandle;
-    vector<HandleOrStr> children;
+    Handle lambdaHandle;
     set<string> boundVariables;
 
-    explicit Scope(const Handle &parentHandle) : parentHandle(parentHandle) {
-        this->parentHandle = parentHandle;
-    }
-
-    Scope() {
-        this->parentHandle = "";
-    }
-
-    void addChild(HandleOrStr child);
+    explicit Scope(const Handle &lambdaHandle) : lambdaHandle(lambdaHandle) {};
 
-    void addBoundVariables(string var);
+    void addBoundVariables(const string &var);
 
-    bool hasVariable(string var);
+    bool hasVariable(const string &var) const;
 };
 
-void Scope::addChild(HandleOrStr child) {
-    this->children.push_back(child);
-}
-
-void Scope::addBoundVariables(string var) {
-    if (!this->hasVariable(var)) {
-        this->boundVariables.insert(var);
-    }
+void Scope::addBoundVariables(const string &var) {
+    this->boundVariables.insert(var);
 }
 
-bool Scope::hasVariable(string var) {
+bool Scope::hasVariable(const string &var) const {
     return this->boundVariables.count(var);
 }
 
 
 class Analyser {
 public:
-    map<Handle, Scope> scopes;
     AST ast;
+    // the scopes of the lambdas the analysis is inside, the innermost last
+    vector<Scope> scopeStack;
+    Handle topLambdaHandle;
 
     Analyser(AST &ast) : ast(ast) {};
 
-    string searchVariableLambdaHandle(string var, Handle fromHandle);
-
-    Handle getParentLambdaHandle(Handle fromHandle);
+    // the innermost lambda that binds var, "" when none does
+    Handle searchVariableLambdaHandle(const string &var) const;
 
     void scopeAnalyse();
 
+    void analyseNode(const Handle &handle);
+
+    void analyseLambda(const Handle &lambdaHandle, const shared_ptr<LambdaObject> &lambdaObjPtr);
+
+    // adds the variables defined under the children of objPtr to scope, without going into lambdas
+    void collectDefinedVariables(const shared_ptr<IrisObject> &objPtr, Scope &scope);
+
     string makeUniqueVariableName(Handle parentLambdaHandle, string variable);
 
     bool isNativeOrImportVariable(string variable);
@@ -78,17 +73,11 @@ public:
 
 };
 
-// from this handle, find the lambda that has bounded this variable
-Handle Analyser::searchVariableLambdaHandle(string var, Handle fromHandle) {
-    Handle currentHandle = fromHandle;
-    while (currentHandle != TOP_NODE_HANDLE) {
-        auto schemeObjPtr = this->ast.get(currentHandle);
-        if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
-            if (this->scopes[currentHandle].hasVariable(var)) {
-                return currentHandle;
-            }
+Handle Analyser::searchVariableLambdaHandle(const string &var) const {
+    for (auto it = this->scopeStack.rbegin(); it != this->scopeStack.rend(); ++it) {
+        if (it->hasVariable(var)) {
+            return it->lambdaHandle;
         }
-        currentHandle = schemeObjPtr->parentHandle;
     }
     return "";
 }
@@ -97,19 +86,6 @@ string Analyser::makeUniqueVariableName(Handle parentLambdaHandle, string variab
     return parentLambdaHandle.substr(1, parentLambdaHandle.size()) + "." + variable;
 }
 
-// from this lambda handle, find the parent_lambda_handle
-Handle Analyser::getParentLambdaHandle(Handle fromHandle) {
-    Handle currentHandle = fromHandle;
-    while (currentHandle != TOP_NODE_HANDLE) {
-        auto schemeObjPtr = this->ast.heap.get(currentHandle);
-        if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
-            return currentHandle;
-        }
-        currentHandle = schemeObjPtr->parentHandle;
-    }
-    return "";
-}
-
 bool Analyser::isNativeOrImportVariable(string variable) {
     vector<string> fields;
     boost::split(fields, variable, boost::is_any_of("."));
@@ -128,150 +104,146 @@ bool Analyser::isNativeOrImportVariable(string variable) {
 // some.module.name.lambda1.x and some.module.name.lambda12.k
 // noted that k is defined somewhere else, so we need to track the scope of each variable to
 // make sure the name changing is correct
+// one pre-order walk from the top: entering a lambda pushes its scope, complete with the variables defined
+// further down in its body, so every variable met on the way is resolved against scopeStack at once
 // KEEP IN MIND !!!!!!!!!! ONLY LAMBDA AND APPLICATION HAS VARIABLE
 void Analyser::scopeAnalyse() {
-    Handle topLambdaHandle = this->ast.getTopLambdaHandle();
+    this->topLambdaHandle = this->ast.getTopLambdaHandle();
+    this->analyseNode(this->ast.getTopApplicationHandle());
+}
 
-    // init scopes, each lambda handle responses to one scope
-    for (auto lambdaHandle : this->ast.getLambdaHandles()) {
-        Scope scope;
-        scopes[lambdaHandle] = scope;
+void Analyser::analyseNode(const Handle &handle) {
+    shared_ptr<IrisObject> schemeObjPtr = this->ast.get(handle);
+
+    if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
+        this->analyseLambda(handle, static_pointer_cast<LambdaObject>(schemeObjPtr));
+        return;
+    } else if (schemeObjPtr->irisObjectType != IrisObjectType::APPLICATION &&
+               schemeObjPtr->irisObjectType != IrisObjectType::UNQUOTE &&
+               schemeObjPtr->irisObjectType != IrisObjectType::QUASIQUOTE &&
+               schemeObjPtr->irisObjectType != IrisObjectType::QUOTE) {
+        return;
     }
 
-    // 1. init the scopes, scope's parent and children
-    // 2. put the defined variable to its corresponding scope
-    for (auto handle : this->ast.getHandles()) {
-        shared_ptr<IrisObject> schemeObjPtr = this->ast.get(handle);
-
-        // init the scope for each lambda
-        if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
-            Handle parentHandle = getParentLambdaHandle(handle);
-            // not the top lambda
-            if (!parentHandle.empty()) {
-                this->scopes[handle].parentHandle = parentHandle;
-                this->scopes[parentHandle].addChild(handle);
-            } else {
-                scopes[handle].parentHandle = TOP_NODE_HANDLE;
-            }
-            // add the parameters to the lambda bounded variables set
-            for (string parameter : static_pointer_cast<LambdaObject>(schemeObjPtr)->parameters) {
-                scopes[handle].boundVariables.insert(parameter);
-            }
-        } else if (schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION) {
-            auto applicationObjPtr = static_pointer_cast<ApplicationObject>(schemeObjPtr);
-            if (applicationObjPtr->childrenHoses[0] == "define" || applicationObjPtr->childrenHoses[0] == "class") {
-                // define will init variable, therefore, here, we can find out some of the scope of variables
-                // class is actually a define. Usually we have (class apple xxx), and it is equivalent to (define apple xxx)
-                Handle parentLambdaHandle = getParentLambdaHandle(handle);
-
-                // code is like ( (lambda () (define xxxx xxx) ))
-                // therefore, parentHandle always is not ""
-                if (parentLambdaHandle != "") {
-                    string variable = applicationObjPtr->childrenHoses[1];
-                    scopes[parentLambdaHandle].addBoundVariables(variable);
+    auto &childrenHoses = IrisObject::getChildrenHosesOrBodies(schemeObjPtr);
+
+    // change the variable name in application, unquote and quasiquote, the children of a quote are kept
+    // firstly, pass some special APPLICATION!o!
+    if (schemeObjPtr->irisObjectType != IrisObjectType::QUOTE && !childrenHoses.empty() &&
+        childrenHoses[0] != "native" && childrenHoses[0] != "import") {
+
+        for (HandleOrStr &hos : childrenHoses) {
+            if (typeOfStr(hos) == Type::VARIABLE) {
+                // find the bounded lambda
+                Handle boundLambdaHandle = this->searchVariableLambdaHandle(hos);
+
+                if (boundLambdaHandle.empty()) {
+                    if (!this->isNativeOrImportVariable(hos)) {
+                        string errorMessage = utils::createVariableUndefinedMessage(hos);
+                        utils::raiseError(ast, schemeObjPtr->selfHandle, errorMessage, ANALYZER_PREFIX_TITLE);
+                    }
                 } else {
-                    throw std::runtime_error(
-                            "[scope analysis] error in 'define', where " + handle + "doesn't have parent lambda ");
+                    string uniqueName = this->makeUniqueVariableName(boundLambdaHandle, hos);
+                    string originName = hos;
+                    hos = uniqueName;
+                    this->ast.varUniqueOriginNameMap[uniqueName] = originName;
                 }
             }
         }
-    }
-
-
-    //change the name of all variable
-    for (auto &handle : this->ast.getHandles()) {
-        shared_ptr<IrisObject> schemeObjPtr = this->ast.get(handle);
 
-        if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
-            auto lambdaObjPtr = static_pointer_cast<LambdaObject>(schemeObjPtr);
+        // finally, set the definedVarUniqueOriginNameMap,
+        // Because the name of the defined variable has been changed
+        if (childrenHoses[0] == "define" && schemeObjPtr->parentHandle == this->topLambdaHandle) {
+            string uniqueName = childrenHoses[1];
+            string originName = this->ast.varUniqueOriginNameMap[uniqueName];
 
-            //change the parameter names for lambda
-            //(lambda (x y) (+ x y)) => (lambda (utils.lambda12.x , utils.lambda12.y) (+ x y))
-            for (string &parameter : lambdaObjPtr->parameters) {
-                string uniqueName = this->makeUniqueVariableName(handle, parameter);
-                string originName = parameter;
-                parameter = uniqueName;
-
-                // TODO: Do I need to make a deep copy here??
-                this->ast.varUniqueOriginNameMap[uniqueName] = originName;
-            }
-
-            //handle the variable directly exists in lambda
-            //(lambda (k) *k*) => (lambda (k) (utils.lambda12.k))
-            for (HandleOrStr &body : lambdaObjPtr->bodies) {
-                if (typeOfStr(body) == Type::VARIABLE) {
-                    // TODO handle body is not defined
-                    Handle boundLambdaHandle = this->searchVariableLambdaHandle(body, handle);
-                    //Can't find the lambda which bounds this variable
-                    //Variable is not defined or is defined in other module (Utils.max_number)
-                    if (boundLambdaHandle.empty()) {
-                        if (!this->isNativeOrImportVariable(body)) {
-                            throw std::runtime_error("[scope analysis] variable " + body + " is not defined");
-                        }
-                    } else {
-                        string uniqueName = this->makeUniqueVariableName(boundLambdaHandle, body);
-                        string originName = body;
-                        body = uniqueName;
-
-                        this->ast.varUniqueOriginNameMap[uniqueName] = originName;
-                    }
-                }
+            if (this->ast.definedVarOriginUniqueNameMap.count(originName)) {
+                string errorMessage = utils::createRepeatedDefinitionMessage(originName);
+                utils::raiseError(ast, schemeObjPtr->selfHandle, errorMessage, ANALYZER_PREFIX_TITLE);
+                throw std::runtime_error("[scope analysis] define variable " + originName + " repeatedly");
+            } else {
+                this->ast.definedVarOriginUniqueNameMap[originName] = uniqueName;
             }
+        }
+    }
 
-        } else if (schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION ||
-                   schemeObjPtr->irisObjectType == IrisObjectType::UNQUOTE ||
-                   schemeObjPtr->irisObjectType == IrisObjectType::QUASIQUOTE) {
+    // a handle is told by its first character, without going through typeOfStr
+    for (int i = 0; i < childrenHoses.size(); ++i) {
+        if (!childrenHoses[i].empty() && childrenHoses[i][0] == '&') {
+            this->analyseNode(childrenHoses[i]);
+        }
+    }
+}
 
-            auto &childrenHoses = IrisObject::getChildrenHosesOrBodies(schemeObjPtr);
-            Handle parentHandle = schemeObjPtr->parentHandle;
+void Analyser::analyseLambda(const Handle &lambdaHandle, const shared_ptr<LambdaObject> &lambdaObjPtr) {
+    // the scope is complete before the body is walked, a variable may be used above its define
+    Scope scope(lambdaHandle);
+    for (const string &parameter : lambdaObjPtr->parameters) {
+        scope.addBoundVariables(parameter);
+    }
+    this->collectDefinedVariables(lambdaObjPtr, scope);
+    this->scopeStack.push_back(std::move(scope));
 
-            // change the variable name in application, unquote and quasiquote
-            // firstly, pass some special APPLICATION!o!
-            if (childrenHoses.empty() || childrenHoses[0] == "native" || childrenHoses[0] == "import") {
-                continue;
-            }
+    //change the parameter names for lambda
+    //(lambda (x y) (+ x y)) => (lambda (utils.lambda12.x , utils.lambda12.y) (+ x y))
+    for (string &parameter : lambdaObjPtr->parameters) {
+        string uniqueName = this->makeUniqueVariableName(lambdaHandle, parameter);
+        string originName = parameter;
+        parameter = uniqueName;
 
-            for (HandleOrStr &hos : childrenHoses) {
-                if (typeOfStr(hos) == Type::VARIABLE) {
-                    // find the bounded lambda
-                    Handle boundLambdaHandle;
-                    try {
-                        boundLambdaHandle = this->searchVariableLambdaHandle(hos, handle);
-                    } catch (exception &e) {
-                        auto objPtr = static_pointer_cast<ApplicationObject>(ast.get(handle));
-                        utils::raiseError(ast, handle, "hos " + hos + "'s parent Handle " + handle + " not found",
-                                          ANALYZER_PREFIX);
-                    }
+        this->ast.varUniqueOriginNameMap[uniqueName] = originName;
+    }
 
-                    if (boundLambdaHandle.empty()) {
-                        if (!this->isNativeOrImportVariable(hos)) {
-                            string errorMessage = utils::createVariableUndefinedMessage(hos);
-                            utils::raiseError(ast, schemeObjPtr->selfHandle, errorMessage, ANALYZER_PREFIX_TITLE);
-                        }
-                    } else {
-                        string uniqueName = this->makeUniqueVariableName(boundLambdaHandle, hos);
-                        string originName = hos;
-                        hos = uniqueName;
-                        this->ast.varUniqueOriginNameMap[uniqueName] = originName;
-                    }
+    //handle the variable directly exists in lambda
+    //(lambda (k) *k*) => (lambda (k) (utils.lambda12.k))
+    for (int i = 0; i < lambdaObjPtr->bodies.size(); ++i) {
+        HandleOrStr &body = lambdaObjPtr->bodies[i];
+        Type bodyType = typeOfStr(body);
+        if (bodyType == Type::VARIABLE) {
+            Handle boundLambdaHandle = this->searchVariableLambdaHandle(body);
+            //Can't find the lambda which bounds this variable
+            //Variable is not defined or is defined in other module (Utils.max_number)
+            if (boundLambdaHandle.empty()) {
+                if (!this->isNativeOrImportVariable(body)) {
+                    throw std::runtime_error("[scope analysis] variable " + body + " is not defined");
                 }
+            } else {
+                string uniqueName = this->makeUniqueVariableName(boundLambdaHandle, body);
+                string originName = body;
+                body = uniqueName;
+
+                this->ast.varUniqueOriginNameMap[uniqueName] = originName;
             }
+        } else if (bodyType == Type::HANDLE) {
+            this->analyseNode(body);
+        }
+    }
 
-            // finally, set the definedVarUniqueOriginNameMap,
-            // Because the name of the defined variable has been changed
-            if (childrenHoses[0] == "define" && parentHandle == this->ast.getTopLambdaHandle()) {
-                string uniqueName = childrenHoses[1];
-                string originName = this->ast.varUniqueOriginNameMap[uniqueName];
+    this->scopeStack.pop_back();
+}
 
-                if (this->ast.definedVarOriginUniqueNameMap.count(originName)) {
-                    string errorMessage = utils::createRepeatedDefinitionMessage(originName);
-                    utils::raiseError(ast, schemeObjPtr->selfHandle, errorMessage, ANALYZER_PREFIX_TITLE);
-                    throw std::runtime_error("[scope analysis] define variable " + originName + " repeatedly");
-                } else {
-                    this->ast.definedVarOriginUniqueNameMap[originName] = uniqueName;
-                }
+void Analyser::collectDefinedVariables(const shared_ptr<IrisObject> &objPtr, Scope &scope) {
+    for (auto &hos : IrisObject::getChildrenHosesOrBodies(objPtr)) {
+        if (hos.empty() || hos[0] != '&') {
+            continue;
+        }
+        auto childObjPtr = this->ast.get(hos);
+        if (childObjPtr->irisObjectType == IrisObjectType::LAMBDA) {
+            // a nested lambda has a scope of its own
+            continue;
+        } else if (childObjPtr->irisObjectType == IrisObjectType::APPLICATION) {
+            // define will init variable, therefore, here, we can find out some of the scope of variables
+            // class is actually a define. Usually we have (class apple xxx), and it is equivalent to (define apple xxx)
+            auto &childrenHoses = static_pointer_cast<ApplicationObject>(childObjPtr)->childrenHoses;
+            if (childrenHoses.size() >= 2 && (childrenHoses[0] == "define" || childrenHoses[0] == "class")) {
+                scope.addBoundVariables(childrenHoses[1]);
             }
+        } else if (childObjPtr->irisObjectType != IrisObjectType::UNQUOTE &&
+                   childObjPtr->irisObjectType != IrisObjectType::QUASIQUOTE &&
+                   childObjPtr->irisObjectType != IrisObjectType::QUOTE) {
+            continue;
         }
+        this->collectDefinedVariables(childObjPtr, scope);
     }
 }
 
@@ -295,8 +267,15 @@ void Analyser::emptyApplicationDetection(AST &ast) {
 }
 
 AST Analyser::analyse(AST ast) {
-    Analyser::emptyApplicationDetection(ast);
-    Transfer::transfer(ast);
+    {
+        CompileTrace::Phase phase(ast.moduleName, "analyse");
+        Analyser::emptyApplicationDetection(ast);
+    }
+    {
+        CompileTrace::Phase phase(ast.moduleName, "transfer");
+        Transfer::transfer(ast);
+    }
+    CompileTrace::Phase phase(ast.moduleName, "analyse");
     Analyser analyser(ast);
     analyser.scopeAnalyse();
     // TODO: tail call analyse
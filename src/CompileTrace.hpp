@@ -0,0 +1,120 @@
+//
+// CompileTrace: the time and the allocations of each phase of the compiler, and what the phases make
+//
+
+#ifndef TYPED_SCHEME_COMPILETRACE_HPP
+#define TYPED_SCHEME_COMPILETRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// set by the options of ./iris, see main.cpp. all off by default, libiris and the REPL compile without a trace
+// the compiler runs on one thread, the records are not locked
+class CompileTrace {
+public:
+    // in the order they run, lex to transfer for each module, merge to link once for the program
+    inline static const vector<string> PHASES = {"lex", "parse", "analyse", "transfer", "merge", "compile", "link"};
+
+    // tokens and ast for each module, il and bytecode for the program
+    inline static const set<string> DUMPS = {"tokens", "ast", "il", "bytecode"};
+
+    inline static bool timePhases = false;
+
+    // the DUMPS written to cout
+    inline static set<string> dumps;
+
+    // counted by the operator new of ./iris while timePhases is set, it stays 0 in libiris
+    inline static std::atomic<uint64_t> allocationCount{0};
+
+    static bool isDumping(const string &kind) { return CompileTrace::dumps.count(kind); };
+
+    // times a phase of a module from construction to destruction. a phase run in several pieces adds them up
+    class Phase {
+    public:
+        Phase(string moduleName, string phaseName);
+
+        ~Phase();
+
+        Phase(const Phase &) = delete;
+
+        Phase &operator=(const Phase &) = delete;
+
+    private:
+        string moduleName;
+        string phaseName;
+        std::chrono::steady_clock::time_point start;
+        uint64_t startAllocationCount = 0;
+    };
+
+    // a row for each phase of each module, the modules in the order they were first timed
+    static void report(std::ostream &os);
+
+private:
+    struct Record {
+        double milliseconds = 0;
+        uint64_t allocationCount = 0;
+    };
+
+    inline static vector<string> moduleNames;
+    // module name -> phase name -> record
+    inline static map<string, map<string, Record>> records;
+};
+
+CompileTrace::Phase::Phase(string moduleName, string phaseName) : moduleName(std::move(moduleName)),
+                                                                  phaseName(std::move(phaseName)) {
+    if (CompileTrace::timePhases) {
+        this->startAllocationCount = CompileTrace::allocationCount.load(std::memory_order_relaxed);
+        this->start = std::chrono::steady_clock::now();
+    }
+}
+
+CompileTrace::Phase::~Phase() {
+    if (!CompileTrace::timePhases) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    uint64_t endAllocationCount = CompileTrace::allocationCount.load(std::memory_order_relaxed);
+
+    if (!CompileTrace::records.count(this->moduleName)) {
+        CompileTrace::moduleNames.push_back(this->moduleName);
+    }
+    Record &record = CompileTrace::records[this->moduleName][this->phaseName];
+    record.milliseconds += std::chrono::duration<double, std::milli>(end - this->start).count();
+    record.allocationCount += endAllocationCount - this->startAllocationCount;
+}
+
+void CompileTrace::report(std::ostream &os) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-24s %-10s %12s %14s\n", "module", "phase", "ms", "allocations");
+    os << line;
+
+    Record total;
+    for (auto &moduleName : CompileTrace::moduleNames) {
+        auto &phaseRecords = CompileTrace::records[moduleName];
+        for (auto &phaseName : CompileTrace::PHASES) {
+            auto it = phaseRecords.find(phaseName);
+            if (it == phaseRecords.end()) {
+                continue;
+            }
+            std::snprintf(line, sizeof(line), "%-24s %-10s %12.3f %14llu\n", moduleName.c_str(), phaseName.c_str(),
+                          it->second.milliseconds, (unsigned long long) it->second.allocationCount);
+            os << line;
+            total.milliseconds += it->second.milliseconds;
+            total.allocationCount += it->second.allocationCount;
+        }
+    }
+    std::snprintf(line, sizeof(line), "%-24s %-10s %12.3f %14llu\n", "total", "", total.milliseconds,
+                  (unsigned long long) total.allocationCount);
+    os << line;
+}
+
+#endif //TYPED_SCHEME_COMPILETRACE_HPP
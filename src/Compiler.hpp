@@ -136,15 +136,13 @@ void Compiler::handleArbitraryFunction(int j, const Handle &lambdaHandle) {
     auto lambdaObjPtr = static_pointer_cast<LambdaObject>(this->ast.get(lambdaHandle));
     if (j + 1 != lambdaObjPtr->parameters.size() - 1) {
         if (j + 1 < lambdaObjPtr->parameters.size() - 1) {
-            this->createErrorMessage(
+            throw utils::ScriptError(this->createErrorMessage(
                     "When using arbitrary arguments function, only one argument can be put after '.'.",
-                    lambdaHandle);
-            throw std::runtime_error("");
+                    lambdaHandle));
         } else if (j + 1 > lambdaObjPtr->parameters.size() - 1) {
-            this->createErrorMessage(
+            throw utils::ScriptError(this->createErrorMessage(
                     "When using arbitrary arguments function, one argument should be put after '.'.",
-                    lambdaHandle);
-            throw std::runtime_error("");
+                    lambdaHandle));
         }
     }
 }
@@ -237,13 +235,15 @@ void Compiler::compileApplication(Handle handle) {
                 }
                 this->addInstruction(first);
             }
+        } else if (firstType == Type::VARIABLE && this->ast.isNativeCall(first)) {
+            // a native returns to the caller's code, even in a tail position
+            this->addInstruction("native " + first);
         } else if (std::find(this->ast.tailcalls.begin(), this->ast.tailcalls.end(), handle) !=
                    this->ast.tailcalls.end()) {
             // we don't has tailcalls right now
             if (firstType == Type::HANDLE && this->ast.get(first)->irisObjectType == IrisObjectType::LAMBDA) {
                 this->addInstruction("tailcall " + first);
             } else if (firstType == Type::VARIABLE) {
-                // include native
                 this->addInstruction("tailcall " + first);
             } else {
                 throw std::runtime_error("[compileApplication] the first argument is not callable.");
@@ -253,7 +253,6 @@ void Compiler::compileApplication(Handle handle) {
                 auto lambdaObjPtr = static_pointer_cast<LambdaObject>(this->ast.get(first));
                 this->addInstruction("call @" + first);
             } else if (firstType == Type::VARIABLE) {
-                // include native
                 this->addInstruction("call " + first);
             } else {
                 throw std::runtime_error("[compileApplication] the first argument is not callable.");
@@ -561,7 +560,9 @@ void Compiler::compileFork(Handle handle) {
 
     this->checkWrongArgumentsNumberError("Fork", 2, childrenHoses.size(), handle);
 
-    this->addInstruction("fork " + childrenHoses[1]);
+    // the thunk is evaluated to a closure, fork pops it
+    this->compileHos(childrenHoses[1]);
+    this->addInstruction("fork");
 }
 
 void Compiler::compileApply(Handle handle) {
@@ -615,13 +616,15 @@ void Compiler::compileApply(Handle handle) {
                 }
                 this->addInstruction(first);
             }
+        } else if (firstType == Type::VARIABLE && this->ast.isNativeCall(first)) {
+            // a native returns to the caller's code, even in a tail position
+            this->addInstruction("native " + first);
         } else if (std::find(this->ast.tailcalls.begin(), this->ast.tailcalls.end(), handle) !=
                    this->ast.tailcalls.end()) {
             // we don't has tailcalls right now
             if (firstType == Type::HANDLE && this->ast.get(first)->irisObjectType == IrisObjectType::LAMBDA) {
                 this->addInstruction("tailcall " + first);
             } else if (firstType == Type::VARIABLE) {
-                // include native
                 this->addInstruction("tailcall " + first);
             } else {
                 throw std::runtime_error("[compileApplication] the first argument is not callable.");
@@ -631,7 +634,6 @@ void Compiler::compileApply(Handle handle) {
                 auto lambdaObjPtr = static_pointer_cast<LambdaObject>(this->ast.get(first));
                 this->addInstruction("call @" + first);
             } else if (firstType == Type::VARIABLE) {
-                // include native
                 this->addInstruction("call " + first);
             } else {
                 throw std::runtime_error("[compileApplication] the first argument is not callable.");
@@ -687,17 +689,16 @@ void Compiler::beginCompile() {
     for (auto lambdaHandle : this->ast.getLambdaHandles()) {
         this->compileLambda(lambdaHandle);
     }
-
-    for (auto &inst : this->ILCode) {
-        cout << inst.instructionStr << endl;
-    }
 }
 
+// prints the error with its context in ./iris, the message is returned for the exception
 string Compiler::createErrorMessage(string message, Handle handle) {
-    string prefix = this->ERROR_PREFIX;
-    cout << this->ERROR_PREFIX << endl;
-    utils::coutContext(this->ast, handle, message);
-    cout << this->ERROR_POSTFIX<< endl;
+    if (utils::isPrintingErrors) {
+        cout << this->ERROR_PREFIX << endl;
+        utils::coutContext(this->ast, handle, message);
+        cout << this->ERROR_POSTFIX << endl;
+    }
+    return message;
 }
 
 void Compiler::checkWrongArgumentsNumberError(string functionName, int expectedNum, int actualNum, Handle handle) {
@@ -707,8 +708,7 @@ void Compiler::checkWrongArgumentsNumberError(string functionName, int expectedN
         string message = "[" + functionName + "] expects " + to_string(expectedNum) + " argument" + add_s +
                 ", " +
                 to_string(actualNum) + be + "given";
-        this->createErrorMessage(message, handle);
-        throw std::runtime_error("");
+        throw utils::ScriptError(this->createErrorMessage(message, handle));
     }
 }
 
@@ -6,21 +6,53 @@
 #define TYPED_SCHEME_HEAP_HPP
 
 #include "IrisObject.hpp"
+#include "ProcessLimits.hpp"
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
 
 typedef string Handle;
 const Handle TOP_NODE_HANDLE = "&TOP_NODE";
 
+// cdr doesn't allocate a new list, it returns a view on the same list: <listHandle>^<offset>
+// the view is an ordinary operand (still a HANDLE for typeOfStr), and the heap resolves it to the viewed list
+const char LIST_VIEW_DELIMITER = '^';
+
 // SchemeObjects in the Heap are referred as node
 class Heap {
 public:
-    map<Handle, std::shared_ptr<IrisObject>> dataMap;
-    int handleCounter = 0;
+    std::atomic<int> handleCounter{0};
+    // past it account throws a ResourceLimitError, see ProcessLimits
+    size_t maxBytes = std::numeric_limits<size_t>::max();
+
+    Heap() = default;
+
+    // a heap on top of baseHeap: handles it doesn't hold are read from baseHeap and from its own base heaps,
+    // which are never written
+    explicit Heap(shared_ptr<const Heap> baseHeap);
+
+    Heap(const Heap &other);
+
+    Heap &operator=(const Heap &other);
 
     bool hasHandle(Handle handle);
 
+    // only the objects of its own, not the ones of its base heaps
+    bool ownsHandle(const Handle &handle) const;
+
+    size_t size() const;
+
+    // calls function(handle, objectPtr) for each object of its own, in no particular order
+    template<typename Function>
+    void forEach(Function function) const;
+
     void deleteHandle(Handle handle);
 
-    shared_ptr<IrisObject> get(Handle handle);
+    // drops the objects of its own and what they were accounted for, new handles start again after the base heap's
+    void clear();
+
+    shared_ptr<IrisObject> get(Handle handle) const;
 
     void set(Handle handle, shared_ptr<IrisObject> schemeObjectPtr);
 
@@ -28,10 +60,21 @@ public:
 
     Handle allocateHandle(const string &prefix, IrisObjectType schemeObjectType);
 
+    // counts bytes against maxBytes. the count is rough: a fixed size for each object, plus the contents of
+    // the strings, lists and vectors that grow with their input, counted when they are made
+    void account(size_t bytes);
+
+    // the map node, the handle and the object, roughly
+    static const size_t OBJECT_BYTES = 128;
+
     Handle makeLambda(const string &prefix, Handle parentHandle);
 
     Handle makeString(const string &prefix, string content);
 
+    Handle makeSubstring(const string &prefix, const shared_ptr<StringObject> &stringObjPtr, size_t offset, size_t length);
+
+    Handle makeStringBuilder(const string &prefix, Handle parentHandle);
+
     Handle makeApplication(const string &prefix, Handle parentHandle);
 
     Handle makeQuote(const string &prefix, Handle parentHandle);
@@ -41,44 +84,200 @@ public:
     Handle makeQuasiquote(const string &prefix, Handle parentHandle);
 
     Handle makeList(const string &prefix, Handle parentHandle);
+
+    Handle makeVector(const string &prefix, Handle parentHandle);
+
+    Handle makeNumericVector(const string &prefix, Handle parentHandle, IrisObjectType numericVectorType);
+
+    Handle makeHashTable(const string &prefix, Handle parentHandle, bool isEqualTable);
+
+    Handle makeFuture(const string &prefix, Handle parentHandle);
+
+    Handle makePort(const string &prefix, Handle parentHandle, int fd, PortObject::PortKind kind);
+
+    static Handle makeListView(const Handle &listHandle, int offset);
+
+    static Handle splitListView(const HandleOrStr &hos, int &offset);
+
+private:
+    // processes forked from one program share its heap from different workers. the objects are spread over
+    // shards by handle, each with its own lock, so workers touching different objects rarely wait on each other,
+    // and reads share the lock
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        map<Handle, std::shared_ptr<IrisObject>> objects;
+    };
+
+    static const size_t SHARD_COUNT = 16;
+
+    std::array<Shard, SHARD_COUNT> shards;
+
+    // the objects of the program image, immutable and read without a lock
+    shared_ptr<const Heap> baseHeap;
+
+    // objects are never freed, it only grows
+    std::atomic<size_t> allocatedBytes{0};
+
+    static size_t shardIndex(const Handle &handle);
+
+    // isLocking is false for the base heaps, which are immutable
+    shared_ptr<IrisObject> find(const Handle &handle, bool &isFound, bool isLocking) const;
+
+    shared_ptr<IrisObject> findOwn(const Handle &handle, bool &isFound, bool isLocking) const;
 };
 
+// the counter goes on from the base heap's, so new handles never shadow the base heap's ones
+Heap::Heap(shared_ptr<const Heap> baseHeap) : handleCounter(baseHeap->handleCounter.load()),
+                                              baseHeap(std::move(baseHeap)) {}
+
+Heap::Heap(const Heap &other) {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        std::shared_lock<std::shared_mutex> lock(other.shards[i].mutex);
+        this->shards[i].objects = other.shards[i].objects;
+    }
+    this->handleCounter = other.handleCounter.load();
+    this->maxBytes = other.maxBytes;
+    this->baseHeap = other.baseHeap;
+    this->allocatedBytes = other.allocatedBytes.load();
+}
+
+Heap &Heap::operator=(const Heap &other) {
+    if (this != &other) {
+        for (size_t i = 0; i < SHARD_COUNT; ++i) {
+            std::scoped_lock lock(this->shards[i].mutex, other.shards[i].mutex);
+            this->shards[i].objects = other.shards[i].objects;
+        }
+        this->handleCounter = other.handleCounter.load();
+        this->maxBytes = other.maxBytes;
+        this->baseHeap = other.baseHeap;
+        this->allocatedBytes = other.allocatedBytes.load();
+    }
+    return *this;
+}
+
 
 bool Heap::hasHandle(Handle handle) {
-    return this->dataMap.count(handle);
+    if (this->ownsHandle(handle)) {
+        return true;
+    }
+    for (const Heap *heapPtr = this->baseHeap.get(); heapPtr != nullptr; heapPtr = heapPtr->baseHeap.get()) {
+        if (heapPtr->shards[Heap::shardIndex(handle)].objects.count(handle)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Heap::ownsHandle(const Handle &handle) const {
+    const Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.objects.count(handle);
+}
+
+size_t Heap::size() const {
+    size_t size = 0;
+    for (auto &shard : this->shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        size += shard.objects.size();
+    }
+    return size;
+}
+
+template<typename Function>
+void Heap::forEach(Function function) const {
+    for (auto &shard : this->shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto &[handle, objectPtr] : shard.objects) {
+            function(handle, objectPtr);
+        }
+    }
 }
 
 void Heap::deleteHandle(Handle handle) {
-    this->dataMap.erase(handle);
+    Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.objects.erase(handle);
 }
 
-std::shared_ptr<IrisObject> Heap::get(Handle handle) {
-    if (this->hasHandle(handle)) {
-        return this->dataMap[handle];
+void Heap::clear() {
+    for (auto &shard : this->shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.objects.clear();
+    }
+    this->handleCounter = this->baseHeap != nullptr ? this->baseHeap->handleCounter.load() : 0;
+    this->allocatedBytes = 0;
+}
+
+std::shared_ptr<IrisObject> Heap::get(Handle handle) const {
+    bool isFound;
+    shared_ptr<IrisObject> objectPtr = this->find(handle, isFound, true);
+    for (const Heap *heapPtr = this->baseHeap.get(); !isFound && heapPtr != nullptr; heapPtr = heapPtr->baseHeap.get()) {
+        objectPtr = heapPtr->find(handle, isFound, false);
+    }
+
+    if (isFound) {
+        return objectPtr;
     } else {
         throw std::runtime_error("[ERROR] handle holds nothing -- Heap::get");
     }
 }
 
+size_t Heap::shardIndex(const Handle &handle) {
+    return std::hash<string>()(handle) % SHARD_COUNT;
+}
+
+shared_ptr<IrisObject> Heap::find(const Handle &handle, bool &isFound, bool isLocking) const {
+    auto objectPtr = this->findOwn(handle, isFound, isLocking);
+    if (!isFound && handle.find(LIST_VIEW_DELIMITER) != string::npos) {
+        int offset;
+        objectPtr = this->findOwn(Heap::splitListView(handle, offset), isFound, isLocking);
+    }
+    return objectPtr;
+}
+
+shared_ptr<IrisObject> Heap::findOwn(const Handle &handle, bool &isFound, bool isLocking) const {
+    const Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex, std::defer_lock);
+    if (isLocking) {
+        lock.lock();
+    }
+    auto it = shard.objects.find(handle);
+    isFound = it != shard.objects.end();
+    return isFound ? it->second : nullptr;
+}
+
 void Heap::set(Handle handle, std::shared_ptr<IrisObject> schemeObjectPtr) {
-    this->dataMap[handle] = schemeObjectPtr;
+    Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.objects[handle] = std::move(schemeObjectPtr);
 }
 
 Handle Heap::allocateHandle(IrisObjectType schemeObjectType) {
-    Handle handle = "&" + IrisObjectTypeStrMap[schemeObjectType] + "_" + to_string(this->handleCounter);
-    this->handleCounter++;
-    this->dataMap.emplace(handle, nullptr);
+    this->account(OBJECT_BYTES);
+    Handle handle = "&" + IrisObjectTypeStrMap[schemeObjectType] + "_" + to_string(this->handleCounter++);
+    Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.objects.emplace(handle, nullptr);
     return handle;
 }
 
 Handle Heap::allocateHandle(const string &prefix, IrisObjectType schemeObjectType) {
+    this->account(OBJECT_BYTES);
     Handle handle =
-            "&" + prefix + "." + IrisObjectTypeStrMap[schemeObjectType] + "_" + to_string(this->handleCounter);
-    this->handleCounter++;
-    this->dataMap.emplace(handle, nullptr);
+            "&" + prefix + "." + IrisObjectTypeStrMap[schemeObjectType] + "_" + to_string(this->handleCounter++);
+    Shard &shard = this->shards[Heap::shardIndex(handle)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.objects.emplace(handle, nullptr);
     return handle;
 }
 
+void Heap::account(size_t bytes) {
+    size_t allocatedBytes = this->allocatedBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (allocatedBytes > this->maxBytes) {
+        throw ResourceLimitError("the heap holds more than " + to_string(this->maxBytes) + " bytes");
+    }
+}
+
 Handle Heap::makeLambda(const string &prefix, Handle parentHandle) {
     Handle handle = this->allocateHandle(prefix, IrisObjectType::LAMBDA);
     this->set(handle, std::shared_ptr<LambdaObject>(new LambdaObject(parentHandle, handle)));
@@ -94,11 +293,55 @@ Handle Heap::makeApplication(const string &prefix, Handle parentHandle) {
 Handle Heap::makeList(const string &prefix, Handle parentHandle) {
     string handle = this->allocateHandle(prefix, IrisObjectType::LIST);
     this->set(handle, std::shared_ptr<ListObject>(new ListObject(parentHandle, handle)));
-    shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(this->get(handle));
-    listObjPtr->realListObjPtr = listObjPtr;
     return handle;
 }
 
+Handle Heap::makeVector(const string &prefix, Handle parentHandle) {
+    string handle = this->allocateHandle(prefix, IrisObjectType::VECTOR);
+    this->set(handle, std::shared_ptr<VectorObject>(new VectorObject(parentHandle, handle)));
+    return handle;
+}
+
+Handle Heap::makeNumericVector(const string &prefix, Handle parentHandle, IrisObjectType numericVectorType) {
+    string handle = this->allocateHandle(prefix, numericVectorType);
+    if (numericVectorType == IrisObjectType::F64VECTOR) {
+        this->set(handle, std::shared_ptr<F64VectorObject>(new F64VectorObject(numericVectorType, parentHandle, handle)));
+    } else {
+        this->set(handle, std::shared_ptr<S64VectorObject>(new S64VectorObject(numericVectorType, parentHandle, handle)));
+    }
+    return handle;
+}
+
+Handle Heap::makeHashTable(const string &prefix, Handle parentHandle, bool isEqualTable) {
+    string handle = this->allocateHandle(prefix, IrisObjectType::HASHTABLE);
+    this->set(handle, std::shared_ptr<HashTableObject>(new HashTableObject(isEqualTable, parentHandle, handle)));
+    return handle;
+}
+
+Handle Heap::makeListView(const Handle &listHandle, int offset) {
+    if (offset == 0) {
+        return listHandle;
+    }
+    return listHandle + LIST_VIEW_DELIMITER + to_string(offset);
+}
+
+// returns the handle of the viewed list, and sets the offset of the view (0 for a plain list handle)
+// a module path may hold the delimiter too, a view is told by the digits after it, as a handle ends with _<id>
+Handle Heap::splitListView(const HandleOrStr &hos, int &offset) {
+    offset = 0;
+    size_t delimiterIndex = hos.rfind(LIST_VIEW_DELIMITER);
+    if (delimiterIndex == string::npos || delimiterIndex + 1 == hos.size() || hos.size() - delimiterIndex > 10) {
+        return hos;
+    }
+    for (size_t i = delimiterIndex + 1; i < hos.size(); ++i) {
+        if (!isdigit(hos[i])) {
+            return hos;
+        }
+    }
+    offset = stoi(hos.substr(delimiterIndex + 1));
+    return hos.substr(0, delimiterIndex);
+}
+
 Handle Heap::makeQuote(const string &prefix, Handle parentHandle) {
     string handle = this->allocateHandle(prefix, IrisObjectType::QUOTE);
     this->set(handle, std::shared_ptr<QuoteObject>(new QuoteObject(parentHandle, handle)));
@@ -119,8 +362,39 @@ Handle Heap::makeQuasiquote(const string &prefix, Handle parentHandle) {
 
 
 Handle Heap::makeString(const string &prefix, string content) {
+    this->account(content.size());
     Handle handle = this->allocateHandle(prefix, IrisObjectType::STRING);
-    this->set(handle, std::shared_ptr<StringObject>(new StringObject(content)));
+    this->set(handle, std::shared_ptr<StringObject>(new StringObject(std::move(content))));
+    return handle;
+}
+
+// shares the buffer of stringObjPtr, offset is relative to the start of stringObjPtr
+Handle Heap::makeSubstring(const string &prefix, const shared_ptr<StringObject> &stringObjPtr, size_t offset,
+                           size_t length) {
+    Handle handle = this->allocateHandle(prefix, IrisObjectType::STRING);
+    this->set(handle, std::shared_ptr<StringObject>(
+            new StringObject(stringObjPtr->buffer, stringObjPtr->offset + offset, length)));
+    return handle;
+}
+
+Handle Heap::makeFuture(const string &prefix, Handle parentHandle) {
+    Handle handle = this->allocateHandle(prefix, IrisObjectType::FUTURE);
+    this->set(handle, std::shared_ptr<FutureObject>(new FutureObject(parentHandle, handle)));
+    return handle;
+}
+
+Handle Heap::makePort(const string &prefix, Handle parentHandle, int fd, PortObject::PortKind kind) {
+    Handle handle = this->allocateHandle(prefix, IrisObjectType::PORT);
+    auto portObjPtr = std::shared_ptr<PortObject>(new PortObject(parentHandle, handle));
+    portObjPtr->fd = fd;
+    portObjPtr->kind = kind;
+    this->set(handle, portObjPtr);
+    return handle;
+}
+
+Handle Heap::makeStringBuilder(const string &prefix, Handle parentHandle) {
+    Handle handle = this->allocateHandle(prefix, IrisObjectType::STRINGBUILDER);
+    this->set(handle, std::shared_ptr<StringBuilderObject>(new StringBuilderObject(parentHandle, handle)));
     return handle;
 }
 
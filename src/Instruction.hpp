@@ -18,6 +18,8 @@ typedef Type InstructionArgumentType;
 
 using namespace std;
 
+struct NativeFunction;
+
 class Instruction{
 public:
     InstructionType type;
@@ -25,6 +27,8 @@ public:
     string instructionStr{};
     string mnemonic{};
     string argument{};
+    // the function of a native instruction, looked up when the program image is built
+    const NativeFunction *nativeFunctionPtr = nullptr;
     explicit Instruction(string instString);
 
     static InstructionArgumentType getArgumentType(string arg);
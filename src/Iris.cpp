@@ -0,0 +1,458 @@
+//
+// Iris: the C++ interface of libiris, the only translation unit of the library
+//
+
+#include "Iris.hpp"
+#include "Runtime.hpp"
+#include "ModuleLoader.hpp"
+#include "ProgramCache.hpp"
+
+namespace iris {
+
+Value Value::symbol(std::string name) {
+    Value value(std::move(name));
+    value.valueType = Type::SYMBOL;
+    return value;
+}
+
+double Value::asNumber() const {
+    if (this->valueType != Type::NUMBER) {
+        throw Error("[Value] not a number");
+    }
+    return this->number;
+}
+
+bool Value::asBoolean() const {
+    if (this->valueType != Type::BOOLEAN) {
+        throw Error("[Value] not a boolean");
+    }
+    return this->boolean;
+}
+
+const std::string &Value::asString() const {
+    if (this->valueType != Type::STRING && this->valueType != Type::SYMBOL) {
+        throw Error("[Value] not a string or a symbol");
+    }
+    return this->text;
+}
+
+const std::vector<Value> &Value::asList() const {
+    if (this->valueType != Type::LIST) {
+        throw Error("[Value] not a list");
+    }
+    return this->elements;
+}
+
+bool Value::operator==(const Value &other) const {
+    return this->valueType == other.valueType && this->number == other.number && this->boolean == other.boolean &&
+           this->text == other.text && this->elements == other.elements;
+}
+
+struct Program::Impl {
+    // one worker, a call runs on the calling thread and starts no thread
+    Runtime runtime{OutputMode::UNBUFFERED, 0, 1};
+    shared_ptr<const ProgramImage> image;
+    // the process that ran the top level, the process of a call is forked from it
+    shared_ptr<Process> topProcessPtr;
+    // the heap once the top level has run, a call allocates on callHeapPtr on top of it.
+    // it is only written between calls, when what the globals reach of a call is moved onto it, see promote
+    shared_ptr<Heap> globalHeap;
+    // the heap of every call, emptied when the call returns
+    shared_ptr<Heap> callHeapPtr;
+    // the closure of the top lambda, its variables are the definitions of the top level
+    shared_ptr<Closure> topClosurePtr;
+    // function name -> label of a lambda, or handle of a closure
+    map<string, HandleOrStr> functions;
+    // label of a lambda or handle of a closure -> the closure the calls of the function start from
+    map<HandleOrStr, shared_ptr<Closure>> callClosures;
+    // handle of a list or a quote on globalHeap -> the vectors, hash tables, futures and closures it reaches
+    // through lists and quotes only. such a list never changes, so they are only looked for once
+    map<Handle, vector<Handle>> mutableReaches;
+    ProcessLimits limits;
+
+    static shared_ptr<Impl> load(shared_ptr<const ProgramImage> image);
+
+    // runs processPtr and every process it starts until they are done
+    void run(const shared_ptr<Process> &processPtr);
+
+    Value call(const HandleOrStr &functionHos, const std::vector<Value> &arguments);
+
+    const shared_ptr<Closure> &getCallClosure(const HandleOrStr &functionHos);
+
+    void promote();
+
+    const vector<Handle> &getMutableReach(const Handle &handle);
+};
+
+// the images of the programs loaded so far, shared by every program
+static ProgramCache programCache;
+
+shared_ptr<Program::Impl> Program::Impl::load(shared_ptr<const ProgramImage> image) {
+    auto implPtr = make_shared<Impl>();
+    implPtr->image = std::move(image);
+    implPtr->topProcessPtr = implPtr->runtime.createProcess(implPtr->image);
+    implPtr->run(implPtr->topProcessPtr);
+    implPtr->globalHeap = make_shared<Heap>(*implPtr->topProcessPtr->heap);
+    implPtr->callHeapPtr = make_shared<Heap>(implPtr->globalHeap);
+
+    // the top level is the body of the top lambda, its definitions are the variables of the lambda's closure
+    int topLambdaAddress = implPtr->image->labelAddressMap.at(implPtr->image->topLambdaLabel);
+    auto &topClosurePtr = implPtr->topClosurePtr;
+    implPtr->globalHeap->forEach([&](const Handle &handle, const shared_ptr<IrisObject> &objectPtr) {
+        if (objectPtr != nullptr && objectPtr->irisObjectType == IrisObjectType::CLOSURE &&
+            static_pointer_cast<Closure>(objectPtr)->instructionAddress == topLambdaAddress) {
+            topClosurePtr = static_pointer_cast<Closure>(objectPtr);
+        }
+    });
+
+    // a lambda defined at the top level is stored as its label, the closure is made when it is called
+    for (auto &[originName, uniqueName] : implPtr->image->definedVarOriginUniqueNameMap) {
+        if (topClosurePtr == nullptr || !topClosurePtr->hasBoundVariable(uniqueName)) {
+            continue;
+        }
+        string value = topClosurePtr->getBoundVariable(uniqueName);
+        Type type = typeOfStr(value);
+        if (type == Type::LABEL || (type == Type::HANDLE && implPtr->globalHeap->get(value)->irisObjectType ==
+                                                            IrisObjectType::CLOSURE)) {
+            implPtr->functions[originName] = value;
+        }
+    }
+    return implPtr;
+}
+
+void Program::Impl::run(const shared_ptr<Process> &processPtr) {
+    try {
+        this->runtime.runProcess(processPtr);
+    } catch (std::exception &e) {
+        // the processes of the failed run may still be queued, they are dropped with the scheduler
+        this->runtime.scheduler = make_shared<Scheduler>(1);
+        throw Error(string("[Runtime] ") + e.what());
+    }
+
+    if (processPtr->state != ProcessState::STOPPED) {
+        throw Error("[Runtime] the program sleeps with nothing left to wake it");
+    }
+    if (!processPtr->error.empty()) {
+        throw Error("[ResourceLimitError] " + processPtr->error);
+    }
+}
+
+static HandleOrStr toOperand(const Value &value, Heap &heap) {
+    switch (value.type()) {
+        case Value::Type::NUMBER:
+            return utils::doubleToStr(value.asNumber());
+        case Value::Type::BOOLEAN:
+            return value.asBoolean() ? "#t" : "#f";
+        case Value::Type::STRING:
+            return heap.makeString(RUNTIME_PREFIX, value.asString());
+        case Value::Type::SYMBOL:
+            return "'" + value.asString();
+        case Value::Type::LIST: {
+            Handle handle = heap.makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+            auto listObjPtr = static_pointer_cast<ListObject>(heap.get(handle));
+            for (auto &element : value.asList()) {
+                listObjPtr->addChild(toOperand(element, heap));
+            }
+            return handle;
+        }
+    }
+    return "";
+}
+
+static Value toValue(const HandleOrStr &hos, Heap &heap) {
+    Type type = typeOfStr(hos);
+    if (type == Type::NUMBER) {
+        return Value(stod(hos));
+    } else if (type == Type::BOOLEAN) {
+        return Value(hos == "#t");
+    } else if (type == Type::SYMBOL) {
+        return Value::symbol(hos.substr(1));
+    } else if (type != Type::HANDLE) {
+        throw Error("[Value] cannot convert " + hos);
+    }
+
+    auto objectPtr = heap.get(hos);
+    vector<HandleOrStr> childrenHoses;
+    if (objectPtr->irisObjectType == IrisObjectType::STRING) {
+        return Value(string(static_pointer_cast<StringObject>(objectPtr)->content()));
+    } else if (objectPtr->irisObjectType == IrisObjectType::LIST) {
+        int offset;
+        Heap::splitListView(hos, offset);
+        auto &listHoses = static_pointer_cast<ListObject>(objectPtr)->childrenHoses;
+        childrenHoses.assign(listHoses.begin() + offset, listHoses.end());
+    } else if (objectPtr->irisObjectType == IrisObjectType::QUOTE) {
+        childrenHoses = static_pointer_cast<QuoteObject>(objectPtr)->childrenHoses;
+        // a quoted symbol, see Runtime::toHashKey
+        if (childrenHoses.size() == 1 && typeOfStr(childrenHoses[0]) == Type::SYMBOL) {
+            return Value::symbol(childrenHoses[0].substr(1));
+        }
+    } else if (objectPtr->irisObjectType == IrisObjectType::VECTOR) {
+        auto vectorObjPtr = static_pointer_cast<VectorObject>(objectPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        childrenHoses = vectorObjPtr->elements;
+    } else {
+        throw Error("[Value] cannot convert a " + IrisObjectTypeStrMap[objectPtr->irisObjectType]);
+    }
+
+    vector<Value> elements;
+    for (auto &childHos : childrenHoses) {
+        elements.push_back(toValue(childHos, heap));
+    }
+    return Value(std::move(elements));
+}
+
+// data is the HostFunction
+static HandleOrStr callHostFunction(const vector<HandleOrStr> &arguments, Heap &heap, void *data) {
+    vector<Value> values;
+    for (auto &argument : arguments) {
+        values.push_back(toValue(argument, heap));
+    }
+    return toOperand(((HostFunction) data)(values), heap);
+}
+
+void bindNative(const std::string &name, int arity, HostFunction function) {
+    NativeRegistry::bind(name, arity, callHostFunction, (void *) function);
+}
+
+Program Program::fromCode(const std::string &code) {
+    try {
+        return Program(Impl::load(programCache.getFromCode(code)));
+    } catch (Error &) {
+        throw;
+    } catch (std::exception &e) {
+        throw Error(string("[Compile] ") + e.what());
+    }
+}
+
+Program Program::fromFile(const std::string &path) {
+    try {
+        return Program(Impl::load(programCache.getFromFile(path)));
+    } catch (Error &) {
+        throw;
+    } catch (std::exception &e) {
+        throw Error(string("[Compile] ") + e.what());
+    }
+}
+
+bool Program::hasFunction(const std::string &name) const {
+    return this->implPtr->functions.count(name);
+}
+
+Function Program::getFunction(const std::string &name) const {
+    auto it = this->implPtr->functions.find(name);
+    if (it == this->implPtr->functions.end()) {
+        throw Error("[Program] no function named " + name);
+    }
+    return Function(this->implPtr, it->second);
+}
+
+Value Program::call(const std::string &name, const std::vector<Value> &arguments) const {
+    return this->getFunction(name)(arguments);
+}
+
+void Program::setLimits(const Limits &limits) {
+    ProcessLimits &processLimits = this->implPtr->limits;
+    processLimits = ProcessLimits();
+    if (limits.maxInstructions > 0) {
+        processLimits.maxInstructions = limits.maxInstructions;
+    }
+    if (limits.maxHeapBytes > 0) {
+        processLimits.maxHeapBytes = limits.maxHeapBytes;
+    }
+    if (limits.maxOperandStackDepth > 0) {
+        processLimits.maxOperandStackDepth = limits.maxOperandStackDepth;
+    }
+    if (limits.maxCallDepth > 0) {
+        processLimits.maxCallDepth = limits.maxCallDepth;
+    }
+}
+
+// the arguments are pushed the way a call pushes them, the last one first
+Value Program::Impl::call(const HandleOrStr &functionHos, const std::vector<Value> &arguments) {
+    auto &callHeap = *this->callHeapPtr;
+    callHeap.maxBytes = this->limits.maxHeapBytes;
+    auto processPtr = make_shared<Process>(this->runtime.allocatePID(), *this->topProcessPtr,
+                                           this->getCallClosure(functionHos), this->callHeapPtr);
+    processPtr->limits = this->limits;
+
+    // the globals may be set by a call that fails too
+    try {
+        for (auto it = arguments.rbegin(); it != arguments.rend(); ++it) {
+            processPtr->pushOperand(toOperand(*it, callHeap));
+        }
+
+        this->run(processPtr);
+
+        // the result is the operand on top, above it there may be pushend markers left by primitives
+        auto resultIt = std::find_if(processPtr->opStack.rbegin(), processPtr->opStack.rend(),
+                                     [](const HandleOrStr &hos) { return !hos.starts_with(PUSHEND); });
+        if (resultIt == processPtr->opStack.rend()) {
+            throw Error("[Runtime] the function returned nothing");
+        }
+        Value result = toValue(*resultIt, callHeap);
+
+        this->promote();
+        callHeap.clear();
+        return result;
+    } catch (...) {
+        this->promote();
+        callHeap.clear();
+        throw;
+    }
+}
+
+// a lambda of the top level gets the definitions of the top level as free variables,
+// as Runtime::newClosureBaseOnCurrentClosure does. each call runs on its own copy of the closure
+const shared_ptr<Closure> &Program::Impl::getCallClosure(const HandleOrStr &functionHos) {
+    auto it = this->callClosures.find(functionHos);
+    if (it != this->callClosures.end()) {
+        return it->second;
+    }
+
+    shared_ptr<Closure> closurePtr;
+    if (typeOfStr(functionHos) == Type::LABEL) {
+        int instructionAddress = this->image->labelAddressMap.at(functionHos);
+        closurePtr = make_shared<Closure>(instructionAddress, this->topClosurePtr, "");
+        for (auto &[variableName, variableValue] : this->topClosurePtr->getFreeVariables()) {
+            closurePtr->setFreeVariable(variableName, variableValue, false);
+        }
+        for (auto &[variableName, variableValue] : this->topClosurePtr->getBoundVariables()) {
+            closurePtr->setFreeVariable(variableName, variableValue, false);
+        }
+    } else {
+        closurePtr = static_pointer_cast<Closure>(this->globalHeap->get(functionHos));
+    }
+    return this->callClosures.emplace(functionHos, closurePtr).first->second;
+}
+
+// the objects of a call that the globals still reach once it returns are moved onto globalHeap, the others
+// are dropped with the call's heap. the walk goes through the objects of the call, and through the vectors,
+// hash tables, futures and closures of globalHeap, which the call may have changed
+void Program::Impl::promote() {
+    auto &callHeap = *this->callHeapPtr;
+    // the call made nothing but the closure of its process
+    if (callHeap.size() <= 1 || this->topClosurePtr == nullptr) {
+        return;
+    }
+
+    vector<HandleOrStr> pendingHoses;
+    for (auto &[variableName, variableValue] : this->topClosurePtr->getBoundVariables()) {
+        pendingHoses.push_back(variableValue);
+    }
+
+    set<Handle> visitedHandles;
+    while (!pendingHoses.empty()) {
+        HandleOrStr hos = std::move(pendingHoses.back());
+        pendingHoses.pop_back();
+        if (hos.empty() || hos[0] != '&') {
+            continue;
+        }
+        int offset;
+        Handle handle = Heap::splitListView(hos, offset);
+        if (!visitedHandles.insert(handle).second) {
+            continue;
+        }
+
+        bool isCallObject = callHeap.ownsHandle(handle);
+        auto objectPtr = callHeap.get(handle);
+        if (isCallObject) {
+            this->globalHeap->set(handle, objectPtr);
+        }
+
+        switch (objectPtr->irisObjectType) {
+            case IrisObjectType::LIST:
+            case IrisObjectType::QUOTE:
+            case IrisObjectType::QUASIQUOTE:
+            case IrisObjectType::UNQUOTE:
+                if (isCallObject) {
+                    auto &childrenHoses = IrisObject::getChildrenHosesOrBodies(objectPtr);
+                    pendingHoses.insert(pendingHoses.end(), childrenHoses.begin(), childrenHoses.end());
+                } else {
+                    auto &mutableReach = this->getMutableReach(handle);
+                    pendingHoses.insert(pendingHoses.end(), mutableReach.begin(), mutableReach.end());
+                }
+                break;
+            case IrisObjectType::VECTOR: {
+                auto vectorObjPtr = static_pointer_cast<VectorObject>(objectPtr);
+                std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+                pendingHoses.insert(pendingHoses.end(), vectorObjPtr->elements.begin(), vectorObjPtr->elements.end());
+                break;
+            }
+            case IrisObjectType::HASHTABLE: {
+                auto hashTableObjPtr = static_pointer_cast<HashTableObject>(objectPtr);
+                std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+                for (auto &slot : hashTableObjPtr->slots) {
+                    if (slot.state == HashTableObject::SlotState::FULL) {
+                        pendingHoses.push_back(slot.key);
+                        pendingHoses.push_back(slot.value);
+                    }
+                }
+                break;
+            }
+            case IrisObjectType::FUTURE: {
+                auto futureObjPtr = static_pointer_cast<FutureObject>(objectPtr);
+                std::lock_guard<std::mutex> lock(futureObjPtr->mutex);
+                pendingHoses.push_back(futureObjPtr->value);
+                break;
+            }
+            case IrisObjectType::CLOSURE: {
+                // a closure reads the variables of its parents too, see Process::dereference
+                auto closurePtr = static_pointer_cast<Closure>(objectPtr);
+                for (auto &[variableName, variableValue] : closurePtr->getBoundVariables()) {
+                    pendingHoses.push_back(variableValue);
+                }
+                for (auto &[variableName, variableValue] : closurePtr->getFreeVariables()) {
+                    pendingHoses.push_back(variableValue);
+                }
+                auto &parentClosurePtr = closurePtr->parentClosurePtr;
+                if (parentClosurePtr != nullptr && parentClosurePtr != this->topClosurePtr) {
+                    pendingHoses.push_back(parentClosurePtr->selfHandle);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // the next calls make their handles after the ones moved
+    this->globalHeap->handleCounter = std::max(this->globalHeap->handleCounter.load(), callHeap.handleCounter.load());
+}
+
+const vector<Handle> &Program::Impl::getMutableReach(const Handle &handle) {
+    auto it = this->mutableReaches.find(handle);
+    if (it != this->mutableReaches.end()) {
+        return it->second;
+    }
+
+    vector<Handle> mutableReach;
+    for (auto &childHos : IrisObject::getChildrenHosesOrBodies(this->globalHeap->get(handle))) {
+        if (childHos.empty() || childHos[0] != '&') {
+            continue;
+        }
+        int offset;
+        Handle childHandle = Heap::splitListView(childHos, offset);
+        IrisObjectType type = this->globalHeap->get(childHandle)->irisObjectType;
+        if (type == IrisObjectType::LIST || type == IrisObjectType::QUOTE || type == IrisObjectType::QUASIQUOTE ||
+            type == IrisObjectType::UNQUOTE) {
+            auto &childReach = this->getMutableReach(childHandle);
+            mutableReach.insert(mutableReach.end(), childReach.begin(), childReach.end());
+        } else if (type == IrisObjectType::VECTOR || type == IrisObjectType::HASHTABLE ||
+                   type == IrisObjectType::FUTURE || type == IrisObjectType::CLOSURE) {
+            mutableReach.push_back(childHandle);
+        }
+    }
+    return this->mutableReaches.emplace(handle, std::move(mutableReach)).first->second;
+}
+
+Value Function::operator()(const std::vector<Value> &arguments) const {
+    try {
+        return this->programImplPtr->call(this->functionHos, arguments);
+    } catch (Error &) {
+        throw;
+    } catch (std::exception &e) {
+        throw Error(string("[Runtime] ") + e.what());
+    }
+}
+
+}
@@ -0,0 +1,134 @@
+//
+// Iris: the C++ interface of libiris, for running Iris code inside a C++ program
+//
+
+#ifndef TYPED_SCHEME_IRIS_HPP
+#define TYPED_SCHEME_IRIS_HPP
+
+// only this header is public, the compiler and the VM stay inside libiris
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace iris {
+
+// a compile or a runtime error of the Iris code
+class Error : public std::runtime_error {
+public:
+    explicit Error(const std::string &message) : std::runtime_error(message) {};
+};
+
+// a value passed to or returned by Iris code, vectors come back as lists
+class Value {
+public:
+    enum class Type {
+        NUMBER, BOOLEAN, STRING, SYMBOL, LIST
+    };
+
+    Value(double number) : valueType(Type::NUMBER), number(number) {};
+
+    Value(int number) : Value((double) number) {};
+
+    Value(bool boolean) : valueType(Type::BOOLEAN), boolean(boolean) {};
+
+    Value(std::string str) : valueType(Type::STRING), text(std::move(str)) {};
+
+    Value(const char *str) : Value(std::string(str)) {};
+
+    Value(std::vector<Value> elements) : valueType(Type::LIST), elements(std::move(elements)) {};
+
+    // 'name
+    static Value symbol(std::string name);
+
+    Type type() const { return this->valueType; };
+
+    // each throws Error when the value is of another type
+    double asNumber() const;
+
+    bool asBoolean() const;
+
+    // the characters of a string, or the name of a symbol
+    const std::string &asString() const;
+
+    const std::vector<Value> &asList() const;
+
+    bool operator==(const Value &other) const;
+
+private:
+    Type valueType;
+    double number = 0;
+    bool boolean = false;
+    std::string text;
+    std::vector<Value> elements;
+};
+
+// the bounds on each call of a program, 0 for no bound. a call past one fails with an Error
+struct Limits {
+    long long maxInstructions = 0;
+    // bytes the call allocates, counted roughly
+    size_t maxHeapBytes = 0;
+    size_t maxOperandStackDepth = 0;
+    size_t maxCallDepth = 0;
+};
+
+class Function;
+
+// a C++ function called from Iris code, it reports an error by throwing
+typedef Value (*HostFunction)(const std::vector<Value> &arguments);
+
+// binds function to a namespaced name like "geometry.area", Iris code calls it after (native geometry)
+// arity -1 takes any number of arguments. a program finds its natives when it is loaded, a native bound later
+// is still found when it is called, only slower
+void bindNative(const std::string &name, int arity, HostFunction function);
+
+// a compiled program, the top level runs once when it is loaded, its functions can then be called any number of
+// times without compiling again. compiled code is cached by source, loading the same code again, or the same
+// file while it and its imports are unchanged, only runs the top level
+// a program is not thread safe, calls from several threads must be serialized, or use one program per thread
+class Program {
+public:
+    static Program fromCode(const std::string &code);
+
+    static Program fromFile(const std::string &path);
+
+    // a function defined at the top level of the program
+    bool hasFunction(const std::string &name) const;
+
+    // throws Error when there is no such function
+    Function getFunction(const std::string &name) const;
+
+    Value call(const std::string &name, const std::vector<Value> &arguments) const;
+
+    // bounds the calls made from now on, not the top level that ran when the program was loaded
+    void setLimits(const Limits &limits);
+
+    struct Impl;
+
+private:
+    explicit Program(std::shared_ptr<Impl> implPtr) : implPtr(std::move(implPtr)) {};
+
+    std::shared_ptr<Impl> implPtr;
+};
+
+// looked up once, a call then goes straight to the function's code, on the calling thread
+// what a call allocates is dropped when it returns, except for what the globals reach then, which is kept with
+// the program. finding it walks the vectors and hash tables of the program, when the call allocated anything
+class Function {
+public:
+    Value operator()(const std::vector<Value> &arguments) const;
+
+private:
+    friend class Program;
+
+    Function(std::shared_ptr<Program::Impl> programImplPtr, std::string functionHos) :
+            programImplPtr(std::move(programImplPtr)), functionHos(std::move(functionHos)) {};
+
+    std::shared_ptr<Program::Impl> programImplPtr;
+    // the label of a lambda, or the handle of a closure
+    std::string functionHos;
+};
+
+}
+
+#endif //TYPED_SCHEME_IRIS_HPP
@@ -6,10 +6,16 @@
 #define TYPED_IRIS_IRISOBJECT_HPP
 
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <map>
 #include <regex>
 #include <set>
 #include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unistd.h>
 
 using namespace std;
 
@@ -17,13 +23,20 @@ typedef string Handle;
 typedef string HandleOrStr;
 
 enum class IrisObjectType {
-    CLOSURE, STRING, LIST, LAMBDA, APPLICATION, QUOTE, QUASIQUOTE, UNQUOTE, CONTINUATION, SchemeChildrenHosesObject
+    CLOSURE, STRING, STRINGBUILDER, LIST, VECTOR, F64VECTOR, S64VECTOR, HASHTABLE, FUTURE, PORT, LAMBDA, APPLICATION, QUOTE, QUASIQUOTE, UNQUOTE, CONTINUATION, SchemeChildrenHosesObject
 };
 
 map<IrisObjectType, string> IrisObjectTypeStrMap = {
         {IrisObjectType::CLOSURE,                   "CLOSURE"},
         {IrisObjectType::STRING,                    "STRING"},
+        {IrisObjectType::STRINGBUILDER,             "STRINGBUILDER"},
         {IrisObjectType::LIST,                      "LIST"},
+        {IrisObjectType::VECTOR,                    "VECTOR"},
+        {IrisObjectType::F64VECTOR,                 "F64VECTOR"},
+        {IrisObjectType::S64VECTOR,                 "S64VECTOR"},
+        {IrisObjectType::HASHTABLE,                 "HASHTABLE"},
+        {IrisObjectType::FUTURE,                    "FUTURE"},
+        {IrisObjectType::PORT,                      "PORT"},
         {IrisObjectType::LAMBDA,                    "LAMBDA"},
         {IrisObjectType::APPLICATION,               "APPLICATION"},
         {IrisObjectType::QUOTE,                     "QUOTE"},
@@ -75,6 +88,8 @@ public:
             : IrisObject(IrisObjectType::CLOSURE), instructionAddress(
             instructionAddress), parentClosurePtr(parentClosurePtr), selfHandle(selfHandle) {};
 
+    Closure(const Closure &other);
+
     void setBoundVariable(const string &variableName, const string &variableValue, bool dirtyFlag);
 
     string getBoundVariable(const string &variableName);
@@ -88,6 +103,16 @@ public:
     bool hasFreeVariable(const string &variableName);
 
     bool isDirtyVairable(const string &variableName);
+
+    // copies taken under the lock, for walking the variables while other workers may define new ones
+    map<string, string> getBoundVariables();
+
+    map<string, string> getFreeVariables();
+
+private:
+    // processes running on different workers share closures (a forked thunk's parent, the top closure),
+    // variables are read far more often than set, reads share the lock
+    mutable std::shared_mutex variablesMutex;
 };
 
 class ApplicationObject : public IrisObject {
@@ -105,55 +130,216 @@ void ApplicationObject::addChild(HandleOrStr childHos) {
 
 class ListObject : public IrisObject {
 public:
-    bool isFake = false;
-    shared_ptr<ListObject> realListObjPtr = nullptr;
-    int currentIndex = 0;
-
     ListObject(Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::LIST, parentHandle, selfHandle) {};
 
     vector<HandleOrStr> childrenHoses;
 
+    // the hash of the list from each offset to its end, filled by Runtime::listHash when the list
+    // is first hashed, lists are no longer modified once they are handed to the program
+    // published atomically, two workers may hash the same list at once
+    std::atomic<shared_ptr<const vector<size_t>>> suffixHashes;
+
     void addChild(HandleOrStr childHos);
 
-    void pointTo(shared_ptr<ListObject> realListObjPtr, int index);
+    HandleOrStr car(int offset = 0);
 
-    HandleOrStr car();
+    int size(int offset = 0);
 
-    int size();
+    vector<HandleOrStr> getChildrenHoses(int offset = 0);
+};
+
+// offset is the start of a list view (see Heap::makeListView), 0 for the whole list
+vector<HandleOrStr> ListObject::getChildrenHoses(int offset) {
+    return vector<HandleOrStr>(this->childrenHoses.begin() + offset, this->childrenHoses.end());
+}
+
+int ListObject::size(int offset) {
+    return this->childrenHoses.size() - offset;
+}
+
+HandleOrStr ListObject::car(int offset) {
+    return this->childrenHoses[offset];
+}
+
+void ListObject::addChild(HandleOrStr childHos) {
+    this->childrenHoses.push_back(childHos);
+}
+
+// a fixed size, contiguous array of values, indexed in O(1)
+class VectorObject : public IrisObject {
+public:
+    VectorObject(Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::VECTOR, parentHandle, selfHandle) {};
+
+    // processes running on different workers share the vector, elements is only read or written under the lock
+    std::mutex mutex;
+
+    vector<HandleOrStr> elements;
+
+    void addElement(HandleOrStr hos);
 
-    vector<HandleOrStr> getChildrenHoses();
+    int size();
 };
 
-vector<HandleOrStr> ListObject::getChildrenHoses() {
-    return vector<HandleOrStr>(this->childrenHoses.begin() + currentIndex, this->childrenHoses.end());
+void VectorObject::addElement(HandleOrStr hos) {
+    this->elements.push_back(hos);
 }
 
-int ListObject::size() {
-    if(this->isFake) {
-        return this->realListObjPtr->childrenHoses.size() - currentIndex;
-    } else {
-        return this->childrenHoses.size();
+int VectorObject::size() {
+    return this->elements.size();
+}
+
+// homogeneous numeric vector, the elements are unboxed so that bulk operations run on a flat array
+// T is double for F64VECTOR and int64_t for S64VECTOR
+template<typename T>
+class NumericVectorObject : public IrisObject {
+public:
+    NumericVectorObject(IrisObjectType irisObjectType, Handle parentHandle, Handle selfHandle) : IrisObject(
+            irisObjectType, parentHandle, selfHandle) {};
+
+    typedef T value_type;
+
+    // see VectorObject::mutex
+    std::mutex mutex;
+
+    vector<T> elements;
+
+    int size() { return this->elements.size(); };
+};
+
+typedef NumericVectorObject<double> F64VectorObject;
+typedef NumericVectorObject<int64_t> S64VectorObject;
+
+// open addressing hash table with linear probing, the capacity is always a power of 2
+// the hash of the key is computed by the runtime and kept in the slot, so probing compares hashes
+// first and growing never rehashes the keys. keyEqual decides whether two keys with the same hash match
+class HashTableObject : public IrisObject {
+public:
+    HashTableObject(bool isEqualTable, Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::HASHTABLE,
+                                                                                            parentHandle, selfHandle),
+                                                                                 isEqualTable(isEqualTable) {};
+
+    enum class SlotState : uint8_t {
+        EMPTY, FULL, DELETED
+    };
+
+    struct Slot {
+        size_t hash = 0;
+        SlotState state = SlotState::EMPTY;
+        HandleOrStr key;
+        HandleOrStr value;
+    };
+
+    // keys are compared with eq? semantics (identity of the value) when false
+    bool isEqualTable;
+
+    // processes running on different workers share the table, the slots and the counts are only used under the lock.
+    // keyEqual is called with the lock held, so it may lock vectors but never another table
+    std::mutex mutex;
+
+    vector<Slot> slots;
+
+    size_t count = 0;
+
+    template<typename KeyEqual>
+    Slot *find(const HandleOrStr &key, size_t hash, KeyEqual keyEqual);
+
+    template<typename KeyEqual>
+    void set(const HandleOrStr &key, size_t hash, const HandleOrStr &value, KeyEqual keyEqual);
+
+    template<typename KeyEqual>
+    bool remove(const HandleOrStr &key, size_t hash, KeyEqual keyEqual);
+
+private:
+    // FULL and DELETED slots, DELETED slots are only reclaimed by a rehash
+    size_t used = 0;
+
+    void grow();
+};
+
+template<typename KeyEqual>
+HashTableObject::Slot *HashTableObject::find(const HandleOrStr &key, size_t hash, KeyEqual keyEqual) {
+    if (this->slots.empty()) {
+        return nullptr;
+    }
+
+    size_t mask = this->slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot &slot = this->slots[i];
+        if (slot.state == SlotState::EMPTY) {
+            return nullptr;
+        }
+        if (slot.state == SlotState::FULL && slot.hash == hash && keyEqual(slot.key, key)) {
+            return &slot;
+        }
     }
 }
 
-HandleOrStr ListObject::car() {
-    if (isFake) {
-        return realListObjPtr->childrenHoses[currentIndex];
-    } else {
-        return this->childrenHoses[0];
+template<typename KeyEqual>
+void HashTableObject::set(const HandleOrStr &key, size_t hash, const HandleOrStr &value, KeyEqual keyEqual) {
+    Slot *slotPtr = this->find(key, hash, keyEqual);
+    if (slotPtr != nullptr) {
+        slotPtr->value = value;
+        return;
+    }
+
+    // keep the load factor (tombstones included) under 3/4, so that probing always hits an EMPTY slot
+    if ((this->used + 1) * 4 > this->slots.size() * 3) {
+        this->grow();
+    }
+
+    size_t mask = this->slots.size() - 1;
+    size_t i = hash & mask;
+    while (this->slots[i].state == SlotState::FULL) {
+        i = (i + 1) & mask;
     }
+
+    Slot &slot = this->slots[i];
+    if (slot.state == SlotState::EMPTY) {
+        this->used++;
+    }
+    slot.hash = hash;
+    slot.state = SlotState::FULL;
+    slot.key = key;
+    slot.value = value;
+    this->count++;
 }
 
-void ListObject::addChild(HandleOrStr childHos) {
-    this->childrenHoses.push_back(childHos);
+template<typename KeyEqual>
+bool HashTableObject::remove(const HandleOrStr &key, size_t hash, KeyEqual keyEqual) {
+    Slot *slotPtr = this->find(key, hash, keyEqual);
+    if (slotPtr == nullptr) {
+        return false;
+    }
+
+    slotPtr->state = SlotState::DELETED;
+    slotPtr->key.clear();
+    slotPtr->value.clear();
+    this->count--;
+    return true;
 }
 
-// when using cdr, we fake a new List, and make the new List point to the real List
-// reduce the cdr complexity
-void ListObject::pointTo(shared_ptr<ListObject> realListObjPtr, int index) {
-    this->isFake = true;
-    this->currentIndex = index;
-    this->realListObjPtr = realListObjPtr;
+void HashTableObject::grow() {
+    // only grow when the table is really full, otherwise rehashing at the same size drops the tombstones
+    size_t capacity = this->slots.empty() ? 8 : this->slots.size();
+    if ((this->count + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+
+    vector<Slot> oldSlots(capacity);
+    oldSlots.swap(this->slots);
+
+    size_t mask = capacity - 1;
+    for (auto &oldSlot : oldSlots) {
+        if (oldSlot.state != SlotState::FULL) {
+            continue;
+        }
+        size_t i = oldSlot.hash & mask;
+        while (this->slots[i].state == SlotState::FULL) {
+            i = (i + 1) & mask;
+        }
+        this->slots[i] = std::move(oldSlot);
+    }
+    this->used = this->count;
 }
 
 // [lambda, [param0, ... ], body0, ...]
@@ -246,46 +432,140 @@ void UnquoteObject::addChild(HandleOrStr childHos) {
     this->childrenHoses.push_back(childHos);
 }
 
+// the text (without the quotes of the literal) is an immutable buffer shared by all its substrings,
+// a StringObject is a [offset, offset + length) slice of it
 class StringObject : public IrisObject {
 public:
-    string content;
+    shared_ptr<const string> buffer;
+    size_t offset = 0;
+    size_t length = 0;
     IrisObjectType irisObjectType = IrisObjectType::STRING;
 
-    StringObject(string content) : IrisObject(IrisObjectType::STRING), content(content) {}
+    StringObject(string content) : IrisObject(IrisObjectType::STRING),
+                                   buffer(make_shared<const string>(std::move(content))),
+                                   length(buffer->size()) {}
+
+    StringObject(shared_ptr<const string> buffer, size_t offset, size_t length) : IrisObject(IrisObjectType::STRING),
+                                                                                  buffer(std::move(buffer)),
+                                                                                  offset(offset), length(length) {}
+
+    string_view content() const { return string_view(*this->buffer).substr(this->offset, this->length); }
+};
+
+// mutable buffer for building a string piece by piece, appending is amortized O(1)
+class StringBuilderObject : public IrisObject {
+public:
+    StringBuilderObject(Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::STRINGBUILDER,
+                                                                             parentHandle, selfHandle) {};
+
+    // see VectorObject::mutex
+    std::mutex mutex;
+
+    string buffer;
+};
+
+// the result of (future expression), resolved once by the process running expression
+// the processes touching it before that sleep until it is resolved
+class FutureObject : public IrisObject {
+public:
+    FutureObject(Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::FUTURE, parentHandle,
+                                                                      selfHandle) {};
+
+    std::mutex mutex;
+    bool isResolved = false;
+    HandleOrStr value;
+    // set instead of value when the process of the future is stopped by a ResourceLimitError
+    string error;
+    vector<int> waitingPids;
+};
+
+// a file or a socket, its descriptor is non-blocking and the process using it sleeps until it is ready,
+// see Runtime::waitForPort
+class PortObject : public IrisObject {
+public:
+    enum class PortKind {
+        INPUT_FILE, CONNECTION, LISTENER
+    };
+
+    PortObject(Handle parentHandle, Handle selfHandle) : IrisObject(IrisObjectType::PORT, parentHandle, selfHandle) {};
+
+    ~PortObject() {
+        if (this->fd >= 0) {
+            close(this->fd);
+        }
+    }
+
+    int fd = -1;
+    PortKind kind = PortKind::INPUT_FILE;
+    // epoll can't wait for a regular file, and reading one never blocks
+    bool isPollable = true;
+    // read from fd but not handed to the program yet
+    string inputBuffer;
+    bool isEof = false;
+    // written by the program but not sent yet
+    string outputBuffer;
 };
 
 //=================================================================
 //                    Closure's Closure
 //=================================================================
 
+Closure::Closure(const Closure &other) : IrisObject(other), instructionAddress(other.instructionAddress),
+                                         parentClosurePtr(other.parentClosurePtr), selfHandle(other.selfHandle) {
+    std::shared_lock<std::shared_mutex> lock(other.variablesMutex);
+    this->boundVariables = other.boundVariables;
+    this->freeVariables = other.freeVariables;
+    this->dirtyFlags = other.dirtyFlags;
+}
+
 void Closure::setBoundVariable(const string &variableName, const string &variableValue, bool dirtyFlag) {
+    std::unique_lock<std::shared_mutex> lock(this->variablesMutex);
     this->boundVariables[variableName] = variableValue;
     this->dirtyFlags[variableName] = dirtyFlag;
 }
 
 string Closure::getBoundVariable(const string &variableName) {
-    return this->boundVariables[variableName];
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
+    auto it = this->boundVariables.find(variableName);
+    return it != this->boundVariables.end() ? it->second : "";
 }
 
 void Closure::setFreeVariable(const string &variableName, const string &variableValue, bool dirtyFlag) {
+    std::unique_lock<std::shared_mutex> lock(this->variablesMutex);
     this->freeVariables[variableName] = variableValue;
     this->dirtyFlags[variableName] = dirtyFlag;
 }
 
 string Closure::getFreeVariable(const string &variableName) {
-    return this->freeVariables[variableName];
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
+    auto it = this->freeVariables.find(variableName);
+    return it != this->freeVariables.end() ? it->second : "";
 }
 
 bool Closure::hasBoundVariable(const string &variableName) {
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
     return this->boundVariables.count(variableName);
 }
 
 bool Closure::hasFreeVariable(const string &variableName) {
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
     return this->freeVariables.count(variableName);
 }
 
 bool Closure::isDirtyVairable(const string &variableName) {
-    return this->dirtyFlags[variableName];
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
+    auto it = this->dirtyFlags.find(variableName);
+    return it != this->dirtyFlags.end() && it->second;
+}
+
+map<string, string> Closure::getBoundVariables() {
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
+    return this->boundVariables;
+}
+
+map<string, string> Closure::getFreeVariables() {
+    std::shared_lock<std::shared_mutex> lock(this->variablesMutex);
+    return this->freeVariables;
 }
 
 
@@ -317,9 +597,19 @@ set<string> KEYWORDS = {
         "write", "read",
         "call/cc",
         "import", "native",
-        "fork",
+        "fork", "send", "receive", "current-pid", "yield", "set-priority!", "set-reduction-budget!",
+        "parallel-map", "parallel-reduce", "future", "touch", "future?",
+        "sleep", "after", "open-input-file", "read-line", "tcp-listen", "tcp-accept", "tcp-connect", "close-port",
         "quote", "quasiquote", "unquote",
         "let", "apply",
+        "vector", "make-vector", "vector-ref", "vector-set!", "vector-length", "vector->list", "list->vector", "vector?",
+        "f64vector", "s64vector", "make-f64vector", "make-s64vector", "list->f64vector", "list->s64vector",
+        "vector+", "vector-", "vector*", "vector/", "vector=", "vector<", "vector>", "vector<=", "vector>=",
+        "vector-sum", "vector-dot", "vector-min", "vector-max", "vector-map",
+        "string-append", "substring", "string-length", "string-ref", "string-contains", "string?",
+        "make-string-builder", "string-builder-append!", "string-builder-length", "builder->string",
+        "make-hash-table", "hash-ref", "hash-set!", "hash-remove!", "hash-count", "hash-contains?",
+        "hash-keys", "hash-values", "hash->list", "hash-table?",
         "class", "isinstance?",
         "exit", "type",
 };
@@ -339,6 +629,8 @@ map<string, string> primitiveInstructionMap{
 };
 
 Type typeOfStr(const string &inputStr) {
+    // compiled once, a call to a function of a program checks the type of every value it passes
+    static const std::regex NUMBER_REGEX("(-?[0-9]+([.][0-9]+)?)");
     if (inputStr.empty()) {
         return Type::UNDEFINED;
     } else if (KEYWORDS.count(inputStr) != 0) {
@@ -357,7 +649,7 @@ Type typeOfStr(const string &inputStr) {
         return Type::LABEL;
     } else if (inputStr[0] == '"' && inputStr[inputStr.size() - 1] == '"') {
         return Type::STRING;
-    } else if (std::regex_match(inputStr, std::regex("(-?[0-9]+([.][0-9]+)?)"))) {
+    } else if (std::regex_match(inputStr, NUMBER_REGEX)) {
         return Type::NUMBER;
     } else {
         return Type::VARIABLE;
@@ -5,109 +5,232 @@
 #ifndef TYPED_SCHEME_LEXER_HPP
 #define TYPED_SCHEME_LEXER_HPP
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
-#include <regex>
 #include <iostream>
 #include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
 namespace Lexer {
 
+    // told apart while lexing, the parser never looks at the characters of a literal to classify it
+    enum class TokenKind : std::uint8_t {
+        LEFT_PAREN, RIGHT_PAREN, VECTOR_OPEN, QUOTE, QUASIQUOTE, UNQUOTE, STRING, NUMBER, BOOLEAN,
+        // a variable, a keyword, a port..., and [ ] { } which are read as one-character names
+        NAME
+    };
+
+    // a token is a view into the source, the source must outlive it
     class Token {
     public:
 
-        std::string string;
+        // a string keeps its quotes and its escapes, see stringContent
+        std::string_view string;
+        // the offset of the first character in the source
         int sourceIndex;
+        TokenKind kind;
+
+        Token(std::string_view string, int sourceIndex, TokenKind kind) :
+                string(string), sourceIndex(sourceIndex), kind(kind) {};
 
-        Token(std::string string, int sourceIndex) : string(std::move(string)), sourceIndex(sourceIndex) {};
+        // the characters between the quotes of a STRING, \" and \\ are unescaped, other escapes kept as they are
+        std::string stringContent() const;
 
         friend std::ostream &operator<<(std::ostream &os, const Token &token);
     };
 
+    std::string Token::stringContent() const {
+        std::string content;
+        content.reserve(this->string.size() - 2);
+        for (size_t i = 1; i + 1 < this->string.size(); ++i) {
+            if (this->string[i] == '\\' && (this->string[i + 1] == '"' || this->string[i + 1] == '\\') &&
+                i + 2 < this->string.size()) {
+                i++;
+            }
+            content += this->string[i];
+        }
+        return content;
+    }
+
     std::ostream &operator<<(std::ostream &os, const Token &token) {
         os << token.string << " / " << std::to_string(token.sourceIndex) << "\n";
         return os;
     }
 
-    std::vector<Token> tokenize(std::string code) {
-        // TODO: deal with escaped chars
-        code = code + "\n";
+    // a file mapped read only into memory, lexing it reads no copy of it
+    class SourceFile {
+    public:
+        explicit SourceFile(const std::string &path);
 
-        std::vector<Token> tokens;
-        std::vector<std::string> tempTokens;
+        ~SourceFile();
 
-        for (int i = 0; i < code.size(); ++i) {
-            // pass comment
-            if (code[i] == ';') {
-                while (code[i] != '\n' && code[i] != '\r') {
-                    i++;
-                }
-                continue;
-            } else if (code[i] == '(' || code[i] == ')' || code[i] == '[' || code[i] == ']' || code[i] == '{' ||
-                       code[i] == '}' || code[i] == '\'' || code[i] == ',' || code[i] == '`' || code[i] == '"') {
-                if (!tempTokens.empty()) {
-                    std::string newTokenStr;
-                    for (std::string &c : tempTokens) {
-                        newTokenStr += c;
-                    }
-                    tokens.push_back(Token(newTokenStr, i - newTokenStr.size()));
-                    tempTokens.clear();
-                }
-                // Matching String Token
-if (code[i] == '"') {
-    int originIndex = i;
-    // ? means greedy matching
-    string resultStr = "\"";
-    i += 1;
-    bool stringMatchFlag = false;
-
-    while (i < code.size()) {
-        if (code[i] == '"') {
-            resultStr += code[i];
-            stringMatchFlag = true;
-            break;
-        } else if (code[i] == '\\' && i + 1 < code.size()) {
-            if (code[i + 1] != '"' && code[i + 1] != '\\') {
-                resultStr += code[i];
+        SourceFile(const SourceFile &) = delete;
+
+        SourceFile &operator=(const SourceFile &) = delete;
+
+        std::string_view view() const { return {this->data, this->size}; };
+
+    private:
+        // an empty file is not mapped
+        const char *data = nullptr;
+        size_t size = 0;
+    };
+
+    SourceFile::SourceFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat fileStat{};
+        if (fd < 0 || ::fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+            if (fd >= 0) {
+                ::close(fd);
             }
-            resultStr += code[i + 1];
-            i += 2;
-        } else {
-            resultStr += code[i];
-            i += 1;
+            throw std::runtime_error("file not found: " + path);
         }
+
+        this->size = fileStat.st_size;
+        if (this->size > 0) {
+            void *mapped = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("can't map file: " + path);
+            }
+            this->data = static_cast<const char *>(mapped);
+        }
+        // the mapping stays valid once the file is closed
+        ::close(fd);
     }
 
-    if (!stringMatchFlag) {
-        // Doesn't match a proper string
-        throw std::runtime_error("[error] can't match '\"'" + code.substr(originIndex,
-                                                                            originIndex + 5 < code.size()
-                                                                            ? originIndex + 5
-                                                                            : code.size()) +
-                                    "... : Lexer::lexer_string_matching");
-    } else {
-        tokens.push_back(Lexer::Token(resultStr, i));
+    SourceFile::~SourceFile() {
+        if (this->data != nullptr) {
+            ::munmap(const_cast<char *>(this->data), this->size);
+        }
     }
-                } else {
-                    tokens.push_back(Lexer::Token(std::string(1, code[i]), i));
-                }
 
-            } else if (code[i] == ' ' || code[i] == '\t' || code[i] == '\n' || code[i] == '\r') {
-                if (!tempTokens.empty()) {
-                    std::string newTokenStr;
-                    for (std::string &c : tempTokens) {
-                        newTokenStr += c;
+    // -?[0-9]+([.][0-9]+)?, the numbers of typeOfStr
+    bool isNumber(std::string_view str) {
+        size_t i = !str.empty() && str[0] == '-' ? 1 : 0;
+        size_t integerStart = i;
+        while (i < str.size() && str[i] >= '0' && str[i] <= '9') {
+            i++;
+        }
+        if (i == integerStart) {
+            return false;
+        } else if (i == str.size()) {
+            return true;
+        } else if (str[i] != '.') {
+            return false;
+        }
+
+        size_t fractionStart = ++i;
+        while (i < str.size() && str[i] >= '0' && str[i] <= '9') {
+            i++;
+        }
+        return i > fractionStart && i == str.size();
+    }
+
+    TokenKind kindOfAtom(std::string_view atom) {
+        if (atom == "#t" || atom == "#f") {
+            return TokenKind::BOOLEAN;
+        } else if (isNumber(atom)) {
+            return TokenKind::NUMBER;
+        } else {
+            return TokenKind::NAME;
+        }
+    }
+
+    // one pass over code, the tokens point into it
+    std::vector<Token> tokenize(std::string_view code) {
+        std::vector<Token> tokens;
+        // the start of the atom being read, -1 between atoms
+        long atomStart = -1;
+
+        auto endAtom = [&](size_t end) {
+            if (atomStart >= 0) {
+                std::string_view atom = code.substr(atomStart, end - atomStart);
+                tokens.emplace_back(atom, (int) atomStart, kindOfAtom(atom));
+                atomStart = -1;
+            }
+        };
+
+        for (size_t i = 0; i < code.size(); ++i) {
+            char c = code[i];
+            switch (c) {
+                case ';':
+                    // pass comment
+                    endAtom(i);
+                    while (i < code.size() && code[i] != '\n' && code[i] != '\r') {
+                        i++;
                     }
-                    tokens.push_back(Token(newTokenStr, i - newTokenStr.size()));
-                    tempTokens.clear();
+                    break;
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                    endAtom(i);
+                    break;
+                case '(':
+                    // vector literal #( ... )
+                    if (atomStart >= 0 && i - atomStart == 1 && code[atomStart] == '#') {
+                        tokens.emplace_back(code.substr(atomStart, 2), (int) atomStart, TokenKind::VECTOR_OPEN);
+                        atomStart = -1;
+                        break;
+                    }
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::LEFT_PAREN);
+                    break;
+                case ')':
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::RIGHT_PAREN);
+                    break;
+                case '\'':
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::QUOTE);
+                    break;
+                case '`':
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::QUASIQUOTE);
+                    break;
+                case ',':
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::UNQUOTE);
+                    break;
+                case '[':
+                case ']':
+                case '{':
+                case '}':
+                    endAtom(i);
+                    tokens.emplace_back(code.substr(i, 1), (int) i, TokenKind::NAME);
+                    break;
+                case '"': {
+                    endAtom(i);
+                    size_t start = i;
+                    // a backslash escapes the character after it, the closing quote is the first unescaped one
+                    for (i = start + 1; i < code.size() && code[i] != '"'; ++i) {
+                        if (code[i] == '\\') {
+                            i++;
+                        }
+                    }
+                    if (i >= code.size()) {
+                        throw std::runtime_error("[error] can't match '\"'" + std::string(code.substr(start, 5)) +
+                                                 "... : Lexer::lexer_string_matching");
+                    }
+                    tokens.emplace_back(code.substr(start, i - start + 1), (int) start, TokenKind::STRING);
+                    break;
                 }
-            } else {
-                tempTokens.push_back(std::string(1, code[i]));
+                default:
+                    if (atomStart < 0) {
+                        atomStart = (long) i;
+                    }
             }
         }
+        endAtom(code.size());
         return tokens;
     }
 }
@@ -0,0 +1,71 @@
+//
+// Mailbox: the messages sent to a process, see Runtime::ailSend and Runtime::ailReceive
+//
+
+#ifndef TYPED_SCHEME_MAILBOX_HPP
+#define TYPED_SCHEME_MAILBOX_HPP
+
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+// lock-free multi-producer single-consumer queue (Vyukov's intrusive queue)
+// any process may push, only the owning process pops
+// the first node is a stub, a pop hands the popped node the stub role
+class Mailbox {
+public:
+    Mailbox() : head(new Node()), tail(head.load()) {};
+
+    // a process is only copied before it runs, the copy starts with an empty mailbox
+    Mailbox(const Mailbox &) : Mailbox() {};
+
+    Mailbox &operator=(const Mailbox &) = delete;
+
+    ~Mailbox();
+
+    void push(string message);
+
+    // owner only, returns false when there is no message
+    bool pop(string &message);
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        string message;
+    };
+
+    // producers swap themselves in at the head, the consumer follows the next links from the tail
+    std::atomic<Node *> head;
+    Node *tail;
+};
+
+Mailbox::~Mailbox() {
+    while (this->tail != nullptr) {
+        Node *next = this->tail->next.load(std::memory_order_relaxed);
+        delete this->tail;
+        this->tail = next;
+    }
+}
+
+void Mailbox::push(string message) {
+    Node *node = new Node();
+    node->message = std::move(message);
+    Node *previous = this->head.exchange(node, std::memory_order_acq_rel);
+    // until this store the message is invisible to pop, the sender wakes the receiver only afterwards
+    previous->next.store(node, std::memory_order_release);
+}
+
+bool Mailbox::pop(string &message) {
+    Node *next = this->tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+        return false;
+    }
+
+    message = std::move(next->message);
+    delete this->tail;
+    this->tail = next;
+    return true;
+}
+
+#endif //TYPED_SCHEME_MAILBOX_HPP
@@ -19,6 +19,7 @@
 #include "Analyser.hpp"
 #include "Compiler.hpp"
 #include "Transfer.hpp"
+#include "CompileTrace.hpp"
 
 using namespace std;
 
@@ -48,6 +49,10 @@ public:
     map<string, AST> allASTs;
     vector<pair<string, string>> dependencies;
     vector<string> sortedModuleNames;
+    // the files the module is compiled from, the imported ones and the module's own
+    vector<string> sourcePaths;
+    // the id of the next AST node, every module imported takes its node ids on from here, see NodeArena
+    NodeId nextNodeId = 0;
 
     Module() {};
 
@@ -69,6 +74,14 @@ private:
     void importModuleFromCode(string &code);
 
     void importModule(string &path);
+
+    // lexes, parses and analyses the code of a module
+    AST analyseModule(const string &code, string moduleName, string path);
+
+    // the program from the ASTs of its modules, topModuleName is the module that is run
+    static Module link(Module &module, const string &topModuleName);
+
+    static void dumpNode(AST &ast, const HandleOrStr &hos, int depth, std::ostream &os);
 };
 
 
@@ -77,47 +90,126 @@ Module Module::loadModuleFromCode(string code) {
 
     Module module;
     module.importModuleFromCode(code); //Lexer, parser, analyser
-    module.topologicSort();
-    module.makeImportedNameUnique();
-
-    Module mergeModule;
-    mergeModule.ast = module.allASTs["repl"];
-
-    // -1 to skip the last module
-    // the top module, the module that you run, is always the last module in the sorted list
-    int k = module.sortedModuleNames.size() - 1;
-    for (int i = 0; i < k; i++) {
-        string moduleName = module.sortedModuleNames[i];
-        mergeModule.ast.mergeAST(module.allASTs[moduleName]);
-    }
-
-    mergeModule.ILCode = Compiler::compile(mergeModule.ast);
-
-    return mergeModule;
+    return Module::link(module, "repl");
 }
 
 Module Module::loadModule(string path) {
     boost::trim(path);
     Module module;
     module.importModule(path); //Lexer, parser, analyser
-    module.topologicSort();
-    module.makeImportedNameUnique();
+    return Module::link(module, Module::getModuleNameFromPath(path));
+}
 
+Module Module::link(Module &module, const string &topModuleName) {
     Module mergeModule;
-    mergeModule.ast = module.allASTs[Module::getModuleNameFromPath(path)];
-
-    // -1 to skip the last module
-    // the top module, the module that you run, is always the last module in the sorted list
-    int k = module.sortedModuleNames.size() - 1;
-    for (int i = 0; i < k; i++) {
-        string moduleName = module.sortedModuleNames[i];
-        mergeModule.ast.mergeAST(module.allASTs[moduleName]);
+    {
+        CompileTrace::Phase phase(topModuleName, "merge");
+        module.topologicSort();
+        module.makeImportedNameUnique();
+
+        mergeModule.ast = module.allASTs[topModuleName];
+
+        // -1 to skip the last module
+        // the top module, the module that you run, is always the last module in the sorted list
+        int k = module.sortedModuleNames.size() - 1;
+        for (int i = 0; i < k; i++) {
+            string moduleName = module.sortedModuleNames[i];
+            mergeModule.ast.mergeAST(module.allASTs[moduleName]);
+        }
     }
 
-    mergeModule.ILCode = Compiler::compile(mergeModule.ast);
+    {
+        CompileTrace::Phase phase(topModuleName, "compile");
+        mergeModule.ILCode = Compiler::compile(mergeModule.ast);
+    }
+    if (CompileTrace::isDumping("il")) {
+        for (auto &inst : mergeModule.ILCode) {
+            cout << inst.instructionStr << "\n";
+        }
+    }
+    mergeModule.sourcePaths = module.sourcePaths;
 
     return mergeModule;
+}
+
+AST Module::analyseModule(const string &code, string moduleName, string path) {
+    AST currentAST(code, moduleName, path, this->nextNodeId);
 
+    vector<Lexer::Token> tokens;
+    {
+        CompileTrace::Phase phase(moduleName, "lex");
+        tokens = Lexer::tokenize(code);
+    }
+    if (CompileTrace::isDumping("tokens")) {
+        cout << ";; tokens of " << moduleName << "\n";
+        for (auto &token : tokens) {
+            cout << token;
+        }
+    }
+
+    {
+        CompileTrace::Phase phase(moduleName, "parse");
+        currentAST = Parser::parse(tokens, moduleName, code, currentAST);
+    }
+    currentAST = Analyser::analyse(currentAST);
+    this->nextNodeId = currentAST.nodes.endId();
+
+    if (CompileTrace::isDumping("ast")) {
+        cout << ";; ast of " << moduleName << "\n";
+        Module::dumpNode(currentAST, currentAST.getTopApplicationHandle(), 0, cout);
+        cout << "\n";
+    }
+    return currentAST;
+}
+
+// a node is on one line when its children are atoms or strings, else its children after the first go on lines
+// of their own. a quote, a quasiquote and an unquote are marked by ', ` and , before their parentheses
+void Module::dumpNode(AST &ast, const HandleOrStr &hos, int depth, std::ostream &os) {
+    if (hos.empty() || hos[0] != '&' || !ast.nodes.hasHandle(hos)) {
+        os << hos;
+        return;
+    }
+    auto objPtr = ast.get(hos);
+    if (objPtr->irisObjectType == IrisObjectType::STRING) {
+        os << '"' << static_pointer_cast<StringObject>(objPtr)->content() << '"';
+        return;
+    }
+
+    vector<HandleOrStr> heads;
+    if (objPtr->irisObjectType == IrisObjectType::LAMBDA) {
+        auto lambdaObjPtr = static_pointer_cast<LambdaObject>(objPtr);
+        heads.push_back("lambda");
+        heads.push_back("(" + boost::join(lambdaObjPtr->parameters, " ") + ")");
+    } else if (objPtr->irisObjectType == IrisObjectType::QUOTE) {
+        os << '\'';
+    } else if (objPtr->irisObjectType == IrisObjectType::QUASIQUOTE) {
+        os << '`';
+    } else if (objPtr->irisObjectType == IrisObjectType::UNQUOTE) {
+        os << ',';
+    } else if (objPtr->irisObjectType != IrisObjectType::APPLICATION) {
+        os << hos;
+        return;
+    }
+
+    auto &childrenHoses = IrisObject::getChildrenHosesOrBodies(objPtr);
+    bool hasNodeChild = false;
+    for (auto &childHos : childrenHoses) {
+        hasNodeChild = hasNodeChild || (!childHos.empty() && childHos[0] == '&' && ast.nodes.hasHandle(childHos) &&
+                                        ast.get(childHos)->irisObjectType != IrisObjectType::STRING);
+    }
+
+    os << "(" << boost::join(heads, " ");
+    for (int i = 0; i < childrenHoses.size(); ++i) {
+        if (i == 0) {
+            os << (heads.empty() ? "" : " ");
+        } else if (hasNodeChild) {
+            os << "\n" << string((depth + 1) * 2, ' ');
+        } else {
+            os << " ";
+        }
+        Module::dumpNode(ast, childrenHoses[i], depth + 1, os);
+    }
+    os << ")";
 }
 
 void Module::importModuleFromCode(string &code) {
@@ -125,10 +217,7 @@ void Module::importModuleFromCode(string &code) {
     string moduleName = "repl";
     string path = "repl";
 
-    AST currentAST(code, moduleName, path);
-
-    currentAST = Parser::parse(Lexer::tokenize(code), moduleName, code, currentAST);
-    currentAST = Analyser::analyse(currentAST);
+    AST currentAST = this->analyseModule(code, moduleName, path);
 
     this->allASTs[moduleName] = currentAST;
 
@@ -142,12 +231,10 @@ void Module::importModuleFromCode(string &code) {
 
 void Module::importModule(string &path) {
     string code = this->getFormattedCode(path);
+    this->sourcePaths.push_back(path);
     string moduleName = this->getModuleNameFromPath(path);
 
-    AST currentAST(code, moduleName, path);
-
-    currentAST = Parser::parse(Lexer::tokenize(code), moduleName, code, currentAST);
-    currentAST = Analyser::analyse(currentAST);
+    AST currentAST = this->analyseModule(code, moduleName, path);
 
     this->allASTs[moduleName] = currentAST;
 
@@ -170,11 +257,11 @@ void Module::makeImportedNameUnique() {
     // example: utils.increase -> path.to.utils.increase
     for (auto &[astModuleName, currentAST] : allASTs) {
 
-        for (auto &[handle, schemeObjPtr] : currentAST.heap.dataMap) {
+        for (auto &schemeObjPtr : currentAST.nodes.getNodes()) {
             // only the children of lambda and application will be variable
 
-            if (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA ||
-                schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION) {
+            if (schemeObjPtr != nullptr && (schemeObjPtr->irisObjectType == IrisObjectType::LAMBDA ||
+                                            schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION)) {
                 vector<HandleOrStr> &hoses = IrisObject::getChildrenHosesOrBodies(schemeObjPtr);
 
                 if (!hoses.empty() && hoses[0] != "import") {
@@ -279,19 +366,19 @@ void Module::topologicSort() {
 }
 
 string Module::getFormattedCode(string path) {
-    string code;
-    // read from file
+    // the file is mapped and copied once, into the wrapped code
     try {
-        code = utils::readFileToOneString(path);
+        Lexer::SourceFile sourceFile(path);
+        string prefix = "((lambda () ", suffix = "\n))";
+        string code;
+        code.reserve(prefix.size() + sourceFile.view().size() + suffix.size());
+        code.append(prefix).append(sourceFile.view()).append(suffix);
+        return code;
     } catch (exception &e) {
         cout << "[ERROR] module " + path + "not found" << endl;
         throw "[ERROR] module " + path + "not found";
     }
 
-    code = "((lambda () " + code + "))";
-
-    return code;
-
 }
 
 #endif //TYPED_SCHEME_MODULELOADER_HPP
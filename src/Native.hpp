@@ -0,0 +1,131 @@
+//
+// Native: C++ functions bound under a namespace, called from Iris code after (native namespace)
+//
+
+#ifndef TYPED_SCHEME_NATIVE_HPP
+#define TYPED_SCHEME_NATIVE_HPP
+
+#include "Heap.hpp"
+#include "IrisObject.hpp"
+#include "Utils.hpp"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// the arguments are the operands of the call as they are: numbers and booleans by value, objects by handle
+// a native allocates its result on heap, the heap of the calling process, and reports an error by throwing
+typedef HandleOrStr (*NativeFunctionPtr)(const vector<HandleOrStr> &arguments, Heap &heap, void *data);
+
+struct NativeFunction {
+    string name;
+    // NativeRegistry::VARIADIC takes any number of arguments
+    int arity;
+    NativeFunctionPtr functionPtr;
+    // given back to functionPtr, one C++ function can then serve several names
+    void *data;
+};
+
+// name -> native function, a name is namespace.function, like math.sqrt
+// a program looks its natives up once, when its image is built, and a native instruction then calls through
+// the pointer it holds. a native bound later is looked up by name on each call, bind it before loading the
+// programs that call it to skip that
+class NativeRegistry {
+public:
+    static const int VARIADIC = -1;
+
+    // binding a name again replaces its function
+    static void bind(const string &name, int arity, NativeFunctionPtr functionPtr, void *data = nullptr);
+
+    // nullptr when nothing is bound to name
+    static const NativeFunction *find(const string &name);
+
+    // throws when argument is not a number
+    static double toNumber(const HandleOrStr &argument);
+
+private:
+    inline static std::mutex mutex;
+
+    // map nodes never move, a pointer to a native stays valid while others are bound
+    static map<string, NativeFunction> &functions();
+
+    static map<string, NativeFunction> makeMathFunctions();
+};
+
+void NativeRegistry::bind(const string &name, int arity, NativeFunctionPtr functionPtr, void *data) {
+    std::lock_guard<std::mutex> lock(NativeRegistry::mutex);
+    NativeRegistry::functions()[name] = NativeFunction{name, arity, functionPtr, data};
+}
+
+const NativeFunction *NativeRegistry::find(const string &name) {
+    std::lock_guard<std::mutex> lock(NativeRegistry::mutex);
+    auto &functions = NativeRegistry::functions();
+    auto it = functions.find(name);
+    return it == functions.end() ? nullptr : &it->second;
+}
+
+double NativeRegistry::toNumber(const HandleOrStr &argument) {
+    Type type = typeOfStr(argument);
+    if (type != Type::NUMBER) {
+        throw std::invalid_argument("[TypeError] expects a number, a " + TypeStrMap[type] + " is given");
+    }
+    return stod(argument);
+}
+
+map<string, NativeFunction> &NativeRegistry::functions() {
+    static map<string, NativeFunction> functions = NativeRegistry::makeMathFunctions();
+    return functions;
+}
+
+// the math namespace, bound from the start
+map<string, NativeFunction> NativeRegistry::makeMathFunctions() {
+    // data is the double -> double function of the C library
+    NativeFunctionPtr unary = [](const vector<HandleOrStr> &arguments, Heap &, void *data) -> HandleOrStr {
+        auto function = (double (*)(double)) data;
+        return utils::doubleToStr(function(NativeRegistry::toNumber(arguments[0])));
+    };
+    NativeFunctionPtr pow = [](const vector<HandleOrStr> &arguments, Heap &, void *) -> HandleOrStr {
+        return utils::doubleToStr(std::pow(NativeRegistry::toNumber(arguments[0]),
+                                           NativeRegistry::toNumber(arguments[1])));
+    };
+    // data is not null for max, null for min
+    NativeFunctionPtr extremum = [](const vector<HandleOrStr> &arguments, Heap &, void *data) -> HandleOrStr {
+        if (arguments.empty()) {
+            throw std::invalid_argument("[ArgumentNumberError] expects at least 1 argument, 0 is given");
+        }
+        double sign = data != nullptr ? 1 : -1;
+        double result = NativeRegistry::toNumber(arguments[0]);
+        for (size_t i = 1; i < arguments.size(); ++i) {
+            double number = NativeRegistry::toNumber(arguments[i]);
+            if (sign * number > sign * result) {
+                result = number;
+            }
+        }
+        return utils::doubleToStr(result);
+    };
+
+    map<string, NativeFunction> functions;
+    vector<pair<string, double (*)(double)>> unaryFunctions = {
+            {"math.sqrt",  ::sqrt},
+            {"math.exp",   ::exp},
+            {"math.log",   ::log},
+            {"math.sin",   ::sin},
+            {"math.cos",   ::cos},
+            {"math.floor", ::floor},
+            {"math.ceil",  ::ceil}
+    };
+    for (auto &[name, function] : unaryFunctions) {
+        functions[name] = NativeFunction{name, 1, unary, (void *) function};
+    }
+    functions["math.pow"] = NativeFunction{"math.pow", 2, pow, nullptr};
+    functions["math.max"] = NativeFunction{"math.max", VARIADIC, extremum, (void *) 1};
+    functions["math.min"] = NativeFunction{"math.min", VARIADIC, extremum, nullptr};
+    return functions;
+}
+
+#endif //TYPED_SCHEME_NATIVE_HPP
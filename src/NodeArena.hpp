@@ -0,0 +1,241 @@
+//
+// NodeArena: the nodes of an AST, allocated in bulk and found by the id in their handle
+//
+
+#ifndef TYPED_SCHEME_NODEARENA_HPP
+#define TYPED_SCHEME_NODEARENA_HPP
+
+#include "Heap.hpp"
+#include "IrisObject.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef uint32_t NodeId;
+
+// hands out the memory of one buffer, never gives it back: the buffer is freed as a whole once the last node
+// allocated from it is dropped, every control block holds a copy of the allocator
+template<class T>
+class NodeAllocator {
+public:
+    typedef T value_type;
+
+    shared_ptr<std::pmr::monotonic_buffer_resource> bufferPtr;
+
+    explicit NodeAllocator(shared_ptr<std::pmr::monotonic_buffer_resource> bufferPtr) : bufferPtr(
+            std::move(bufferPtr)) {};
+
+    template<class U>
+    NodeAllocator(const NodeAllocator<U> &other) : bufferPtr(other.bufferPtr) {};
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(this->bufferPtr->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template<class U>
+    bool operator==(const NodeAllocator<U> &other) const { return this->bufferPtr == other.bufferPtr; }
+};
+
+// a handle is &<prefix>.<TYPE>_<id> as on a heap, and the modules of a program take their ids from one counter,
+// see Module::nextNodeId, so an id is unique in the whole program and merged ASTs never collide
+// looking a handle up parses its id and indexes nodes, the node's own handle tells a stale handle apart
+// the nodes of a kind are allocated one after another from one buffer of their own, with their control block.
+// the buffers are shared by the copies of the arena, and freed in one go with the last of them, once the program
+// is compiled: the program image gets copies of the nodes the code refers to, see toHeap
+class NodeArena {
+public:
+    explicit NodeArena(NodeId firstId = 0) : firstId(firstId) {};
+
+    Handle makeLambda(const string &prefix, const Handle &parentHandle);
+
+    Handle makeApplication(const string &prefix, const Handle &parentHandle);
+
+    Handle makeQuote(const string &prefix, const Handle &parentHandle);
+
+    Handle makeQuasiquote(const string &prefix, const Handle &parentHandle);
+
+    Handle makeUnquote(const string &prefix, const Handle &parentHandle);
+
+    Handle makeString(const string &prefix, string content);
+
+    // throws when handle holds no node
+    shared_ptr<IrisObject> get(const Handle &handle) const;
+
+    bool hasHandle(const Handle &handle) const;
+
+    // puts a node of another arena at its id, to merge ASTs
+    void set(const Handle &handle, shared_ptr<IrisObject> nodePtr);
+
+    void deleteHandle(const Handle &handle);
+
+    // by id, a deleted node is left as nullptr
+    const vector<shared_ptr<IrisObject>> &getNodes() const { return this->nodes; };
+
+    // the id of the next node
+    NodeId endId() const { return this->firstId + this->nodes.size(); };
+
+    // copies of the nodes reachable from rootHandles, for the program image. the copies are allocated on their
+    // own and keep no buffer of the arena alive
+    shared_ptr<const Heap> toHeap(const vector<Handle> &rootHandles) const;
+
+private:
+    NodeId firstId;
+    // nodes[id - firstId]
+    vector<shared_ptr<IrisObject>> nodes;
+    map<IrisObjectType, shared_ptr<std::pmr::monotonic_buffer_resource>> buffers;
+
+    template<class T, class... Args>
+    Handle make(const string &prefix, IrisObjectType type, Args &&... args);
+
+    // the index in nodes, -1 when handle is not the handle of a node
+    long indexOf(const Handle &handle) const;
+};
+
+template<class T, class... Args>
+Handle NodeArena::make(const string &prefix, IrisObjectType type, Args &&... args) {
+    auto &bufferPtr = this->buffers[type];
+    if (bufferPtr == nullptr) {
+        bufferPtr = make_shared<std::pmr::monotonic_buffer_resource>();
+    }
+
+    Handle handle = "&" + prefix + "." + IrisObjectTypeStrMap[type] + "_" + to_string(this->endId());
+    shared_ptr<T> nodePtr = std::allocate_shared<T>(NodeAllocator<T>(bufferPtr), std::forward<Args>(args)...);
+    // set here for the strings too, which are made without it, the arena checks the handle of every node
+    nodePtr->IrisObject::selfHandle = handle;
+    this->nodes.push_back(nodePtr);
+    return handle;
+}
+
+Handle NodeArena::makeLambda(const string &prefix, const Handle &parentHandle) {
+    return this->make<LambdaObject>(prefix, IrisObjectType::LAMBDA, parentHandle, "");
+}
+
+Handle NodeArena::makeApplication(const string &prefix, const Handle &parentHandle) {
+    return this->make<ApplicationObject>(prefix, IrisObjectType::APPLICATION, parentHandle, "");
+}
+
+Handle NodeArena::makeQuote(const string &prefix, const Handle &parentHandle) {
+    return this->make<QuoteObject>(prefix, IrisObjectType::QUOTE, parentHandle, "");
+}
+
+Handle NodeArena::makeQuasiquote(const string &prefix, const Handle &parentHandle) {
+    return this->make<QuasiquoteObject>(prefix, IrisObjectType::QUASIQUOTE, parentHandle, "");
+}
+
+Handle NodeArena::makeUnquote(const string &prefix, const Handle &parentHandle) {
+    return this->make<UnquoteObject>(prefix, IrisObjectType::UNQUOTE, parentHandle, "");
+}
+
+Handle NodeArena::makeString(const string &prefix, string content) {
+    return this->make<StringObject>(prefix, IrisObjectType::STRING, std::move(content));
+}
+
+long NodeArena::indexOf(const Handle &handle) const {
+    size_t digitsStart = handle.size();
+    while (digitsStart > 0 && isdigit(handle[digitsStart - 1])) {
+        digitsStart--;
+    }
+    if (digitsStart == handle.size() || digitsStart == 0 || handle[digitsStart - 1] != '_' ||
+        handle.size() - digitsStart > 9) {
+        return -1;
+    }
+
+    long id = 0;
+    std::from_chars(handle.data() + digitsStart, handle.data() + handle.size(), id);
+    long index = id - (long) this->firstId;
+    if (index < 0 || index >= (long) this->nodes.size() || this->nodes[index] == nullptr ||
+        this->nodes[index]->selfHandle != handle) {
+        return -1;
+    }
+    return index;
+}
+
+shared_ptr<IrisObject> NodeArena::get(const Handle &handle) const {
+    long index = this->indexOf(handle);
+    if (index < 0) {
+        throw std::runtime_error("[ERROR] handle holds nothing -- NodeArena::get");
+    }
+    return this->nodes[index];
+}
+
+bool NodeArena::hasHandle(const Handle &handle) const {
+    return this->indexOf(handle) >= 0;
+}
+
+void NodeArena::set(const Handle &handle, shared_ptr<IrisObject> nodePtr) {
+    size_t digitsStart = handle.find_last_of('_') + 1;
+    NodeId id = stoul(handle.substr(digitsStart));
+    if (id < this->firstId) {
+        this->nodes.insert(this->nodes.begin(), this->firstId - id, nullptr);
+        this->firstId = id;
+    } else if (id >= this->endId()) {
+        this->nodes.resize(id - this->firstId + 1);
+    }
+    this->nodes[id - this->firstId] = std::move(nodePtr);
+}
+
+void NodeArena::deleteHandle(const Handle &handle) {
+    long index = this->indexOf(handle);
+    if (index >= 0) {
+        this->nodes[index] = nullptr;
+    }
+}
+
+shared_ptr<const Heap> NodeArena::toHeap(const vector<Handle> &rootHandles) const {
+    auto heapPtr = make_shared<Heap>();
+    vector<HandleOrStr> pendingHoses(rootHandles.begin(), rootHandles.end());
+    while (!pendingHoses.empty()) {
+        HandleOrStr hos = std::move(pendingHoses.back());
+        pendingHoses.pop_back();
+        long index = this->indexOf(hos);
+        if (index < 0 || heapPtr->ownsHandle(hos)) {
+            continue;
+        }
+
+        auto &nodePtr = this->nodes[index];
+        shared_ptr<IrisObject> copyPtr;
+        switch (nodePtr->irisObjectType) {
+            case IrisObjectType::LAMBDA:
+                copyPtr = make_shared<LambdaObject>(*static_pointer_cast<LambdaObject>(nodePtr));
+                break;
+            case IrisObjectType::APPLICATION:
+                copyPtr = make_shared<ApplicationObject>(*static_pointer_cast<ApplicationObject>(nodePtr));
+                break;
+            case IrisObjectType::QUOTE:
+                copyPtr = make_shared<QuoteObject>(*static_pointer_cast<QuoteObject>(nodePtr));
+                break;
+            case IrisObjectType::QUASIQUOTE:
+                copyPtr = make_shared<QuasiquoteObject>(*static_pointer_cast<QuasiquoteObject>(nodePtr));
+                break;
+            case IrisObjectType::UNQUOTE:
+                copyPtr = make_shared<UnquoteObject>(*static_pointer_cast<UnquoteObject>(nodePtr));
+                break;
+            case IrisObjectType::STRING:
+                copyPtr = make_shared<StringObject>(*static_pointer_cast<StringObject>(nodePtr));
+                break;
+            default:
+                throw std::runtime_error("[ERROR] not a node of the AST -- NodeArena::toHeap");
+        }
+        heapPtr->set(hos, copyPtr);
+
+        if (nodePtr->irisObjectType != IrisObjectType::STRING) {
+            auto &childrenHoses = IrisObject::getChildrenHosesOrBodies(nodePtr);
+            pendingHoses.insert(pendingHoses.end(), childrenHoses.begin(), childrenHoses.end());
+        }
+    }
+    // the handles the runtime makes go on from the ids
+    heapPtr->handleCounter = this->endId();
+    return heapPtr;
+}
+
+#endif //TYPED_SCHEME_NODEARENA_HPP
@@ -0,0 +1,540 @@
+//
+// Bulk kernels for the homogeneous numeric vectors (f64vector, s64vector)
+//
+
+#ifndef TYPED_SCHEME_NUMERICKERNELS_HPP
+#define TYPED_SCHEME_NUMERICKERNELS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IRIS_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Every kernel has a scalar version, and the hot ones also have a SSE2 and an AVX2 version.
+// The SIMD level is picked once at startup with cpuid (__builtin_cpu_supports), and can be
+// lowered with IRISSIMD=scalar|sse2|avx2 to check the fallbacks.
+// AVX2 functions are compiled with the target attribute, so no -mavx2 is needed for the whole program.
+namespace NumericKernels {
+
+    enum class SimdLevel {
+        SCALAR, SSE2, AVX2
+    };
+
+    enum class Op {
+        ADD, SUB, MUL, DIV
+    };
+
+    enum class Cmp {
+        EQ, LT, GT, LE, GE
+    };
+
+    SimdLevel detectSimdLevel() {
+        SimdLevel level = SimdLevel::SCALAR;
+#ifdef IRIS_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            level = SimdLevel::AVX2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            level = SimdLevel::SSE2;
+        }
+#endif
+        const char *override = getenv("IRISSIMD");
+        if (override != nullptr) {
+            std::string name = override;
+            SimdLevel wanted = name == "scalar" ? SimdLevel::SCALAR : name == "sse2" ? SimdLevel::SSE2 : SimdLevel::AVX2;
+            // never go above what the cpu supports
+            level = std::min(level, wanted);
+        }
+        return level;
+    }
+
+    const SimdLevel simdLevel = detectSimdLevel();
+
+    // integers are computed as unsigned and cast back, so they wrap like the SIMD lanes
+    // instead of overflowing (signed overflow is undefined behaviour)
+    template<typename T>
+    using Arith = typename std::conditional_t<std::is_integral_v<T>, std::make_unsigned<T>, std::type_identity<T>>::type;
+
+    template<typename T>
+    inline T applyOp(Op op, T a, T b) {
+        switch (op) {
+            case Op::ADD:
+                return T(Arith<T>(a) + Arith<T>(b));
+            case Op::SUB:
+                return T(Arith<T>(a) - Arith<T>(b));
+            case Op::MUL:
+                return T(Arith<T>(a) * Arith<T>(b));
+            default:
+                return a / b;
+        }
+    }
+
+    template<typename T>
+    inline bool applyCmp(Cmp cmp, T a, T b) {
+        switch (cmp) {
+            case Cmp::EQ:
+                return a == b;
+            case Cmp::LT:
+                return a < b;
+            case Cmp::GT:
+                return a > b;
+            case Cmp::LE:
+                return a <= b;
+            default:
+                return a >= b;
+        }
+    }
+
+    //=================================================================
+    //                          Scalar
+    //=================================================================
+
+    template<typename T>
+    void binaryScalar(Op op, const T *a, const T *b, T *out, size_t from, size_t n) {
+        for (size_t i = from; i < n; ++i) {
+            out[i] = applyOp(op, a[i], b[i]);
+        }
+    }
+
+    template<typename T>
+    void compareScalar(Cmp cmp, const T *a, const T *b, int64_t *out, size_t from, size_t n) {
+        for (size_t i = from; i < n; ++i) {
+            out[i] = applyCmp(cmp, a[i], b[i]) ? 1 : 0;
+        }
+    }
+
+    template<typename T>
+    T sumScalar(const T *a, size_t n) {
+        Arith<T> sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += Arith<T>(a[i]);
+        }
+        return T(sum);
+    }
+
+    template<typename T>
+    T dotScalar(const T *a, const T *b, size_t n) {
+        Arith<T> sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += Arith<T>(a[i]) * Arith<T>(b[i]);
+        }
+        return T(sum);
+    }
+
+    template<typename T>
+    T minScalar(const T *a, size_t n) {
+        return *std::min_element(a, a + n);
+    }
+
+    template<typename T>
+    T maxScalar(const T *a, size_t n) {
+        return *std::max_element(a, a + n);
+    }
+
+#ifdef IRIS_SIMD_X86
+    //=================================================================
+    //                          SSE2
+    //=================================================================
+
+    size_t binaryF64Sse2(Op op, const double *a, const double *b, double *out, size_t n) {
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(a + i);
+            __m128d y = _mm_loadu_pd(b + i);
+            __m128d r;
+            switch (op) {
+                case Op::ADD:
+                    r = _mm_add_pd(x, y);
+                    break;
+                case Op::SUB:
+                    r = _mm_sub_pd(x, y);
+                    break;
+                case Op::MUL:
+                    r = _mm_mul_pd(x, y);
+                    break;
+                default:
+                    r = _mm_div_pd(x, y);
+                    break;
+            }
+            _mm_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+
+    size_t binaryS64Sse2(Op op, const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+        // SSE2 only has 64-bit add and sub
+        if (op != Op::ADD && op != Op::SUB) {
+            return 0;
+        }
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+            __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+            __m128i r = op == Op::ADD ? _mm_add_epi64(x, y) : _mm_sub_epi64(x, y);
+            _mm_storeu_si128((__m128i *) (out + i), r);
+        }
+        return i;
+    }
+
+    size_t compareF64Sse2(Cmp cmp, const double *a, const double *b, int64_t *out, size_t n) {
+        const __m128i one = _mm_set1_epi64x(1);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(a + i);
+            __m128d y = _mm_loadu_pd(b + i);
+            __m128d mask;
+            switch (cmp) {
+                case Cmp::EQ:
+                    mask = _mm_cmpeq_pd(x, y);
+                    break;
+                case Cmp::LT:
+                    mask = _mm_cmplt_pd(x, y);
+                    break;
+                case Cmp::GT:
+                    mask = _mm_cmpgt_pd(x, y);
+                    break;
+                case Cmp::LE:
+                    mask = _mm_cmple_pd(x, y);
+                    break;
+                default:
+                    mask = _mm_cmpge_pd(x, y);
+                    break;
+            }
+            _mm_storeu_si128((__m128i *) (out + i), _mm_and_si128(_mm_castpd_si128(mask), one));
+        }
+        return i;
+    }
+
+    double sumF64Sse2(const double *a, size_t n) {
+        __m128d acc = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            acc = _mm_add_pd(acc, _mm_loadu_pd(a + i));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1] + sumScalar(a + i, n - i);
+    }
+
+    double dotF64Sse2(const double *a, const double *b, size_t n) {
+        __m128d acc = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1] + dotScalar(a + i, b + i, n - i);
+    }
+
+    // n >= 2
+    double minMaxF64Sse2(const double *a, size_t n, bool isMin) {
+        __m128d acc = _mm_loadu_pd(a);
+        size_t i = 2;
+        for (; i + 2 <= n; i += 2) {
+            __m128d x = _mm_loadu_pd(a + i);
+            acc = isMin ? _mm_min_pd(acc, x) : _mm_max_pd(acc, x);
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        double result = isMin ? std::min(lanes[0], lanes[1]) : std::max(lanes[0], lanes[1]);
+        for (; i < n; ++i) {
+            result = isMin ? std::min(result, a[i]) : std::max(result, a[i]);
+        }
+        return result;
+    }
+
+    //=================================================================
+    //                          AVX2
+    //=================================================================
+
+    __attribute__((target("avx2")))
+    size_t binaryF64Avx2(Op op, const double *a, const double *b, double *out, size_t n) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            __m256d y = _mm256_loadu_pd(b + i);
+            __m256d r;
+            switch (op) {
+                case Op::ADD:
+                    r = _mm256_add_pd(x, y);
+                    break;
+                case Op::SUB:
+                    r = _mm256_sub_pd(x, y);
+                    break;
+                case Op::MUL:
+                    r = _mm256_mul_pd(x, y);
+                    break;
+                default:
+                    r = _mm256_div_pd(x, y);
+                    break;
+            }
+            _mm256_storeu_pd(out + i, r);
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    size_t binaryS64Avx2(Op op, const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+        // there is no 64-bit multiply before AVX-512
+        if (op != Op::ADD && op != Op::SUB) {
+            return 0;
+        }
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+            __m256i r = op == Op::ADD ? _mm256_add_epi64(x, y) : _mm256_sub_epi64(x, y);
+            _mm256_storeu_si256((__m256i *) (out + i), r);
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    size_t compareF64Avx2(Cmp cmp, const double *a, const double *b, int64_t *out, size_t n) {
+        const __m256i one = _mm256_set1_epi64x(1);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            __m256d y = _mm256_loadu_pd(b + i);
+            __m256d mask;
+            switch (cmp) {
+                case Cmp::EQ:
+                    mask = _mm256_cmp_pd(x, y, _CMP_EQ_OQ);
+                    break;
+                case Cmp::LT:
+                    mask = _mm256_cmp_pd(x, y, _CMP_LT_OQ);
+                    break;
+                case Cmp::GT:
+                    mask = _mm256_cmp_pd(x, y, _CMP_GT_OQ);
+                    break;
+                case Cmp::LE:
+                    mask = _mm256_cmp_pd(x, y, _CMP_LE_OQ);
+                    break;
+                default:
+                    mask = _mm256_cmp_pd(x, y, _CMP_GE_OQ);
+                    break;
+            }
+            _mm256_storeu_si256((__m256i *) (out + i), _mm256_and_si256(_mm256_castpd_si256(mask), one));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    size_t compareS64Avx2(Cmp cmp, const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+        const __m256i one = _mm256_set1_epi64x(1);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+            __m256i mask;
+            switch (cmp) {
+                case Cmp::EQ:
+                    mask = _mm256_cmpeq_epi64(x, y);
+                    break;
+                case Cmp::LT:
+                    mask = _mm256_cmpgt_epi64(y, x);
+                    break;
+                case Cmp::GT:
+                    mask = _mm256_cmpgt_epi64(x, y);
+                    break;
+                case Cmp::LE:
+                    // x <= y  is  !(x > y)
+                    mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(x, y), _mm256_set1_epi64x(-1));
+                    break;
+                default:
+                    mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(y, x), _mm256_set1_epi64x(-1));
+                    break;
+            }
+            _mm256_storeu_si256((__m256i *) (out + i), _mm256_and_si256(mask, one));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    double sumF64Avx2(const double *a, size_t n) {
+        __m256d acc = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumScalar(a + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    int64_t sumS64Avx2(const int64_t *a, size_t n) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i *) (a + i)));
+        }
+        int64_t lanes[5];
+        _mm256_storeu_si256((__m256i *) lanes, acc);
+        lanes[4] = sumScalar(a + i, n - i);
+        return sumScalar(lanes, 5);
+    }
+
+    __attribute__((target("avx2")))
+    double dotF64Avx2(const double *a, const double *b, size_t n) {
+        __m256d acc = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dotScalar(a + i, b + i, n - i);
+    }
+
+    // n >= 4
+    __attribute__((target("avx2")))
+    double minMaxF64Avx2(const double *a, size_t n, bool isMin) {
+        __m256d acc = _mm256_loadu_pd(a);
+        size_t i = 4;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            acc = isMin ? _mm256_min_pd(acc, x) : _mm256_max_pd(acc, x);
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        double result = lanes[0];
+        for (int k = 1; k < 4; ++k) {
+            result = isMin ? std::min(result, lanes[k]) : std::max(result, lanes[k]);
+        }
+        for (; i < n; ++i) {
+            result = isMin ? std::min(result, a[i]) : std::max(result, a[i]);
+        }
+        return result;
+    }
+#endif
+
+    //=================================================================
+    //                          Dispatch
+    //=================================================================
+
+    // out may alias a or b
+    void binary(Op op, const double *a, const double *b, double *out, size_t n) {
+        size_t done = 0;
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            done = binaryF64Avx2(op, a, b, out, n);
+        } else if (simdLevel == SimdLevel::SSE2) {
+            done = binaryF64Sse2(op, a, b, out, n);
+        }
+#endif
+        binaryScalar(op, a, b, out, done, n);
+    }
+
+    void binary(Op op, const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+        size_t done = 0;
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            done = binaryS64Avx2(op, a, b, out, n);
+        } else if (simdLevel == SimdLevel::SSE2) {
+            done = binaryS64Sse2(op, a, b, out, n);
+        }
+#endif
+        binaryScalar(op, a, b, out, done, n);
+    }
+
+    void compare(Cmp cmp, const double *a, const double *b, int64_t *out, size_t n) {
+        size_t done = 0;
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            done = compareF64Avx2(cmp, a, b, out, n);
+        } else if (simdLevel == SimdLevel::SSE2) {
+            done = compareF64Sse2(cmp, a, b, out, n);
+        }
+#endif
+        compareScalar(cmp, a, b, out, done, n);
+    }
+
+    void compare(Cmp cmp, const int64_t *a, const int64_t *b, int64_t *out, size_t n) {
+        size_t done = 0;
+#ifdef IRIS_SIMD_X86
+        // 64-bit integer compare needs SSE4.2, so SSE2 machines take the scalar loop
+        if (simdLevel == SimdLevel::AVX2) {
+            done = compareS64Avx2(cmp, a, b, out, n);
+        }
+#endif
+        compareScalar(cmp, a, b, out, done, n);
+    }
+
+    double sum(const double *a, size_t n) {
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            return sumF64Avx2(a, n);
+        } else if (simdLevel == SimdLevel::SSE2) {
+            return sumF64Sse2(a, n);
+        }
+#endif
+        return sumScalar(a, n);
+    }
+
+    int64_t sum(const int64_t *a, size_t n) {
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            return sumS64Avx2(a, n);
+        }
+#endif
+        return sumScalar(a, n);
+    }
+
+    double dot(const double *a, const double *b, size_t n) {
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            return dotF64Avx2(a, b, n);
+        } else if (simdLevel == SimdLevel::SSE2) {
+            return dotF64Sse2(a, b, n);
+        }
+#endif
+        return dotScalar(a, b, n);
+    }
+
+    int64_t dot(const int64_t *a, const int64_t *b, size_t n) {
+        return dotScalar(a, b, n);
+    }
+
+    // n > 0
+    double min(const double *a, size_t n) {
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2 && n >= 4) {
+            return minMaxF64Avx2(a, n, true);
+        } else if (simdLevel >= SimdLevel::SSE2 && n >= 2) {
+            return minMaxF64Sse2(a, n, true);
+        }
+#endif
+        return minScalar(a, n);
+    }
+
+    double max(const double *a, size_t n) {
+#ifdef IRIS_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2 && n >= 4) {
+            return minMaxF64Avx2(a, n, false);
+        } else if (simdLevel >= SimdLevel::SSE2 && n >= 2) {
+            return minMaxF64Sse2(a, n, false);
+        }
+#endif
+        return maxScalar(a, n);
+    }
+
+    int64_t min(const int64_t *a, size_t n) {
+        return minScalar(a, n);
+    }
+
+    int64_t max(const int64_t *a, size_t n) {
+        return maxScalar(a, n);
+    }
+}
+
+#endif //TYPED_SCHEME_NUMERICKERNELS_HPP
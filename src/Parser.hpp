@@ -28,7 +28,8 @@ public:
 
     // One Parser has one AST !!!
     AST ast;
-    vector<Lexer::Token> tokens;
+    // the tokens point into the code, which outlives the parser
+    const vector<Lexer::Token> &tokens;
 
     int parseTerm(int index);
 
@@ -42,7 +43,10 @@ public:
 
     void parseLog(const string &msg);
 
-    bool isSymbol(const string &tokenStr);
+    bool isSymbol(const Lexer::Token &token);
+
+    // what typeOfStr would say of the token's text
+    static Type typeOfToken(const Lexer::Token &token);
 
     int parseLambda(int index);
 
@@ -78,6 +82,8 @@ public:
 
     int parseSListSeq(int index);
 
+    int parseVector(int index);
+
     void preProcessAnalysis();
 
 };
@@ -92,6 +98,10 @@ AST Parser::parse(const vector<Lexer::Token> &tokens, const string &moduleName,
 }
 
 int Parser::parseTerm(int index) {
+    if (index + 1 >= this->tokens.size()) {
+        // a term is at least one token and something closes it
+        throw runtime_error("<Term> unexpected end of code, a ')' is missing");
+    }
     int nextIndex;
     string quoteState = this->stateStack.empty() ? "" : this->stateStack.back();
 
@@ -111,18 +121,21 @@ int Parser::parseTerm(int index) {
     } else if (this->tokens[index].string == "(") {
         this->parseLog("<Term> → <SList>");
         return this->parseSList(index);
-    } else if (isSymbol(this->tokens[index].string)) {
+    } else if (this->tokens[index].string == "#(") {
+        this->parseLog("<Term> → <Vector>");
+        return this->parseVector(index);
+    } else if (isSymbol(this->tokens[index])) {
         this->parseLog("<Term> → <Symbol>");
         return this->parseSymbol(index);
     } else {
-        throw runtime_error("undefined token " + this->tokens[index].string);
+        throw runtime_error("undefined token " + string(this->tokens[index].string));
     }
 }
 
 int Parser::parseLambda(int index) {
     this->parseLog("<Lambda> → ( ※ lambda <ArgList> <Body> )");
 
-    Handle lambdaHandle = this->ast.heap.makeLambda(this->ast.moduleName, this->nodeStack.back());
+    Handle lambdaHandle = this->ast.nodes.makeLambda(this->ast.moduleName, this->nodeStack.back());
     this->nodeStack.push_back(lambdaHandle);
 
     this->ast.setHandleSourceIndexMapping(lambdaHandle, tokens[index].sourceIndex);
@@ -159,13 +172,13 @@ int Parser::parseArgList(int index) {
 
 int Parser::parseArgListSeq(int index) {
     this->parseLog("<ArgListSeq> → <ArgSymbol> ※ <ArgListSeq> | ε");
-    if (this->isSymbol(tokens[index].string)) {
+    if (this->isSymbol(tokens[index])) {
         int nextIndex = this->parseArgSymbol(index);
 
         // get symbol from nodeStack, and add it to the parameters of lambda node
         string parameter = this->nodeStack.back();
         this->nodeStack.pop_back();
-        auto lambdaObjPtr = static_pointer_cast<LambdaObject>(this->ast.heap.get(this->nodeStack.back()));
+        auto lambdaObjPtr = static_pointer_cast<LambdaObject>(this->ast.nodes.get(this->nodeStack.back()));
         if (!lambdaObjPtr->addParameter(parameter)) {
             throw runtime_error("two parameter will same name");
         }
@@ -187,7 +200,7 @@ int Parser::parseBody(int index) {
 
     HandleOrStr bodyHos = this->nodeStack.back();
     this->nodeStack.pop_back();
-    static_pointer_cast<LambdaObject>(this->ast.heap.get(this->nodeStack.back()))->addBody(bodyHos);
+    static_pointer_cast<LambdaObject>(this->ast.nodes.get(this->nodeStack.back()))->addBody(bodyHos);
 
     nextIndex = this->parseBodyTail(nextIndex);
     return nextIndex;
@@ -195,14 +208,13 @@ int Parser::parseBody(int index) {
 
 int Parser::parseBodyTail(int index) {
     this->parseLog("<Body_> → <BodyTerm> ※ <Body_> | ε");
-    string currentToken = tokens[index].string;
-    if (currentToken == "(" || currentToken == "'" || currentToken == "," ||
-        currentToken == "`" || isSymbol(currentToken)) {
+    // every token but ) starts a term
+    if (tokens[index].kind != Lexer::TokenKind::RIGHT_PAREN) {
         int nextIndex = this->parseBodyTerm(index);
 
         HandleOrStr bodyHos = this->nodeStack.back();
         this->nodeStack.pop_back();
-        static_pointer_cast<LambdaObject>(this->ast.heap.get(this->nodeStack.back()))->addBody(bodyHos);
+        static_pointer_cast<LambdaObject>(this->ast.nodes.get(this->nodeStack.back()))->addBody(bodyHos);
 
         nextIndex = this->parseBodyTail(nextIndex);
         return nextIndex;
@@ -230,7 +242,7 @@ int Parser::parseQuote(int index) {
 
 int Parser::parseQuoteTerm(int index) {
     this->parseLog("<QuoteTerm> → <Term>");
-    Handle sListHandle = this->ast.heap.makeQuote(this->ast.moduleName, this->nodeStack.back());
+    Handle sListHandle = this->ast.nodes.makeQuote(this->ast.moduleName, this->nodeStack.back());
 
     this->nodeStack.push_back(sListHandle);
 
@@ -240,8 +252,8 @@ int Parser::parseQuoteTerm(int index) {
     HandleOrStr childHos = nodeStack.back();
     nodeStack.pop_back();
 
-//    static_pointer_cast<QuoteObject>(this->ast.heap.get(sListHandle))->addChild("quote");
-    static_pointer_cast<QuoteObject>(this->ast.heap.get(sListHandle))->addChild(childHos);
+//    static_pointer_cast<QuoteObject>(this->ast.nodes.get(sListHandle))->addChild("quote");
+    static_pointer_cast<QuoteObject>(this->ast.nodes.get(sListHandle))->addChild(childHos);
 
     return nextIndex;
 }
@@ -279,7 +291,9 @@ int Parser::parseQuasiquoteTerm(int index) {
 int Parser::parseSList(int index) {
     parseLog("<SList> → ( ※ <SListSeq> )");
 
-    if(this->tokens[index + 1].string == "quote") {
+    // only pop the QUOTE state pushed here, the nested lists of a quote are still quoted
+    bool isQuoteApplication = this->tokens[index + 1].string == "quote";
+    if(isQuoteApplication) {
         this->stateStack.push_back("QUOTE");
     }
 
@@ -289,13 +303,13 @@ int Parser::parseSList(int index) {
 
 
     if (quoteType == "QUOTE") {
-        sListHandle = this->ast.heap.makeQuote(this->ast.moduleName, this->nodeStack.back());
+        sListHandle = this->ast.nodes.makeQuote(this->ast.moduleName, this->nodeStack.back());
     } else if (quoteType == "QUASIQUOTE") {
-        sListHandle = this->ast.heap.makeQuasiquote(this->ast.moduleName, this->nodeStack.back());
+        sListHandle = this->ast.nodes.makeQuasiquote(this->ast.moduleName, this->nodeStack.back());
     } else if (quoteType == "UNQUOTE") {
-        sListHandle = this->ast.heap.makeUnquote(this->ast.moduleName, this->nodeStack.back());
+        sListHandle = this->ast.nodes.makeUnquote(this->ast.moduleName, this->nodeStack.back());
     } else {
-        sListHandle = this->ast.heap.makeApplication(this->ast.moduleName, this->nodeStack.back());
+        sListHandle = this->ast.nodes.makeApplication(this->ast.moduleName, this->nodeStack.back());
     }
 
     this->nodeStack.push_back(sListHandle);
@@ -303,7 +317,7 @@ int Parser::parseSList(int index) {
     this->ast.setHandleSourceIndexMapping(sListHandle, tokens[index].sourceIndex);
     int nextIndex = this->parseSListSeq(index + 1);
 
-    if(quoteType == "QUOTE") {
+    if(isQuoteApplication) {
         this->stateStack.pop_back();
     }
 
@@ -322,10 +336,7 @@ int Parser::parseSListSeq(int index) {
         throw runtime_error("<SList> left ) is not found");
     }
 
-    auto currentTokenStr = this->tokens[index].string;
-
-    if (currentTokenStr == "(" || currentTokenStr == "'" || currentTokenStr == "," ||
-        currentTokenStr == "`" || this->isSymbol(currentTokenStr)) {
+    if (this->tokens[index].kind != Lexer::TokenKind::RIGHT_PAREN) {
         int nextIndex = this->parseTerm(index);
 
         // Action：从节点栈顶弹出节点，追加到新栈顶节点的children中。
@@ -333,13 +344,13 @@ int Parser::parseSListSeq(int index) {
         nodeStack.pop_back();
 
         if (quoteType == "QUOTE") {
-            static_pointer_cast<QuoteObject>(this->ast.heap.get(this->nodeStack.back()))->addChild(childHos);
+            static_pointer_cast<QuoteObject>(this->ast.nodes.get(this->nodeStack.back()))->addChild(childHos);
         } else if (quoteType == "QUASIQUOTE") {
-            static_pointer_cast<QuasiquoteObject>(this->ast.heap.get(this->nodeStack.back()))->addChild(childHos);
+            static_pointer_cast<QuasiquoteObject>(this->ast.nodes.get(this->nodeStack.back()))->addChild(childHos);
         } else if (quoteType == "UNQUOTE") {
-            static_pointer_cast<UnquoteObject>(this->ast.heap.get(this->nodeStack.back()))->addChild(childHos);
+            static_pointer_cast<UnquoteObject>(this->ast.nodes.get(this->nodeStack.back()))->addChild(childHos);
         } else {
-            static_pointer_cast<ApplicationObject>(this->ast.heap.get(this->nodeStack.back()))->addChild(childHos);
+            static_pointer_cast<ApplicationObject>(this->ast.nodes.get(this->nodeStack.back()))->addChild(childHos);
         }
 
         nextIndex = this->parseSListSeq(nextIndex);
@@ -349,18 +360,48 @@ int Parser::parseSListSeq(int index) {
     }
 }
 
+// #(e0 e1 ...) is read as the application (vector 'e0 'e1 ...), the elements are quoted like in a quote
+int Parser::parseVector(int index) {
+    parseLog("<Vector> → #( ※ <SListSeq> )");
+
+    Handle vectorHandle = this->ast.nodes.makeApplication(this->ast.moduleName, this->nodeStack.back());
+    auto vectorAppObjPtr = static_pointer_cast<ApplicationObject>(this->ast.nodes.get(vectorHandle));
+    vectorAppObjPtr->addChild("vector");
+
+    this->nodeStack.push_back(vectorHandle);
+    this->ast.setHandleSourceIndexMapping(vectorHandle, tokens[index].sourceIndex);
+
+    this->stateStack.push_back("QUOTE");
+    int nextIndex = index + 1;
+    while (nextIndex < this->tokens.size() && this->tokens[nextIndex].string != ")") {
+        nextIndex = this->parseTerm(nextIndex);
+
+        HandleOrStr childHos = nodeStack.back();
+        nodeStack.pop_back();
+        vectorAppObjPtr->addChild(childHos);
+    }
+    this->stateStack.pop_back();
+
+    if (nextIndex < this->tokens.size()) {
+        return nextIndex + 1;
+    } else {
+        throw runtime_error("<Vector> left ) is not found");
+    }
+}
+
 int Parser::parseSymbol(int index) {
-    string currentTokenStr = tokens[index].string;
-    if (isSymbol(currentTokenStr)) {
+    string currentTokenStr(tokens[index].string);
+    if (isSymbol(tokens[index])) {
         // Action
         string state = this->stateStack.empty() ? "" : this->stateStack.back();
-        Type type = typeOfStr(currentTokenStr);
+        Type type = Parser::typeOfToken(tokens[index]);
         if (state == "QUOTE" || state == "QUASIQUOTE") {
             // NUMBER and string in quote are not affected
             if (type == Type::NUMBER) {
                 this->nodeStack.push_back(currentTokenStr);
             } else if (type == Type::STRING) {
-                Handle stringHandle = this->ast.heap.makeString(this->ast.moduleName, currentTokenStr);
+                Handle stringHandle = this->ast.nodes.makeString(this->ast.moduleName,
+                                                                tokens[index].stringContent());
                 this->nodeStack.push_back(stringHandle);
                 this->ast.setHandleSourceIndexMapping(stringHandle, tokens[index].sourceIndex);
             } else if (type == Type::SYMBOL) {
@@ -382,7 +423,8 @@ int Parser::parseSymbol(int index) {
             else if (type == Type::NUMBER) {
                 this->nodeStack.push_back(currentTokenStr);
             } else if (type == Type::STRING) {
-                Handle stringHandle = this->ast.heap.makeString(this->ast.moduleName, currentTokenStr);
+                Handle stringHandle = this->ast.nodes.makeString(this->ast.moduleName,
+                                                                tokens[index].stringContent());
                 this->nodeStack.push_back(stringHandle);
                 this->ast.setHandleSourceIndexMapping(stringHandle, tokens[index].sourceIndex);
             } else if (type == Type::VARIABLE || type == Type::KEYWORD || type == Type::BOOLEAN || type == Type::PORT) {
@@ -395,7 +437,8 @@ int Parser::parseSymbol(int index) {
             if (type == Type::NUMBER) {
                 this->nodeStack.push_back(currentTokenStr);
             } else if (type == Type::STRING) {
-                Handle stringHandle = this->ast.heap.makeString(this->ast.moduleName, currentTokenStr);
+                Handle stringHandle = this->ast.nodes.makeString(this->ast.moduleName,
+                                                                tokens[index].stringContent());
                 this->nodeStack.push_back(stringHandle);
                 this->ast.setHandleSourceIndexMapping(stringHandle, tokens[index].sourceIndex);
             } else if (type == Type::SYMBOL) {
@@ -417,20 +460,56 @@ void Parser::parseLog(const string &msg) {
 //    cout << msg << endl;
 }
 
-bool Parser::isSymbol(const string &tokenStr) {
-    if (tokenStr == "(" || tokenStr == ")") {
-        return false;
-    } else if (tokenStr[0] == '\'' || tokenStr[0] == '`' || tokenStr[0] == ',') {
-        // shouldn't starts with \' \` and \,
-        return false;
+bool Parser::isSymbol(const Lexer::Token &token) {
+    switch (token.kind) {
+        case Lexer::TokenKind::LEFT_PAREN:
+        case Lexer::TokenKind::RIGHT_PAREN:
+        case Lexer::TokenKind::VECTOR_OPEN:
+        case Lexer::TokenKind::QUOTE:
+        case Lexer::TokenKind::QUASIQUOTE:
+        case Lexer::TokenKind::UNQUOTE:
+            return false;
+        default:
+            // Others are symbol
+            return true;
+    }
+}
+
+Type Parser::typeOfToken(const Lexer::Token &token) {
+    if (token.kind == Lexer::TokenKind::NUMBER) {
+        return Type::NUMBER;
+    } else if (token.kind == Lexer::TokenKind::STRING) {
+        return Type::STRING;
+    } else if (token.kind == Lexer::TokenKind::BOOLEAN) {
+        return Type::BOOLEAN;
+    }
+
+    // a name, the lexer has ruled out the literals
+    string name(token.string);
+    if (KEYWORDS.count(name) != 0) {
+        return Type::KEYWORD;
+    } else if (name == "lambda") {
+        return Type::LAMBDA;
+    } else if (name[0] == ':') {
+        return Type::PORT;
+    } else if (name[0] == '&') {
+        return Type::HANDLE;
+    } else if (name[0] == '@') {
+        return Type::LABEL;
     } else {
-        // Others are symbol
-        return true;
+        return Type::VARIABLE;
     }
 }
 
 void Parser::preProcessAnalysis() {
-    for (auto &[handle, schemeObjPtr] : this->ast.heap.dataMap) {
+    // by index, a node is added on the way
+    auto &nodes = this->ast.nodes.getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        shared_ptr<IrisObject> schemeObjPtr = nodes[i];
+        if (schemeObjPtr == nullptr) {
+            continue;
+        }
+        Handle handle = schemeObjPtr->selfHandle;
         // Handle the import
         // (import Alias Path)
         if (schemeObjPtr->irisObjectType == IrisObjectType::APPLICATION) {
@@ -439,9 +518,7 @@ void Parser::preProcessAnalysis() {
 
                 if (applicationObjPtr->childrenHoses.size() == 2) {
                     string stdLibPath = utils::getStdLibPath(applicationObjPtr->childrenHoses[1]);
-                    Handle stringHandle = ast.makeString(stdLibPath, handle);
-                    auto stringObjPtr = static_pointer_cast<StringObject>(ast.get(stringHandle));
-                    stringObjPtr->content = '"' + stdLibPath + '"';
+                    Handle stringHandle = ast.makeString(stdLibPath, handle, stdLibPath);
                     applicationObjPtr->addChild(stringHandle);
                 }
 
@@ -456,10 +533,9 @@ void Parser::preProcessAnalysis() {
                     Handle modulePathHandle = applicationObjPtr->childrenHoses[2];
 
                     // get the string from handle: handle -> /path/to/module
-                    auto stringObjptr = this->ast.heap.get(modulePathHandle);
+                    auto stringObjptr = this->ast.nodes.get(modulePathHandle);
                     if (stringObjptr->irisObjectType == IrisObjectType::STRING) {
-                        string modulePath = static_pointer_cast<StringObject>(stringObjptr)->content;
-                        modulePath = modulePath.substr(1, modulePath.size() - 2); // trim " on both side
+                        string modulePath(static_pointer_cast<StringObject>(stringObjptr)->content());
 
                         // set the alias and the path
                         this->ast.moduleAliasPathMap[moduleAlias] = modulePath;
@@ -473,7 +549,6 @@ void Parser::preProcessAnalysis() {
                 } else {
                     string native = applicationObjPtr->childrenHoses[1];
                     this->ast.natives[native] = "enabled";
-                    // TODO: how to define native call?
                 }
             }
         }
@@ -0,0 +1,282 @@
+//
+// Printer: writes the textual representation of a runtime value into an OutputSink
+//
+
+#ifndef TYPED_SCHEME_PRINTER_HPP
+#define TYPED_SCHEME_PRINTER_HPP
+
+#include "IrisObject.hpp"
+#include "Heap.hpp"
+#include "Utils.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+#include <unordered_set>
+
+// characters are collected in a fixed buffer and handed to the stream in large chunks,
+// without a stream the sink only accumulates into buffer
+class OutputSink {
+public:
+    explicit OutputSink(std::ostream *streamPtr = nullptr) : streamPtr(streamPtr) {};
+
+    ~OutputSink() { this->flush(); };
+
+    string buffer;
+
+    void write(char c);
+
+    void write(string_view str);
+
+    void writeNumber(double number);
+
+    void writeNumber(int64_t number);
+
+    // hands the buffered characters to the stream, the stream itself is not flushed
+    void flush();
+
+private:
+    static const size_t CAPACITY = 1 << 14;
+
+    std::ostream *streamPtr;
+
+    void reserve(size_t size);
+};
+
+void OutputSink::write(char c) {
+    this->reserve(1);
+    this->buffer.push_back(c);
+}
+
+void OutputSink::write(string_view str) {
+    this->reserve(str.size());
+    this->buffer.append(str);
+}
+
+// same format as Runtime::doubleToStr, integral numbers without decimals, others with 6 decimals
+void OutputSink::writeNumber(double number) {
+    if (utils::double_is_int(number) && std::fabs(number) < 1e18) {
+        this->writeNumber((int64_t) number);
+        return;
+    }
+
+    char digits[512];
+    int size = snprintf(digits, sizeof(digits), "%f", number);
+    this->write(string_view(digits, size));
+}
+
+void OutputSink::writeNumber(int64_t number) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    this->write(string_view(digits, result.ptr - digits));
+}
+
+void OutputSink::flush() {
+    if (this->streamPtr != nullptr && !this->buffer.empty()) {
+        this->streamPtr->write(this->buffer.data(), this->buffer.size());
+        this->buffer.clear();
+    }
+}
+
+void OutputSink::reserve(size_t size) {
+    if (this->streamPtr != nullptr && this->buffer.size() + size > CAPACITY) {
+        this->flush();
+    }
+}
+
+// prints lists, vectors and hash tables with an explicit stack instead of recursion, so nesting depth
+// is bounded by maxDepth rather than by the C++ stack
+// a container that is already being printed (a vector containing itself) is printed as "#<cycle>"
+class Printer {
+public:
+    Printer(Heap &heap, OutputSink &sink) : heap(heap), sink(sink) {};
+
+    size_t maxDepth = 10000;
+
+    void print(const HandleOrStr &hos);
+
+private:
+    enum class FrameKind {
+        SEQUENCE, HASHTABLE, PAIR
+    };
+
+    // SEQUENCE walks hosesPtr (or hoses when it is null) from index, HASHTABLE walks the keys and the values
+    // in hoses two at a time from index, PAIR prints the key and the value in hoses as (key . value).
+    // vectors and hash tables may be set by other workers, so hoses keeps a copy taken under their lock
+    struct Frame {
+        FrameKind kind;
+        shared_ptr<IrisObject> objectPtr;
+        const vector<HandleOrStr> *hosesPtr = nullptr;
+        vector<HandleOrStr> hoses;
+        size_t index = 0;
+        bool isFirst = true;
+    };
+
+    Heap &heap;
+    OutputSink &sink;
+    vector<Frame> stack;
+    unordered_set<const IrisObject *> objectsBeingPrinted;
+
+    // writes hos, or opens a frame for it when it is a container
+    void printValue(const HandleOrStr &hos);
+
+    void printAtom(const HandleOrStr &hos, const shared_ptr<IrisObject> &objectPtr);
+
+    void popFrame();
+};
+
+void Printer::print(const HandleOrStr &hos) {
+    this->printValue(hos);
+
+    while (!this->stack.empty()) {
+        Frame &frame = this->stack.back();
+
+        if (frame.kind == FrameKind::HASHTABLE) {
+            if (frame.index == frame.hoses.size()) {
+                this->popFrame();
+                continue;
+            }
+
+            this->sink.write(frame.isFirst ? "(" : " (");
+            frame.isFirst = false;
+            Frame pairFrame{FrameKind::PAIR, nullptr, nullptr, {frame.hoses[frame.index], frame.hoses[frame.index + 1]}, 0, true};
+            frame.index += 2;
+            this->stack.push_back(std::move(pairFrame));
+            continue;
+        }
+
+        HandleOrStr next;
+        if (frame.kind == FrameKind::PAIR) {
+            if (frame.index == 2) {
+                this->popFrame();
+                continue;
+            }
+            if (frame.index == 1) {
+                this->sink.write(" . ");
+            }
+            next = frame.hoses[frame.index];
+        } else {
+            const vector<HandleOrStr> &hoses = frame.hosesPtr != nullptr ? *frame.hosesPtr : frame.hoses;
+            if (frame.index == hoses.size()) {
+                this->popFrame();
+                continue;
+            }
+            if (!frame.isFirst) {
+                this->sink.write(' ');
+            }
+            frame.isFirst = false;
+            next = hoses[frame.index];
+        }
+        frame.index++;
+
+        // may push a new frame, frame must not be used after this
+        this->printValue(next);
+    }
+}
+
+void Printer::printValue(const HandleOrStr &hos) {
+    if (typeOfStr(hos) != Type::HANDLE) {
+        this->sink.write(hos);
+        return;
+    }
+
+    auto objectPtr = this->heap.get(hos);
+    IrisObjectType type = objectPtr->irisObjectType;
+    if (type != IrisObjectType::LIST && type != IrisObjectType::QUOTE && type != IrisObjectType::VECTOR &&
+        type != IrisObjectType::HASHTABLE) {
+        this->printAtom(hos, objectPtr);
+        return;
+    }
+
+    if (this->objectsBeingPrinted.count(objectPtr.get())) {
+        this->sink.write("#<cycle>");
+        return;
+    }
+    if (this->stack.size() >= this->maxDepth) {
+        this->sink.write("...");
+        return;
+    }
+
+    Frame frame{FrameKind::SEQUENCE, objectPtr, nullptr, {}, 0, true};
+    if (type == IrisObjectType::LIST) {
+        int offset;
+        Heap::splitListView(hos, offset);
+        frame.hosesPtr = &static_pointer_cast<ListObject>(objectPtr)->childrenHoses;
+        frame.index = offset;
+        this->sink.write('(');
+    } else if (type == IrisObjectType::QUOTE) {
+        frame.hosesPtr = &static_pointer_cast<QuoteObject>(objectPtr)->childrenHoses;
+        this->sink.write('(');
+    } else if (type == IrisObjectType::VECTOR) {
+        auto vectorObjPtr = static_pointer_cast<VectorObject>(objectPtr);
+        {
+            std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+            frame.hoses = vectorObjPtr->elements;
+        }
+        this->sink.write("#(");
+    } else {
+        frame.kind = FrameKind::HASHTABLE;
+        auto hashTableObjPtr = static_pointer_cast<HashTableObject>(objectPtr);
+        {
+            std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+            for (auto &slot : hashTableObjPtr->slots) {
+                if (slot.state == HashTableObject::SlotState::FULL) {
+                    frame.hoses.push_back(slot.key);
+                    frame.hoses.push_back(slot.value);
+                }
+            }
+        }
+        this->sink.write("#hash(");
+    }
+    this->objectsBeingPrinted.insert(objectPtr.get());
+    this->stack.push_back(std::move(frame));
+}
+
+void Printer::printAtom(const HandleOrStr &hos, const shared_ptr<IrisObject> &objectPtr) {
+    if (objectPtr->irisObjectType == IrisObjectType::STRING) {
+        this->sink.write('"');
+        this->sink.write(static_pointer_cast<StringObject>(objectPtr)->content());
+        this->sink.write('"');
+    } else if (objectPtr->irisObjectType == IrisObjectType::CLOSURE) {
+        this->sink.write("<lambda: ");
+        this->sink.write(hos);
+        this->sink.write(" >");
+    } else if (objectPtr->irisObjectType == IrisObjectType::F64VECTOR) {
+        this->sink.write("#f64(");
+        auto vectorObjPtr = static_pointer_cast<F64VectorObject>(objectPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        auto &elements = vectorObjPtr->elements;
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (i != 0) {
+                this->sink.write(' ');
+            }
+            this->sink.writeNumber(elements[i]);
+        }
+        this->sink.write(')');
+    } else if (objectPtr->irisObjectType == IrisObjectType::S64VECTOR) {
+        this->sink.write("#s64(");
+        auto vectorObjPtr = static_pointer_cast<S64VectorObject>(objectPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        auto &elements = vectorObjPtr->elements;
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (i != 0) {
+                this->sink.write(' ');
+            }
+            this->sink.writeNumber(elements[i]);
+        }
+        this->sink.write(')');
+    } else {
+        this->sink.write(hos);
+        this->sink.write(' ');
+        this->sink.write(irisObjectTypeToStr(objectPtr->irisObjectType));
+    }
+}
+
+void Printer::popFrame() {
+    this->sink.write(')');
+    this->objectsBeingPrinted.erase(this->stack.back().objectPtr.get());
+    this->stack.pop_back();
+}
+
+#endif //TYPED_SCHEME_PRINTER_HPP
@@ -12,6 +12,12 @@
 #include "ModuleLoader.hpp"
 #include "IrisObject.hpp"
 #include "Heap.hpp"
+#include "Mailbox.hpp"
+#include "ProgramImage.hpp"
+#include "ProcessLimits.hpp"
+
+#include <atomic>
+#include <chrono>
 
 using namespace std;
 
@@ -21,6 +27,27 @@ enum class ProcessState {
     READY, RUNNING, SLEEPING, SUSPENDED, STOPPED
 };
 
+// the scheduler serves the run queue of a higher priority first
+enum class ProcessPriority {
+    HIGH, NORMAL, LOW
+};
+
+// a sleeping process is parked by its worker once its slice is over, while messages and timers may try to wake it
+// at the same time, see Scheduler::park and Scheduler::wake
+enum class ParkState {
+    RUNNABLE, PARKED, NOTIFIED
+};
+
+class ParkFlag {
+public:
+    std::atomic<ParkState> state{ParkState::RUNNABLE};
+
+    ParkFlag() = default;
+
+    // a process is only copied before it runs
+    ParkFlag(const ParkFlag &) {};
+};
+
 
 class StackFrame {
 public:
@@ -31,24 +58,83 @@ public:
     int returnAddress;
 };
 
-class Process {
+class Process;
+
+// a parallel-map or parallel-reduce cut into chunks, every chunk is run by a process of its own
+// see Runtime::ailParallelMap
+class ParallelJob {
+public:
+    bool isReduce = false;
+    // the function is a closure, or the name of a primitive when closurePtr is null
+    shared_ptr<Closure> closurePtr;
+    string primitive;
+    vector<HandleOrStr> inputs;
+    // map: one result per input, reduce: one result per chunk. a chunk only writes its own results
+    vector<HandleOrStr> results;
+    std::atomic<int> pendingChunks{0};
+    Process *parentPtr = nullptr;
+    // the error of the first chunk stopped by a ResourceLimitError, the parent raises it
+    std::mutex errorMutex;
+    string error;
+};
+
+class Process : public std::enable_shared_from_this<Process> {
 
 public:
     vector<string> opStack;
     vector<StackFrame> fStack;
-    vector<Instruction> instructions;
-    map<string, int> labelAddressMap;
+    // the code never changes once loaded, all the processes of a program share it
+    shared_ptr<const ProgramImage> image;
     ProcessState state = ProcessState::READY;
-    Heap heap;
-    AST ast;
+    // processes forked from the same program share one heap, like green threads, on top of the image's literals
+    // the workers running them may touch the same vector or hash table, see VectorObject::mutex
+    shared_ptr<Heap> heap;
     PID pid = 0;
     int PC = 0;
     std::shared_ptr<Closure> currentClosurePtr;
-
-    Process(PID newPid, const Module &module);
-
-    Instruction currentInstruction();
-    Instruction nextInstruction();
+    // state of the variadic argument collection in Runtime::ailStore and Runtime::popOperandsToPushend
+    vector<string> pushendStack;
+    bool pushendMode = false;
+    ProcessPriority priority = ProcessPriority::NORMAL;
+    // instructions per time slice, 0 for the budget of the runtime
+    int reductionBudget = 0;
+    ProcessLimits limits;
+    int64_t executedInstructions = 0;
+    // the ResourceLimitError that stopped the process, empty when it ran to its end
+    string error;
+    Mailbox mailbox;
+    ParkFlag parkFlag;
+    // in the process of a chunk: the job, and the inputs [chunkBegin, chunkEnd) of the chunk
+    shared_ptr<ParallelJob> chunkJobPtr;
+    size_t chunkIndex = 0;
+    size_t chunkBegin = 0;
+    size_t chunkEnd = 0;
+    size_t chunkNext = 0;
+    HandleOrStr accumulator;
+    // in a process waiting for its parallel-map or parallel-reduce
+    shared_ptr<ParallelJob> joinedJobPtr;
+    // the future this process resolves when its thunk returns
+    shared_ptr<FutureObject> futurePtr;
+    // set while a touch waits for its future
+    shared_ptr<FutureObject> touchedFuturePtr;
+    // the operands of an instruction waiting for I/O, it runs again with them when the process wakes
+    vector<HandleOrStr> suspendedOperands;
+    bool isResuming = false;
+    // set while a receive waits for a message, the receive instruction runs again each time the process wakes
+    bool isReceiving = false;
+    std::chrono::steady_clock::time_point receiveDeadline;
+    // set by sleep and after, a process woken earlier goes back to sleep at the start of its slice
+    std::chrono::steady_clock::time_point sleepDeadline;
+
+    Process(PID newPid, shared_ptr<const ProgramImage> image);
+
+    // a process running closurePtr's code, it shares the code and the heap of parentProcess,
+    // or runs on heap when one is given
+    Process(PID newPid, const Process &parentProcess, shared_ptr<Closure> closurePtr, shared_ptr<Heap> heap = nullptr);
+
+    const Instruction &currentInstruction() const;
+
+    const Instruction &nextInstruction() const;
 
     inline void step() { this->PC++; };
 
@@ -56,6 +142,12 @@ public:
 
     void pushStackFrame(shared_ptr<Closure> closurePtr, int returnAddress);
 
+    inline void checkCallDepth() {
+        if (this->fStack.size() >= this->limits.maxCallDepth) {
+            throw ResourceLimitError("the call stack is deeper than " + to_string(this->limits.maxCallDepth));
+        }
+    };
+
     StackFrame popStackFrame();
 
     void pushOperand(const string &value);
@@ -71,59 +163,56 @@ public:
     void setCurrentClosure(Handle closureHandle);
 
     void gotoAddress(int instructionAddress);
-
-private:
-    void initLabelLineMap();
-
 };
 
-//=================================================================
-//                    Preprocess
-//=================================================================
-void Process::initLabelLineMap() {
-    // Label is normally the indication of beginning of a function (lambda)
-    // this mapping represents the mapping between the label and the sourceIndex of the corresponding instructionStr
-    for (int i = 0; i < this->instructions.size(); ++i) {
-        Instruction instruction = this->instructions[i];
-        if (instruction.type == InstructionType::LABEL) {
-            this->labelAddressMap[instruction.instructionStr] = i;
-        }
-    }
-}
-
 
 
 //=================================================================
 //                    PROCESS
 //=================================================================
 
-Instruction Process::currentInstruction() {
-    return this->instructions[PC];
+const Instruction &Process::currentInstruction() const {
+    return this->image->instructions[PC];
 }
 
-Instruction Process::nextInstruction(){
-    return this->instructions[PC + 1];
+const Instruction &Process::nextInstruction() const {
+    return this->image->instructions[PC + 1];
 }
 
-Process::Process(PID newPid, const Module &module) {
+Process::Process(PID newPid, shared_ptr<const ProgramImage> image) : image(std::move(image)) {
     this->pid = newPid;
 
-    // from module loader loads instructionStr (string -> instructionStr)
-    for (auto &i : module.ILCode) {
-        this->instructions.emplace_back(Instruction(i));
-    }
-
     // The top closure (not need to worry about this, because this is just a lambda (closure) acted as a beginner
     // > at the top of everything
     this->currentClosurePtr = std::shared_ptr<Closure>(new Closure(-1, nullptr, TOP_NODE_HANDLE));
-    this->heap = module.ast.heap;
-    this->ast = module.ast;
-    this->heap.set(TOP_NODE_HANDLE, this->currentClosurePtr);
-
-    this->initLabelLineMap();
+    this->heap = make_shared<Heap>(this->image->literalHeap);
+    this->heap->set(TOP_NODE_HANDLE, this->currentClosurePtr);
 };
 
+// nothing is copied but the closure and the priority and budget: the child starts with empty stacks at the closure's first instruction,
+// and stops when the closure returns
+Process::Process(PID newPid, const Process &parentProcess, shared_ptr<Closure> closurePtr, shared_ptr<Heap> heap) {
+    this->pid = newPid;
+    this->image = parentProcess.image;
+    this->heap = heap != nullptr ? std::move(heap) : parentProcess.heap;
+    this->priority = parentProcess.priority;
+    this->reductionBudget = parentProcess.reductionBudget;
+    this->limits = parentProcess.limits;
+
+    // a closure of its own, so that the variables the thunk stores don't clobber the parent's
+    Handle closureHandle = this->heap->allocateHandle(IrisObjectType::CLOSURE);
+    auto childClosurePtr = make_shared<Closure>(*closurePtr);
+    childClosurePtr->selfHandle = closureHandle;
+    this->heap->set(closureHandle, childClosurePtr);
+
+    this->currentClosurePtr = childClosurePtr;
+    this->PC = childClosurePtr->instructionAddress;
+}
+
 void Process::pushOperand(const string &value) {
+    if (this->opStack.size() >= this->limits.maxOperandStackDepth) {
+        throw ResourceLimitError("the operand stack is deeper than " + to_string(this->limits.maxOperandStackDepth));
+    }
     this->opStack.push_back(value);
 }
 
@@ -140,6 +229,7 @@ string Process::popOperand() {
 // Process Closure related
 
 void Process::pushStackFrame(std::shared_ptr<Closure> closurePtr, int returnAddress) {
+    this->checkCallDepth();
     StackFrame sf(closurePtr, returnAddress);
     this->fStack.push_back(sf);
 }
@@ -155,6 +245,7 @@ StackFrame Process::popStackFrame() {
 }
 
 void Process::pushCurrentClosure(int returnAddress) {
+    this->checkCallDepth();
     StackFrame sf(this->currentClosurePtr, returnAddress);
     this->fStack.push_back(sf);
 }
@@ -197,14 +288,14 @@ string Process::dereference(const string &variableName) {
 }
 
 Handle Process::newClosure(int instructionAddress) {
-    Handle newClosureHandle = this->heap.allocateHandle(IrisObjectType::CLOSURE);
-    this->heap.set(newClosureHandle, std::shared_ptr<Closure>(
+    Handle newClosureHandle = this->heap->allocateHandle(IrisObjectType::CLOSURE);
+    this->heap->set(newClosureHandle, std::shared_ptr<Closure>(
             new Closure(instructionAddress, this->currentClosurePtr, newClosureHandle)));
     return newClosureHandle;
 }
 
 shared_ptr<Closure> Process::getClosurePtr(Handle closureHandle) {
-    auto schemeObjectPtr = this->heap.get(closureHandle);
+    auto schemeObjectPtr = this->heap->get(closureHandle);
     if (schemeObjectPtr->irisObjectType == IrisObjectType::CLOSURE) {
         return static_pointer_cast<Closure>(schemeObjectPtr);
     } else {
@@ -0,0 +1,54 @@
+//
+// ProcessLimits: the bounds on what a process may use
+//
+
+#ifndef TYPED_SCHEME_PROCESSLIMITS_HPP
+#define TYPED_SCHEME_PROCESSLIMITS_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// a process went past one of its limits. Runtime::schedule stops that process alone, reports the error, and
+// passes it on to what waits for the process: the touchers of its future, the parent of its chunk
+class ResourceLimitError : public std::runtime_error {
+public:
+    explicit ResourceLimitError(const string &message) : std::runtime_error(message) {};
+};
+
+// the max of each type for no bound, so a check is a single comparison
+// a forked process gets the limits of its parent, and counts its instructions from 0
+struct ProcessLimits {
+    // instructions executed in the life of the process
+    int64_t maxInstructions = std::numeric_limits<int64_t>::max();
+    // bytes of the process's heap, which the processes forked from it share, see Heap::account
+    size_t maxHeapBytes = std::numeric_limits<size_t>::max();
+    size_t maxOperandStackDepth = std::numeric_limits<size_t>::max();
+    // frames of the call stack
+    size_t maxCallDepth = std::numeric_limits<size_t>::max();
+
+    // IRISMAXINSTRUCTIONS, IRISMAXHEAPBYTES, IRISMAXOPERANDS and IRISMAXCALLDEPTH, unset or 0 for no bound
+    static ProcessLimits fromEnvironment();
+};
+
+ProcessLimits ProcessLimits::fromEnvironment() {
+    auto readEnv = [](const char *name, auto &limit) {
+        const char *value = std::getenv(name);
+        if (value != nullptr && std::atoll(value) > 0) {
+            limit = std::atoll(value);
+        }
+    };
+
+    ProcessLimits limits;
+    readEnv("IRISMAXINSTRUCTIONS", limits.maxInstructions);
+    readEnv("IRISMAXHEAPBYTES", limits.maxHeapBytes);
+    readEnv("IRISMAXOPERANDS", limits.maxOperandStackDepth);
+    readEnv("IRISMAXCALLDEPTH", limits.maxCallDepth);
+    return limits;
+}
+
+#endif //TYPED_SCHEME_PROCESSLIMITS_HPP
@@ -0,0 +1,137 @@
+//
+// ProgramCache: compiled program images by source, a script is compiled once for each of its versions
+//
+
+#ifndef TYPED_SCHEME_PROGRAMCACHE_HPP
+#define TYPED_SCHEME_PROGRAMCACHE_HPP
+
+#include "ProgramImage.hpp"
+#include "ModuleLoader.hpp"
+#include "Utils.hpp"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// code is keyed by the hash of its content, a file by its path. an entry also keeps the hash of every file
+// its image is compiled from, its imports included, and a hit whose files changed since is compiled again
+// an image is never written, a hit shares it and only a fresh process is made to run it
+// the least recently used entry goes when there are more than capacity
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity = 256) : capacity(capacity) {};
+
+    // compiles code on a miss
+    shared_ptr<const ProgramImage> getFromCode(const string &code);
+
+    // compiles the file on a miss
+    shared_ptr<const ProgramImage> getFromFile(const string &path);
+
+    size_t size();
+
+    void clear();
+
+private:
+    struct Entry {
+        // the code of getFromCode, two sources may share a hash
+        string source;
+        // path -> hash of the content of the file when it was compiled
+        vector<pair<string, size_t>> fileHashes;
+        shared_ptr<const ProgramImage> image;
+        list<string>::iterator useIterator{};
+    };
+
+    size_t capacity;
+    std::mutex mutex;
+    unordered_map<string, Entry> entries;
+    // the keys of the entries, the least recently used first
+    list<string> useOrder;
+
+    shared_ptr<const ProgramImage> get(const string &key, const string &source, const function<Module()> &compile);
+
+    static bool isUpToDate(const Entry &entry);
+
+    static size_t hashFile(const string &path);
+};
+
+shared_ptr<const ProgramImage> ProgramCache::getFromCode(const string &code) {
+    string key = "code:" + to_string(std::hash<string>()(code));
+    return this->get(key, code, [&code]() { return Module::loadModuleFromCode(code); });
+}
+
+shared_ptr<const ProgramImage> ProgramCache::getFromFile(const string &path) {
+    return this->get("file:" + path, "", [&path]() { return Module::loadModule(path); });
+}
+
+shared_ptr<const ProgramImage> ProgramCache::get(const string &key, const string &source,
+                                                 const function<Module()> &compile) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->entries.find(key);
+        if (it != this->entries.end() && it->second.source == source && ProgramCache::isUpToDate(it->second)) {
+            this->useOrder.splice(this->useOrder.end(), this->useOrder, it->second.useIterator);
+            return it->second.image;
+        }
+    }
+
+    // compiled without the lock, a miss doesn't hold up the hits of other scripts
+    Module module = compile();
+    Entry entry{source, {}, make_shared<const ProgramImage>(module)};
+    for (auto &path : module.sourcePaths) {
+        entry.fileHashes.emplace_back(path, ProgramCache::hashFile(path));
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->entries.find(key);
+    if (it != this->entries.end()) {
+        this->useOrder.erase(it->second.useIterator);
+        this->entries.erase(it);
+    }
+    entry.useIterator = this->useOrder.insert(this->useOrder.end(), key);
+    auto image = entry.image;
+    this->entries.emplace(key, std::move(entry));
+
+    while (this->entries.size() > this->capacity) {
+        this->entries.erase(this->useOrder.front());
+        this->useOrder.pop_front();
+    }
+    return image;
+}
+
+bool ProgramCache::isUpToDate(const Entry &entry) {
+    for (auto &[path, hash] : entry.fileHashes) {
+        try {
+            if (ProgramCache::hashFile(path) != hash) {
+                return false;
+            }
+        } catch (std::exception &e) {
+            // removed since, compiling again reports it
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ProgramCache::hashFile(const string &path) {
+    Lexer::SourceFile sourceFile(path);
+    return std::hash<string_view>()(sourceFile.view());
+}
+
+size_t ProgramCache::size() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->entries.size();
+}
+
+void ProgramCache::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->entries.clear();
+    this->useOrder.clear();
+}
+
+#endif //TYPED_SCHEME_PROGRAMCACHE_HPP
@@ -0,0 +1,75 @@
+//
+// ProgramImage: the compiled code of a program, shared by all of its processes
+//
+
+#ifndef TYPED_SCHEME_PROGRAMIMAGE_HPP
+#define TYPED_SCHEME_PROGRAMIMAGE_HPP
+
+#include "Instruction.hpp"
+#include "Heap.hpp"
+#include "ModuleLoader.hpp"
+#include "Native.hpp"
+#include "CompileTrace.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// built once from a module and never written afterwards, so processes on any worker read it without locks
+// a process owns only its stacks and the objects it creates, see Heap's base heap
+class ProgramImage {
+public:
+    explicit ProgramImage(const Module &module);
+
+    vector<Instruction> instructions;
+
+    // label -> address of the instruction, a label starts the code of a lambda
+    map<string, int> labelAddressMap;
+
+    // the objects of the AST the instructions refer to: quotes and string literals, and what they hold
+    shared_ptr<const Heap> literalHeap;
+
+    // the label of the top lambda, the top level of the program is its body
+    string topLambdaLabel;
+
+    // name -> unique name of the definitions of the top level
+    map<string, string> definedVarOriginUniqueNameMap;
+};
+
+// the link phase of the compiler, the dump of the bytecode is the instructions by address
+ProgramImage::ProgramImage(const Module &module) {
+    CompileTrace::Phase phase(module.ast.moduleName, "link");
+    this->instructions = module.ILCode;
+    this->topLambdaLabel = "@" + module.ast.getTopLambdaHandle();
+    this->definedVarOriginUniqueNameMap = module.ast.definedVarOriginUniqueNameMap;
+
+    for (size_t i = 0; i < this->instructions.size(); ++i) {
+        Instruction &instruction = this->instructions[i];
+        if (instruction.type == InstructionType::LABEL) {
+            this->labelAddressMap[instruction.instructionStr] = i;
+        } else if (instruction.mnemonic == "native") {
+            // an unbound native is an error when it is called, not when the program is loaded
+            instruction.nativeFunctionPtr = NativeRegistry::find(instruction.argument);
+        }
+    }
+
+    vector<Handle> literalHandles;
+    for (auto &instruction : this->instructions) {
+        if (instruction.argumentType == InstructionArgumentType::HANDLE) {
+            literalHandles.push_back(instruction.argument);
+        }
+    }
+    this->literalHeap = module.ast.nodes.toHeap(literalHandles);
+
+    if (CompileTrace::isDumping("bytecode")) {
+        for (size_t i = 0; i < this->instructions.size(); ++i) {
+            cout << std::setw(6) << i << "  " << this->instructions[i].instructionStr << "\n";
+        }
+    }
+}
+
+#endif //TYPED_SCHEME_PROGRAMIMAGE_HPP
@@ -112,8 +112,7 @@ void REPL::start() {
                 Module module = Module::loadModuleFromCode(repl.allCode + inputCode);
 
                 Runtime runtime(OutputMode::BUFFERED);
-                Process process0 = runtime.createProcess(module);
-                runtime.addProcess(process0);
+                runtime.addProcess(runtime.createProcess(module));
                 runtime.schedule();
 
                 //flush
@@ -124,6 +123,8 @@ void REPL::start() {
                 if (repl.inputBufferHasSideEffect()) {
                     repl.allCode += repl.bufferToString();
                 }
+            } catch (utils::ScriptError &e) {
+                // printed by raiseError
             } catch (exception &e) {
                 cout << e.what() << endl;
             }
@@ -0,0 +1,154 @@
+//
+// Reactor: wakes the processes waiting for their file descriptors, with epoll
+//
+
+#ifndef TYPED_SCHEME_REACTOR_HPP
+#define TYPED_SCHEME_REACTOR_HPP
+
+#include "Process.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+// a process waits for one descriptor at a time, several processes may wait for the same one, like the processes
+// accepting on one listener. an event wakes all of them and each retries its call, the ones that find nothing
+// wait again. interests are one-shot: an event wakes a process once, it registers again if it has to wait again
+class Reactor {
+public:
+    Reactor();
+
+    ~Reactor();
+
+    Reactor(const Reactor &) = delete;
+
+    Reactor &operator=(const Reactor &) = delete;
+
+    // events are EPOLLIN or EPOLLOUT
+    void waitFor(int fd, uint32_t events, Process *processPtr);
+
+    // called before fd is closed
+    void forget(int fd);
+
+    bool hasWaiters();
+
+    // waits up to timeoutMs (-1 for no limit) and calls wake on the processes whose descriptor is ready
+    void poll(int timeoutMs, const function<void(Process *)> &wake);
+
+    // makes a poll in progress, or the next one, return at once
+    void interrupt();
+
+private:
+    int epollFd;
+    int interruptFd;
+
+    struct Waiters {
+        vector<Process *> processes;
+        // the events of all the processes, EPOLLIN, EPOLLOUT or both
+        uint32_t events = 0;
+    };
+
+    std::mutex waitersMutex;
+    map<int, Waiters> waiters;
+    std::atomic<int> waiterCount{0};
+    // the descriptors added to epollFd, the others are added on their first wait
+    set<int> registeredFds;
+};
+
+Reactor::Reactor() {
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->interruptFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->epollFd < 0 || this->interruptFd < 0) {
+        throw std::runtime_error("[Reactor] cannot create the epoll instance");
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = this->interruptFd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->interruptFd, &event);
+}
+
+Reactor::~Reactor() {
+    close(this->interruptFd);
+    close(this->epollFd);
+}
+
+void Reactor::waitFor(int fd, uint32_t events, Process *processPtr) {
+    std::lock_guard<std::mutex> lock(this->waitersMutex);
+    Waiters &fdWaiters = this->waiters[fd];
+    if (std::find(fdWaiters.processes.begin(), fdWaiters.processes.end(), processPtr) == fdWaiters.processes.end()) {
+        fdWaiters.processes.push_back(processPtr);
+        this->waiterCount++;
+    }
+    fdWaiters.events |= events;
+
+    epoll_event event{};
+    event.events = fdWaiters.events | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (this->registeredFds.insert(fd).second) {
+        epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event);
+    } else {
+        epoll_ctl(this->epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+}
+
+void Reactor::forget(int fd) {
+    std::lock_guard<std::mutex> lock(this->waitersMutex);
+    auto it = this->waiters.find(fd);
+    if (it != this->waiters.end()) {
+        this->waiterCount -= (int) it->second.processes.size();
+        this->waiters.erase(it);
+    }
+    if (this->registeredFds.erase(fd)) {
+        epoll_ctl(this->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+bool Reactor::hasWaiters() {
+    return this->waiterCount > 0;
+}
+
+void Reactor::poll(int timeoutMs, const function<void(Process *)> &wake) {
+    epoll_event events[64];
+    int eventCount = epoll_wait(this->epollFd, events, 64, timeoutMs);
+
+    vector<Process *> readyProcesses;
+    {
+        std::lock_guard<std::mutex> lock(this->waitersMutex);
+        for (int i = 0; i < eventCount; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == this->interruptFd) {
+                uint64_t count;
+                while (read(this->interruptFd, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+
+            auto it = this->waiters.find(fd);
+            if (it != this->waiters.end()) {
+                auto &processes = it->second.processes;
+                readyProcesses.insert(readyProcesses.end(), processes.begin(), processes.end());
+                this->waiterCount -= (int) processes.size();
+                this->waiters.erase(it);
+            }
+        }
+    }
+
+    for (auto processPtr : readyProcesses) {
+        wake(processPtr);
+    }
+}
+
+void Reactor::interrupt() {
+    uint64_t one = 1;
+    ssize_t written = write(this->interruptFd, &one, sizeof(one));
+    (void) written;
+}
+
+#endif //TYPED_SCHEME_REACTOR_HPP
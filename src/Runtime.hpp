@@ -4,12 +4,25 @@
 #include "Process.hpp"
 #include "ModuleLoader.hpp"
 #include "IrisObject.hpp"
+#include "NumericKernels.hpp"
+#include "Printer.hpp"
+#include "Scheduler.hpp"
 
 #include <string>
 #include <map>
+#include <set>
 #include <queue>
 #include <stdexcept>
 #include <cmath>
+#include <climits>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 using namespace std;
 
@@ -21,28 +34,41 @@ enum class OutputMode {
     BUFFERED, UNBUFFERED
 };
 
+// instructions a process runs before the scheduler switches to another one
+const int DEFAULT_REDUCTION_BUDGET = 2000;
+
 class Runtime {
 public:
-    map<PID, std::shared_ptr<Process>> processPool;
-    queue<std::shared_ptr<Process>> processQueue;
+    // shared by the runtimes of all workers, each worker runs its processes on its own copy of the runtime
+    std::shared_ptr<Scheduler> scheduler;
     std::shared_ptr<Process> currentProcessPtr;
     vector<string> outputBuffer;
     OutputMode outputMode;
-    vector<string> pushendStack;
-    bool pushendMode = false;
-
-    string ERROR_PREFIX = "------------ Runtime Error ------------\n";
-    string ERROR_POSTFIX = "---------------------------------------";
+    // time slice of the processes without a budget of their own, IRISREDUCTIONS overrides the default
+    int reductionBudget;
+    // the limits of the processes this runtime creates, none unless set in the environment
+    ProcessLimits limits;
+    // workers write to cout one value at a time
+    inline static std::mutex outputMutex;
 
-    inline Runtime() { this->outputMode = OutputMode::UNBUFFERED; };
+    inline Runtime() : Runtime(OutputMode::UNBUFFERED) {};
 
-    inline Runtime(OutputMode outputMode) : outputMode(outputMode) {};
+    // the buffered output of the REPL keeps the order of a single worker
+    // workerCount <= 0 for the default of the scheduler
+    Runtime(OutputMode outputMode, int reductionBudget = 0, int workerCount = 0);
 
     void schedule();
 
+    // runs process for one time slice on this runtime
+    void runSlice(Process &process);
+
+    // runs processPtr on the calling thread without starting the scheduler while nothing else is to run,
+    // then the scheduler runs what is left: the processes it started, and itself when it sleeps or yields
+    void runProcess(const std::shared_ptr<Process> &processPtr);
+
     void execute();
 
-    int addProcess(Process process);
+    int addProcess(std::shared_ptr<Process> processPtr);
 
     PID allocatePID();
 
@@ -58,6 +84,8 @@ public:
 
     void ailCall(const Instruction &instruction);
 
+    void ailNative(const Instruction &instruction);
+
     void ailAdd();
 
     void ailDisplay();
@@ -68,7 +96,9 @@ public:
 
     void ailTailCall(const Instruction &instruction);
 
-    Process createProcess(Module module);
+    shared_ptr<Process> createProcess(const Module &module);
+
+    shared_ptr<Process> createProcess(shared_ptr<const ProgramImage> image);
 
     void aliDisplay();
 
@@ -110,12 +140,67 @@ public:
 
     void ailFork();
 
+    void ailSend();
+
+    HandleOrStr copyMessage(const HandleOrStr &hos, map<HandleOrStr, HandleOrStr> &copies);
+
+    void ailReceive();
+
+    void ailCurrentPid();
+
+    void ailYield();
+
+    void ailSleep();
+
+    void ailAfter();
+
+    // the time point ms milliseconds from now, ms must be a non-negative number
+    std::chrono::steady_clock::time_point getDeadline(const string &functionName, const HandleOrStr &ms);
+
+    void ailFuture();
+
+    void ailTouch();
+
+    void ailIsFuture();
+
+    void ailParallelMap();
+
+    void ailParallelReduce();
+
+    void ailSetPriority();
+
+    void ailSetReductionBudget();
+
     void ailNewline();
 
     void ailRead();
 
     void ailWrite();
 
+    void ailOpenInputFile();
+
+    void ailReadLine();
+
+    void ailTcpListen();
+
+    void ailTcpAccept();
+
+    void ailTcpConnect();
+
+    void ailClosePort();
+
+    // the operands saved by waitForPort when the instruction runs again, otherwise the popped ones
+    vector<HandleOrStr> popOperandsOrResume(int num);
+
+    // the process sleeps until fd is ready for events, then runs the current instruction again with hoses
+    void waitForPort(const shared_ptr<PortObject> &portObjPtr, uint32_t events, vector<HandleOrStr> hoses);
+
+    // reads what is available into the input buffer, false when the read would block
+    bool fillInputBuffer(const shared_ptr<PortObject> &portObjPtr);
+
+    // sends the output buffer, then steps, or waits until the connection can take more
+    void flushPort(const shared_ptr<PortObject> &portObjPtr, vector<HandleOrStr> hoses);
+
     void ailNop();
 
     void ailPause();
@@ -135,6 +220,8 @@ public:
 
     void output(string outputStr, bool is_with_endl);
 
+    void outputValue(HandleOrStr hos, bool is_with_endl);
+
     void ailCar();
 
     void ailCdr();
@@ -179,11 +266,168 @@ public:
 
     string doubleToStr(double trouble);
 
-    void execute(Instruction instruction);
+    void execute(const Instruction &instruction);
+
+    bool areHosesEqual(const vector<HandleOrStr> &hoses1, const vector<HandleOrStr> &hoses2,
+                       set<pair<Handle, Handle>> &vectorsBeingCompared, int offset1 = 0, int offset2 = 0);
+
+    bool isEq(const HandleOrStr &operand1, const HandleOrStr &operand2);
+
+    bool isEq(const HandleOrStr &operand1, const HandleOrStr &operand2,
+              set<pair<Handle, Handle>> &vectorsBeingCompared);
+
+    shared_ptr<ListObject> getListObjPtr(HandleOrStr hos, int &offset);
+
+    void ailVector();
+
+    void ailMakeVector();
+
+    void ailVectorRef();
+
+    void ailVectorSet();
+
+    void ailVectorLength();
+
+    void ailVectorToList();
+
+    void ailListToVector();
+
+    void ailIsVector();
+
+    shared_ptr<VectorObject> getVectorObjPtr(HandleOrStr hos);
+
+    int toVectorIndex(string functionName, HandleOrStr hos, int size);
+
+    void ailNumericVector(IrisObjectType numericVectorType);
+
+    void ailMakeNumericVector(IrisObjectType numericVectorType);
+
+    void ailListToNumericVector(IrisObjectType numericVectorType);
+
+    void ailNumericVectorArithmetic(string functionName, NumericKernels::Op op);
+
+    void ailNumericVectorCompare(string functionName, NumericKernels::Cmp cmp);
+
+    void ailVectorSum();
+
+    void ailVectorDot();
+
+    void ailVectorMinMax(bool isMin);
+
+    void ailVectorMap();
+
+    Handle numericVectorArithmetic(string functionName, NumericKernels::Op op, HandleOrStr hos1, HandleOrStr hos2);
+
+    Handle numericVectorCompare(string functionName, NumericKernels::Cmp cmp, HandleOrStr hos1, HandleOrStr hos2);
+
+    template<typename F>
+    bool visitNumericVector(HandleOrStr hos, F f);
+
+    template<typename T>
+    const T *getNumericData(string functionName, HandleOrStr hos, size_t size, vector<T> &buffer);
+
+    template<typename T, typename Kernel>
+    void runNumericKernel(string functionName, HandleOrStr hos1, HandleOrStr hos2, size_t size, Kernel kernel);
+
+    // a copy of the elements taken under the lock of the vector, for walking them while other workers may set them
+    template<typename VectorObjectType>
+    static decltype(VectorObjectType::elements) copyElements(const shared_ptr<VectorObjectType> &vectorObjPtr);
+
+    size_t getBulkSize(string functionName, HandleOrStr hos1, HandleOrStr hos2);
+
+    bool isS64Operand(HandleOrStr hos);
+
+    void toNumber(string functionName, HandleOrStr hos, double &number);
 
-    bool areHosesEqual(vector<HandleOrStr> hoses1, vector<HandleOrStr> hoses2);
+    void toNumber(string functionName, HandleOrStr hos, int64_t &number);
 
-    bool isEq(HandleOrStr operand1, HandleOrStr operand2);
+    string numberToStr(double number);
+
+    string numberToStr(int64_t number);
+
+    void ailStringAppend();
+
+    void ailSubstring();
+
+    void ailStringLength();
+
+    void ailStringRef();
+
+    void ailStringContains();
+
+    void ailIsString();
+
+    void ailMakeStringBuilder();
+
+    void ailStringBuilderAppend();
+
+    void ailStringBuilderLength();
+
+    void ailBuilderToString();
+
+    shared_ptr<StringObject> getStringObjPtr(string functionName, HandleOrStr hos);
+
+    shared_ptr<StringBuilderObject> getStringBuilderObjPtr(string functionName, HandleOrStr hos);
+
+    shared_ptr<PortObject> getPortObjPtr(string functionName, HandleOrStr hos);
+
+    shared_ptr<PortObject> getConnectionObjPtr(string functionName, HandleOrStr hos);
+
+    void ailMakeHashTable();
+
+    void ailHashRef();
+
+    void ailHashSet();
+
+    void ailHashRemove();
+
+    void ailHashCount();
+
+    void ailHashContains();
+
+    void ailHashKeys();
+
+    void ailHashValues();
+
+    void ailHashToList();
+
+    void ailIsHashTable();
+
+    shared_ptr<HashTableObject> getHashTableObjPtr(string functionName, HandleOrStr hos);
+
+    HandleOrStr toHashKey(const HandleOrStr &hos);
+
+    size_t hashKey(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key);
+
+    size_t equalHash(const HandleOrStr &hos);
+
+    size_t listHash(const shared_ptr<ListObject> &listObjPtr, int offset);
+
+    size_t listElementHash(const HandleOrStr &hos);
+
+    void resolveFuture();
+
+    void stopOnLimit(const string &message);
+
+    void runParallelJob(const string &functionName, bool isReduce);
+
+    void startParallelRound(const shared_ptr<ParallelJob> &jobPtr);
+
+    void startChunkCall();
+
+    void finishChunkCall();
+
+    void finishChunk();
+
+    void runPrimitiveChunk();
+
+    HandleOrStr callPrimitive(const string &primitive, const vector<HandleOrStr> &arguments);
+
+    bool isHashKeyEqual(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key1,
+                        const HandleOrStr &key2);
+
+    void setHashEntry(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key, size_t hash,
+                      const HandleOrStr &value);
 };
 
 
@@ -191,24 +435,36 @@ public:
 //                      PROCESS RELATED
 //=================================================================
 
-int Runtime::addProcess(Process process) {
-    auto processPtr = std::shared_ptr<Process>(new Process(process));
-    if (!processPool.count(process.pid)) {
-        //process not in pool
-        processPool.emplace(process.pid, processPtr);
+// the buffered output of the REPL keeps the order of a single worker
+Runtime::Runtime(OutputMode outputMode, int reductionBudget, int workerCount) : scheduler(std::make_shared<Scheduler>(
+        outputMode == OutputMode::BUFFERED ? 1 : workerCount)), outputMode(outputMode) {
+    if (reductionBudget <= 0) {
+        const char *budgetEnv = std::getenv("IRISREDUCTIONS");
+        reductionBudget = budgetEnv != nullptr ? std::atoi(budgetEnv) : DEFAULT_REDUCTION_BUDGET;
     }
-    processQueue.push(processPtr);
-    return process.pid;
-};
+    this->reductionBudget = std::max(reductionBudget, 1);
+    this->limits = ProcessLimits::fromEnvironment();
+}
+
+int Runtime::addProcess(std::shared_ptr<Process> processPtr) {
+    this->scheduler->addProcess(processPtr);
+    return processPtr->pid;
+}
+
+// process factory, the module is compiled into a program image once, every process of the program shares it
+shared_ptr<Process> Runtime::createProcess(const Module &module) {
+    return this->createProcess(std::make_shared<const ProgramImage>(module));
+}
 
-// process factory, allocate PID and help to pass module loader to the constructor of the process
-Process Runtime::createProcess(Module module) {
-    Process process(this->allocatePID(), module);
-    return process;
+shared_ptr<Process> Runtime::createProcess(shared_ptr<const ProgramImage> image) {
+    auto processPtr = std::make_shared<Process>(this->allocatePID(), std::move(image));
+    processPtr->limits = this->limits;
+    processPtr->heap->maxBytes = this->limits.maxHeapBytes;
+    return processPtr;
 }
 
 PID Runtime::allocatePID() {
-    return processPool.size();
+    return this->scheduler->allocatePID();
 }
 
 
@@ -216,35 +472,63 @@ PID Runtime::allocatePID() {
 //                      Scheduler
 //=================================================================
 void Runtime::schedule() {
-    while (!this->processQueue.empty()) {
-        // Pop from process queue
-        this->currentProcessPtr = this->processQueue.front();
-        this->processQueue.pop();
-
-        // Run the current process
-        // Round Robin Scheduling
-        // Set time slice as 20 (execute 20 instructions each time), then switch to next process
-        this->currentProcessPtr->state = ProcessState::RUNNING;
-        for (int timeSlice = 0; timeSlice < 20; ++timeSlice) {
+    // worker 0 runs on this runtime, the other workers on copies of it
+    vector<Runtime> workerRuntimes(this->scheduler->workerCount - 1, *this);
+
+    this->scheduler->run([this, &workerRuntimes](int workerIndex, Process &process) {
+        Runtime &runtime = workerIndex == 0 ? *this : workerRuntimes[workerIndex - 1];
+        runtime.runSlice(process);
+    });
+}
+
+void Runtime::runSlice(Process &process) {
+    this->currentProcessPtr = process.shared_from_this();
+
+    if (std::chrono::steady_clock::now() < process.sleepDeadline) {
+        // woken by a message, its timer wakes it again
+        process.state = ProcessState::SLEEPING;
+        this->currentProcessPtr = nullptr;
+        return;
+    }
+
+    // the slice ends when the budget is spent, or when the process sleeps, yields or stops
+    // it ends at the instruction limit too, the loop then needs no check of its own
+    int budget = process.reductionBudget > 0 ? process.reductionBudget : this->reductionBudget;
+    budget = (int) std::min<int64_t>(budget, process.limits.maxInstructions - process.executedInstructions);
+    int reductions = 0;
+    try {
+        if (process.chunkJobPtr != nullptr && process.chunkJobPtr->closurePtr == nullptr) {
+            // a chunk over a primitive has no code to run, it is done in one go
+            this->runPrimitiveChunk();
+        }
+        for (; reductions < budget && process.state == ProcessState::RUNNING; ++reductions) {
             this->execute();
-            if (this->currentProcessPtr->state == ProcessState::RUNNING) {
-                continue;
-            }
-            break;
         }
-
-        // put the unfinished process to the back of the queue
-        if (this->currentProcessPtr->state == ProcessState::RUNNING) {
-            this->currentProcessPtr->state = ProcessState::READY;
-            this->processQueue.push(this->currentProcessPtr);
+        process.executedInstructions += reductions;
+        if (process.state == ProcessState::RUNNING &&
+            process.executedInstructions >= process.limits.maxInstructions) {
+            throw ResourceLimitError(
+                    "the process executed " + to_string(process.limits.maxInstructions) + " instructions");
         }
+    } catch (ResourceLimitError &e) {
+        this->stopOnLimit(e.what());
     }
+    this->currentProcessPtr = nullptr;
+}
+
+void Runtime::runProcess(const std::shared_ptr<Process> &processPtr) {
+    this->scheduler->addRunningProcess(processPtr);
+    // slices run back to back as long as no other process waits for its turn
+    do {
+        this->runSlice(*processPtr);
+    } while (processPtr->state == ProcessState::RUNNING && this->scheduler->liveProcessCount() == 1);
+    this->scheduler->endSlice(processPtr.get());
+    this->schedule();
 }
 
-void Runtime::execute(Instruction instruction) {
+void Runtime::execute(const Instruction &instruction) {
     if (instruction.type != InstructionType::COMMENT && instruction.type != InstructionType::LABEL) {
-        string argument = instruction.argument;
-        string mnemonic = instruction.mnemonic;
+        const string &mnemonic = instruction.mnemonic;
 
 //        try {
         if (mnemonic == "store") { this->ailStore(); }
@@ -268,6 +552,58 @@ void Runtime::execute(Instruction instruction) {
         else if (mnemonic == "list") { this->ailList(); }
         else if (mnemonic == "cons") { this->ailCons(); }
 
+        else if (mnemonic == "vector") { this->ailVector(); }
+        else if (mnemonic == "make-vector") { this->ailMakeVector(); }
+        else if (mnemonic == "vector-ref") { this->ailVectorRef(); }
+        else if (mnemonic == "vector-set!") { this->ailVectorSet(); }
+        else if (mnemonic == "vector-length") { this->ailVectorLength(); }
+        else if (mnemonic == "vector->list") { this->ailVectorToList(); }
+        else if (mnemonic == "list->vector") { this->ailListToVector(); }
+        else if (mnemonic == "vector?") { this->ailIsVector(); }
+
+        else if (mnemonic == "f64vector") { this->ailNumericVector(IrisObjectType::F64VECTOR); }
+        else if (mnemonic == "s64vector") { this->ailNumericVector(IrisObjectType::S64VECTOR); }
+        else if (mnemonic == "make-f64vector") { this->ailMakeNumericVector(IrisObjectType::F64VECTOR); }
+        else if (mnemonic == "make-s64vector") { this->ailMakeNumericVector(IrisObjectType::S64VECTOR); }
+        else if (mnemonic == "list->f64vector") { this->ailListToNumericVector(IrisObjectType::F64VECTOR); }
+        else if (mnemonic == "list->s64vector") { this->ailListToNumericVector(IrisObjectType::S64VECTOR); }
+        else if (mnemonic == "vector+") { this->ailNumericVectorArithmetic(mnemonic, NumericKernels::Op::ADD); }
+        else if (mnemonic == "vector-") { this->ailNumericVectorArithmetic(mnemonic, NumericKernels::Op::SUB); }
+        else if (mnemonic == "vector*") { this->ailNumericVectorArithmetic(mnemonic, NumericKernels::Op::MUL); }
+        else if (mnemonic == "vector/") { this->ailNumericVectorArithmetic(mnemonic, NumericKernels::Op::DIV); }
+        else if (mnemonic == "vector=") { this->ailNumericVectorCompare(mnemonic, NumericKernels::Cmp::EQ); }
+        else if (mnemonic == "vector<") { this->ailNumericVectorCompare(mnemonic, NumericKernels::Cmp::LT); }
+        else if (mnemonic == "vector>") { this->ailNumericVectorCompare(mnemonic, NumericKernels::Cmp::GT); }
+        else if (mnemonic == "vector<=") { this->ailNumericVectorCompare(mnemonic, NumericKernels::Cmp::LE); }
+        else if (mnemonic == "vector>=") { this->ailNumericVectorCompare(mnemonic, NumericKernels::Cmp::GE); }
+        else if (mnemonic == "vector-sum") { this->ailVectorSum(); }
+        else if (mnemonic == "vector-dot") { this->ailVectorDot(); }
+        else if (mnemonic == "vector-min") { this->ailVectorMinMax(true); }
+        else if (mnemonic == "vector-max") { this->ailVectorMinMax(false); }
+        else if (mnemonic == "vector-map") { this->ailVectorMap(); }
+
+        else if (mnemonic == "string-append") { this->ailStringAppend(); }
+        else if (mnemonic == "substring") { this->ailSubstring(); }
+        else if (mnemonic == "string-length") { this->ailStringLength(); }
+        else if (mnemonic == "string-ref") { this->ailStringRef(); }
+        else if (mnemonic == "string-contains") { this->ailStringContains(); }
+        else if (mnemonic == "string?") { this->ailIsString(); }
+        else if (mnemonic == "make-string-builder") { this->ailMakeStringBuilder(); }
+        else if (mnemonic == "string-builder-append!") { this->ailStringBuilderAppend(); }
+        else if (mnemonic == "string-builder-length") { this->ailStringBuilderLength(); }
+        else if (mnemonic == "builder->string") { this->ailBuilderToString(); }
+
+        else if (mnemonic == "make-hash-table") { this->ailMakeHashTable(); }
+        else if (mnemonic == "hash-ref") { this->ailHashRef(); }
+        else if (mnemonic == "hash-set!") { this->ailHashSet(); }
+        else if (mnemonic == "hash-remove!") { this->ailHashRemove(); }
+        else if (mnemonic == "hash-count") { this->ailHashCount(); }
+        else if (mnemonic == "hash-contains?") { this->ailHashContains(); }
+        else if (mnemonic == "hash-keys") { this->ailHashKeys(); }
+        else if (mnemonic == "hash-values") { this->ailHashValues(); }
+        else if (mnemonic == "hash->list") { this->ailHashToList(); }
+        else if (mnemonic == "hash-table?") { this->ailIsHashTable(); }
+
         else if (mnemonic == "add") { this->ailAdd(); }
         else if (mnemonic == "sub") { this->ailSub(); }
         else if (mnemonic == "mul") { this->ailMul(); }
@@ -291,10 +627,29 @@ void Runtime::execute(Instruction instruction) {
 
 
         else if (mnemonic == "fork") { this->ailFork(); }
+        else if (mnemonic == "send") { this->ailSend(); }
+        else if (mnemonic == "receive") { this->ailReceive(); }
+        else if (mnemonic == "current-pid") { this->ailCurrentPid(); }
+        else if (mnemonic == "yield") { this->ailYield(); }
+        else if (mnemonic == "sleep") { this->ailSleep(); }
+        else if (mnemonic == "after") { this->ailAfter(); }
+        else if (mnemonic == "future") { this->ailFuture(); }
+        else if (mnemonic == "touch") { this->ailTouch(); }
+        else if (mnemonic == "future?") { this->ailIsFuture(); }
+        else if (mnemonic == "parallel-map") { this->ailParallelMap(); }
+        else if (mnemonic == "parallel-reduce") { this->ailParallelReduce(); }
+        else if (mnemonic == "set-priority!") { this->ailSetPriority(); }
+        else if (mnemonic == "set-reduction-budget!") { this->ailSetReductionBudget(); }
         else if (mnemonic == "display") { this->ailDisplay(); }
         else if (mnemonic == "newline") { this->ailNewline(); }
         else if (mnemonic == "read") { this->ailRead(); }
         else if (mnemonic == "write") { this->ailWrite(); }
+        else if (mnemonic == "open-input-file") { this->ailOpenInputFile(); }
+        else if (mnemonic == "read-line") { this->ailReadLine(); }
+        else if (mnemonic == "tcp-listen") { this->ailTcpListen(); }
+        else if (mnemonic == "tcp-accept") { this->ailTcpAccept(); }
+        else if (mnemonic == "tcp-connect") { this->ailTcpConnect(); }
+        else if (mnemonic == "close-port") { this->ailClosePort(); }
         else if (mnemonic == "nop") { this->ailNop(); }
         else if (mnemonic == "pause") { this->ailPause(); }
         else if (mnemonic == "halt") { this->ailHalt(); }
@@ -307,6 +662,7 @@ void Runtime::execute(Instruction instruction) {
 
         else if (mnemonic == "call") { this->ailCall(instruction); }
         else if (mnemonic == "tailcall") { this->ailTailCall(instruction); }
+        else if (mnemonic == "native") { this->ailNative(instruction); }
         else {
             this->currentProcessPtr->step();
         }
@@ -314,14 +670,14 @@ void Runtime::execute(Instruction instruction) {
         this->currentProcessPtr->step();
     }
 
-    if (this->currentProcessPtr->PC >= this->currentProcessPtr->instructions.size()) {
+    if (this->currentProcessPtr->PC >= this->currentProcessPtr->image->instructions.size()) {
         this->currentProcessPtr->state = ProcessState::STOPPED;
     }
 }
 
 void Runtime::execute() {
-    Instruction instruction = this->currentProcessPtr->currentInstruction();
-    this->execute(instruction);
+    // a reference into the program image, which outlives any instruction
+    this->execute(this->currentProcessPtr->currentInstruction());
 }
 
 
@@ -350,23 +706,23 @@ void Runtime::ailStore() {
                        __FILE__, __FUNCTION__, __LINE__);
             throw std::runtime_error("");
         }
-        this->pushendMode = true;
+        this->currentProcessPtr->pushendMode = true;
         this->currentProcessPtr->step();
 
         // do not store anything on '.'
         return;
     }
 
-    if (this->pushendMode) {
-        Handle handle = this->currentProcessPtr->heap.makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
-        shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(handle));
+    if (this->currentProcessPtr->pushendMode) {
+        Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+        shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
 
         vector<HandleOrStr> hoses = this->popOperandsToPushend();
         for (auto hos : hoses) {
             listObjPtr->addChild(hos);
         }
 
-        this->pushendMode = false;
+        this->currentProcessPtr->pushendMode = false;
         this->currentProcessPtr->currentClosurePtr->setBoundVariable(variableName, handle, false);
     } else {
         auto hoses = this->popOperands(1);
@@ -381,14 +737,14 @@ Handle Runtime::newClosureBaseOnCurrentClosure(int instAddress) {
     Handle newClosureHandle = this->currentProcessPtr->newClosure(instAddress);
     auto currentClosurePtr = this->currentProcessPtr->currentClosurePtr;
 
-    auto freeVariables = this->currentProcessPtr->currentClosurePtr->freeVariables;
+    auto freeVariables = this->currentProcessPtr->currentClosurePtr->getFreeVariables();
     for (auto &freeVariable : freeVariables) {
         this->currentProcessPtr->getClosurePtr(newClosureHandle)->setFreeVariable(freeVariable.first,
                                                                                   freeVariable.second,
                                                                                   false);
     }
 
-    auto boundVariables = this->currentProcessPtr->currentClosurePtr->boundVariables;
+    auto boundVariables = this->currentProcessPtr->currentClosurePtr->getBoundVariables();
     for (auto &boundVariable : boundVariables) {
         this->currentProcessPtr->getClosurePtr(newClosureHandle)->setFreeVariable(boundVariable.first,
                                                                                   boundVariable.second,
@@ -407,8 +763,8 @@ void Runtime::ailLoad() {
         Type argumentValueType = typeOfStr(argumentValue);
 
         if (argumentValueType == Type::LABEL) {
-            if (this->currentProcessPtr->labelAddressMap.count(argumentValue)) {
-                int instAddress = this->currentProcessPtr->labelAddressMap[argumentValue];
+            if (this->currentProcessPtr->image->labelAddressMap.count(argumentValue)) {
+                int instAddress = this->currentProcessPtr->image->labelAddressMap.at(argumentValue);
 
                 Handle newClosureHandle = this->newClosureBaseOnCurrentClosure(instAddress);
 
@@ -433,8 +789,8 @@ void Runtime::aliLoadClosure() {
     if (instruction.argumentType == InstructionArgumentType::LABEL) {
         string label = instruction.argument;
 
-        if (this->currentProcessPtr->labelAddressMap.count(label)) {
-            int instAddress = this->currentProcessPtr->labelAddressMap[label];
+        if (this->currentProcessPtr->image->labelAddressMap.count(label)) {
+            int instAddress = this->currentProcessPtr->image->labelAddressMap.at(label);
 
             Handle newClosureHandle = this->newClosureBaseOnCurrentClosure(instAddress);
 
@@ -468,10 +824,11 @@ void Runtime::ailPushlist() {
 
     auto hoses = this->popOperands(1);
     // TODO: raise a type error here
-    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(hoses[0]));
+    int offset;
+    auto listObjPtr = this->getListObjPtr(hoses[0], offset);
 
-    for (int i = listObjPtr->realListObjPtr->size() - 1; i >= listObjPtr->currentIndex; i--) {
-        this->currentProcessPtr->pushOperand(listObjPtr->realListObjPtr->childrenHoses[i]);
+    for (int i = listObjPtr->childrenHoses.size() - 1; i >= offset; i--) {
+        this->currentProcessPtr->pushOperand(listObjPtr->childrenHoses[i]);
     }
 
     this->currentProcessPtr->step();
@@ -546,7 +903,7 @@ void Runtime::ailCall(const Instruction &instruction, bool isTailCall) {
                                                     this->currentProcessPtr->PC + 1);
         }
 
-        int callInstructionAddress = this->currentProcessPtr->labelAddressMap[instruction.argument];
+        int callInstructionAddress = this->currentProcessPtr->image->labelAddressMap.at(instruction.argument);
         string label = instruction.argument;
 
         // create a new closure for the function execution
@@ -554,7 +911,7 @@ void Runtime::ailCall(const Instruction &instruction, bool isTailCall) {
 
         // Set the current closure to the new closure and then head to the new function's instructions
         this->currentProcessPtr->setCurrentClosure(newClosureHandle);
-        int instructionAddress = this->currentProcessPtr->labelAddressMap[label];
+        int instructionAddress = this->currentProcessPtr->image->labelAddressMap.at(label);
         this->currentProcessPtr->gotoAddress(instructionAddress);
 
     } else if (instruction.argumentType == InstructionArgumentType::HANDLE) {
@@ -565,7 +922,7 @@ void Runtime::ailCall(const Instruction &instruction, bool isTailCall) {
         }
 
         Handle handle = instruction.argument;
-        shared_ptr<IrisObject> schemeObjPtr = this->currentProcessPtr->heap.get(handle);
+        shared_ptr<IrisObject> schemeObjPtr = this->currentProcessPtr->heap->get(handle);
 
         if (schemeObjPtr->irisObjectType == IrisObjectType::CLOSURE) {
             auto closurePtr = static_pointer_cast<Closure>(schemeObjPtr);
@@ -574,7 +931,6 @@ void Runtime::ailCall(const Instruction &instruction, bool isTailCall) {
         }
 
     } else if (instruction.argumentType == InstructionArgumentType::VARIABLE) {
-        // TODO native calls
         string variableName = instruction.argument;
         string variableValue = this->currentProcessPtr->dereference(variableName);
 
@@ -597,13 +953,53 @@ void Runtime::ailCall(const Instruction &instruction, bool isTailCall) {
     }
 }
 
+// the function was looked up when the image was built, the call goes straight through its pointer.
+// a native bound after that, the image may come from the cache, is looked up on each call
+void Runtime::ailNative(const Instruction &instruction) {
+    const NativeFunction *nativeFunctionPtr = instruction.nativeFunctionPtr;
+    if (nativeFunctionPtr == nullptr) {
+        nativeFunctionPtr = NativeRegistry::find(instruction.argument);
+    }
+    if (nativeFunctionPtr == nullptr) {
+        utils::raiseError("[UndefinedError] native function '" + instruction.argument + "' is not bound",
+                          RUNTIME_PREFIX_TITLE);
+    }
+
+    auto hoses = this->popOperandsToPushend();
+    if (nativeFunctionPtr->arity != NativeRegistry::VARIADIC && hoses.size() != nativeFunctionPtr->arity) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage(nativeFunctionPtr->name,
+                                                                       nativeFunctionPtr->arity, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    HandleOrStr result;
+    try {
+        result = nativeFunctionPtr->functionPtr(hoses, *this->currentProcessPtr->heap, nativeFunctionPtr->data);
+    } catch (std::exception &e) {
+        utils::raiseError(nativeFunctionPtr->name + ": " + e.what(), RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->pushOperand(result);
+    this->currentProcessPtr->step();
+}
+
 void Runtime::ailTailCall(const Instruction &instruction) {
     this->ailCall(instruction, true);
 
 }
 
 void Runtime::ailReturn() {
-    Instruction instruction = this->currentProcessPtr->currentInstruction();
+    // a forked process is done when its thunk returns, a chunk when the last of its calls returns
+    if (this->currentProcessPtr->fStack.empty()) {
+        if (this->currentProcessPtr->chunkJobPtr != nullptr) {
+            this->finishChunkCall();
+        } else if (this->currentProcessPtr->futurePtr != nullptr) {
+            this->resolveFuture();
+        } else {
+            this->currentProcessPtr->state = ProcessState::STOPPED;
+        }
+        return;
+    }
+
     StackFrame sf = this->currentProcessPtr->popStackFrame();
     this->currentProcessPtr->currentClosurePtr = sf.closurePtr;
     this->currentProcessPtr->gotoAddress(sf.returnAddress);
@@ -618,7 +1014,7 @@ void Runtime::ailExit() {
     auto hoses = this->popOperands(1);
     this->checkWrongArgumentsNumberError("exit", 1, hoses.size());
 
-    this->output(this->toStr(hoses[0]), true);
+    this->outputValue(hoses[0], true);
     this->currentProcessPtr->state = ProcessState::STOPPED;
 }
 
@@ -656,12 +1052,7 @@ void Runtime::ailAdd() {
 }
 
 string Runtime::doubleToStr(double trouble) {
-    if (utils::double_is_int(trouble)) {
-        return to_string((int) trouble);
-    } else {
-        return to_string(trouble);
-    }
-
+    return utils::doubleToStr(trouble);
 }
 
 
@@ -899,61 +1290,87 @@ void Runtime::ailIsEq() {
     this->currentProcessPtr->step();
 }
 
-bool Runtime::isEq(HandleOrStr operand1, HandleOrStr operand2) {
-    Type operand1Type = typeOfStr(operand1);
-    Type operand2Type = typeOfStr(operand2);
+bool Runtime::isEq(const HandleOrStr &operand1, const HandleOrStr &operand2) {
+    set<pair<Handle, Handle>> vectorsBeingCompared;
+    return this->isEq(operand1, operand2, vectorsBeingCompared);
+}
 
-    if (operand1Type != operand2Type) {
+// vectors may contain themselves, a pair of vectors met again while it is being compared counts as equal,
+// whether they differ is decided by the rest of the comparison
+bool Runtime::isEq(const HandleOrStr &operand1, const HandleOrStr &operand2,
+                   set<pair<Handle, Handle>> &vectorsBeingCompared) {
+    // identical operands are equal without looking into them, and apart from handles, values are only
+    // equal to themselves
+    if (operand1 == operand2) {
+        return true;
+    }
+    if (operand1.empty() || operand2.empty() || operand1[0] != '&' || operand2[0] != '&') {
         return false;
     }
 
-    if (operand1Type == Type::HANDLE) {
-        auto schemeObjPtr1 = this->currentProcessPtr->heap.get(operand1);
-        auto schemeObjPtr2 = this->currentProcessPtr->heap.get(operand2);
+    auto schemeObjPtr1 = this->currentProcessPtr->heap->get(operand1);
+    auto schemeObjPtr2 = this->currentProcessPtr->heap->get(operand2);
 
-        if (schemeObjPtr1->irisObjectType != schemeObjPtr2->irisObjectType) {
-            return false;
-        }
-
-        if (schemeObjPtr1->irisObjectType == IrisObjectType::QUOTE) {
-            auto hoses1 = IrisObject::getChildrenHosesOrBodies(schemeObjPtr1);
-            auto hoses2 = IrisObject::getChildrenHosesOrBodies(schemeObjPtr2);
-
-            if (this->areHosesEqual(hoses1, hoses2)) {
-                return true;
-            } else {
-                return false;
-            }
-
-        } else if (schemeObjPtr1->irisObjectType == IrisObjectType::LIST) {
-            auto l1ObjPtr = static_pointer_cast<ListObject>(schemeObjPtr1);
-            auto l2ObjPtr = static_pointer_cast<ListObject>(schemeObjPtr2);
+    if (schemeObjPtr1->irisObjectType != schemeObjPtr2->irisObjectType) {
+        return false;
+    }
 
-            auto hoses1 = l1ObjPtr->getChildrenHoses();
-            auto hoses2 = l2ObjPtr->getChildrenHoses();
+    if (schemeObjPtr1->irisObjectType == IrisObjectType::QUOTE) {
+        return this->areHosesEqual(IrisObject::getChildrenHosesOrBodies(schemeObjPtr1),
+                                   IrisObject::getChildrenHosesOrBodies(schemeObjPtr2), vectorsBeingCompared);
+    } else if (schemeObjPtr1->irisObjectType == IrisObjectType::LIST) {
+        int offset1, offset2;
+        auto l1ObjPtr = this->getListObjPtr(operand1, offset1);
+        auto l2ObjPtr = this->getListObjPtr(operand2, offset2);
 
-            if (this->areHosesEqual(hoses1, hoses2)) {
-                return true;
-            } else {
-                return false;
-            }
+        if (l1ObjPtr == l2ObjPtr && offset1 == offset2) {
+            return true;
+        }
+        if (l1ObjPtr->size(offset1) != l2ObjPtr->size(offset2)) {
+            return false;
+        }
+        // lists that have been hashed already are told apart without walking them
+        auto suffixHashes1 = l1ObjPtr->suffixHashes.load();
+        auto suffixHashes2 = l2ObjPtr->suffixHashes.load();
+        if (suffixHashes1 && suffixHashes2 && (*suffixHashes1)[offset1] != (*suffixHashes2)[offset2]) {
+            return false;
+        }
+        return this->areHosesEqual(l1ObjPtr->childrenHoses, l2ObjPtr->childrenHoses, vectorsBeingCompared, offset1,
+                                   offset2);
+    } else if (schemeObjPtr1->irisObjectType == IrisObjectType::VECTOR) {
+        pair<Handle, Handle> vectorPair(operand1, operand2);
+        if (!vectorsBeingCompared.insert(vectorPair).second) {
+            return true;
         }
+        // the vectors are copied one at a time, so two workers comparing them never wait on each other
+        bool isEqual = this->areHosesEqual(Runtime::copyElements(static_pointer_cast<VectorObject>(schemeObjPtr1)),
+                                           Runtime::copyElements(static_pointer_cast<VectorObject>(schemeObjPtr2)),
+                                           vectorsBeingCompared);
+        vectorsBeingCompared.erase(vectorPair);
+        return isEqual;
+    } else if (schemeObjPtr1->irisObjectType == IrisObjectType::STRING) {
+        return static_pointer_cast<StringObject>(schemeObjPtr1)->content() ==
+               static_pointer_cast<StringObject>(schemeObjPtr2)->content();
+    } else if (schemeObjPtr1->irisObjectType == IrisObjectType::F64VECTOR) {
+        return Runtime::copyElements(static_pointer_cast<F64VectorObject>(schemeObjPtr1)) ==
+               Runtime::copyElements(static_pointer_cast<F64VectorObject>(schemeObjPtr2));
+    } else if (schemeObjPtr1->irisObjectType == IrisObjectType::S64VECTOR) {
+        return Runtime::copyElements(static_pointer_cast<S64VectorObject>(schemeObjPtr1)) ==
+               Runtime::copyElements(static_pointer_cast<S64VectorObject>(schemeObjPtr2));
     }
 
-    if (operand1 == operand2) {
-        return true;
-    } else {
-        return false;
-    }
+    return false;
 }
 
-bool Runtime::areHosesEqual(vector<HandleOrStr> hoses1, vector<HandleOrStr> hoses2) {
-    if (hoses1.size() != hoses2.size()) {
+// compares hoses1[offset1..] with hoses2[offset2..] in place
+bool Runtime::areHosesEqual(const vector<HandleOrStr> &hoses1, const vector<HandleOrStr> &hoses2,
+                            set<pair<Handle, Handle>> &vectorsBeingCompared, int offset1, int offset2) {
+    if (hoses1.size() - offset1 != hoses2.size() - offset2) {
         return false;
     }
 
-    for (int i = 0; i < hoses1.size(); ++i) {
-        if (!this->isEq(hoses1[i], hoses2[i])) {
+    for (int i = offset1, j = offset2; i < hoses1.size(); ++i, ++j) {
+        if (!this->isEq(hoses1[i], hoses2[j], vectorsBeingCompared)) {
             return false;
         }
     }
@@ -961,7 +1378,17 @@ bool Runtime::areHosesEqual(vector<HandleOrStr> hoses1, vector<HandleOrStr> hose
 }
 
 void Runtime::ailIsnull() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("isNull", 1, hoses.size());
 
+    int offset;
+    auto listObjPtr = this->getListObjPtr(hoses[0], offset);
+    if (listObjPtr != nullptr && listObjPtr->size(offset) == 0) {
+        this->currentProcessPtr->pushOperand("#t");
+    } else {
+        this->currentProcessPtr->pushOperand("#f");
+    }
+    this->currentProcessPtr->step();
 }
 
 void Runtime::ailIsatom() {
@@ -974,7 +1401,7 @@ void Runtime::ailIsList() {
     string argument = hoses[0];
 
     if (typeOfStr(argument) == Type::HANDLE) {
-        auto schemeObjPtr = this->currentProcessPtr->heap.get(argument);
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(argument);
         if (schemeObjPtr->irisObjectType != IrisObjectType::LIST) {
             this->currentProcessPtr->pushOperand("#f");
         } else {
@@ -991,18 +1418,10 @@ void Runtime::ailIsPair() {
     this->checkWrongArgumentsNumberError("isPair", 1, hoses.size());
     string argument = hoses[0];
 
-    if (typeOfStr(argument) == Type::HANDLE) {
-        auto schemeObjPtr = this->currentProcessPtr->heap.get(argument);
-        if (schemeObjPtr->irisObjectType != IrisObjectType::LIST) {
-            this->currentProcessPtr->pushOperand("#f");
-        } else {
-            auto listObjPtr = static_pointer_cast<ListObject>(schemeObjPtr);
-            if (listObjPtr->size() <= 1) {
-                this->currentProcessPtr->pushOperand("#f");
-            } else {
-                this->currentProcessPtr->pushOperand("#t");
-            }
-        }
+    int offset;
+    auto listObjPtr = this->getListObjPtr(argument, offset);
+    if (listObjPtr != nullptr && listObjPtr->size(offset) > 1) {
+        this->currentProcessPtr->pushOperand("#t");
     } else {
         this->currentProcessPtr->pushOperand("#f");
     }
@@ -1024,8 +1443,8 @@ void Runtime::ailType() {
     auto hoses = this->popOperands(1);
     string hos = hoses[0];
 
-    Handle quoteHandle = this->currentProcessPtr->heap.makeQuote(RUNTIME_PREFIX, TOP_NODE_HANDLE);
-    auto quoteObjPtr = static_pointer_cast<QuoteObject>(this->currentProcessPtr->heap.get(quoteHandle));
+    Handle quoteHandle = this->currentProcessPtr->heap->makeQuote(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto quoteObjPtr = static_pointer_cast<QuoteObject>(this->currentProcessPtr->heap->get(quoteHandle));
     quoteObjPtr->addChild(toType(hos));
 
     this->currentProcessPtr->pushOperand(quoteHandle);
@@ -1036,7 +1455,7 @@ void Runtime::ailType() {
 string Runtime::toType(HandleOrStr hos) {
     Type hosType = typeOfStr(hos);
     if (hosType == Type::HANDLE) {
-        shared_ptr<IrisObject> schemeObjectPtr = this->currentProcessPtr->heap.get(hos);
+        shared_ptr<IrisObject> schemeObjectPtr = this->currentProcessPtr->heap->get(hos);
         return IrisObjectTypeStrMap[schemeObjectPtr->irisObjectType];
     } else {
         return TypeStrMap[hosType];
@@ -1054,61 +1473,36 @@ void Runtime::ailDisplay() {
     this->checkWrongArgumentsNumberError("display", 1, hoses.size());
     string argument = hoses[0];
 
-    this->output(this->toStr(argument), true);
+    this->outputValue(argument, true);
     this->currentProcessPtr->step();
 }
 
 string Runtime::toStr(HandleOrStr hos) {
-    Type hosType = typeOfStr(hos);
-    if (hosType == Type::HANDLE) {
-        shared_ptr<IrisObject> schemeObjectPtr = this->currentProcessPtr->heap.get(hos);
-        if (schemeObjectPtr->irisObjectType == IrisObjectType::STRING) {
-            auto stringObjPtr = static_pointer_cast<StringObject>(schemeObjectPtr);
-            return stringObjPtr->content;
-        } else if (schemeObjectPtr->irisObjectType == IrisObjectType::QUOTE) {
-            string buffer = "(";
-            auto hoses = IrisObject::getChildrenHosesOrBodies(schemeObjectPtr);
-            for (int i = 0; i < hoses.size(); ++i) {
-                buffer += this->toStr(hoses[i]);
-                if (i != hoses.size() - 1) {
-                    buffer += " ";
-                } else {
-                    buffer += ")";
-                }
-            }
-            if (hoses.size() == 0) {
-                buffer += ")";
-            }
-            return buffer;
-        } else if (schemeObjectPtr->irisObjectType == IrisObjectType::CLOSURE) {
-            return "<lambda: " + hos + " >";
-        } else if (schemeObjectPtr->irisObjectType == IrisObjectType::LIST) {
-            auto listObjPtr = static_pointer_cast<ListObject>(schemeObjectPtr);
-            int currentIndex = listObjPtr->currentIndex;
-            string buffer = "(";
-            auto hoses = IrisObject::getChildrenHosesOrBodies(listObjPtr->realListObjPtr);
-            for (int i = currentIndex; i < hoses.size(); ++i) {
-                buffer += this->toStr(hoses[i]);
-                if (i != hoses.size() - 1) {
-                    buffer += " ";
-                } else {
-                    buffer += ")";
-                    return buffer;
-                }
-            }
-            buffer += ")"; //always finished brackets
-            return buffer;
-        } else {
-            return hos + " " + irisObjectTypeToStr(schemeObjectPtr->irisObjectType);
-        }
-    } else if (hosType == Type::NUMBER || hosType == Type::BOOLEAN || hosType == Type::KEYWORD) {
-        return hos;
+    OutputSink sink;
+    Printer(*this->currentProcessPtr->heap, sink).print(hos);
+    return std::move(sink.buffer);
+}
+
+// unlike output(toStr(hos)), the value is streamed to cout in chunks without building its text first
+void Runtime::outputValue(HandleOrStr hos, bool is_with_endl) {
+    if (this->outputMode == OutputMode::BUFFERED) {
+        this->outputBuffer.push_back(this->toStr(hos));
+        return;
     }
-    return hos;
+
+    std::lock_guard<std::mutex> lock(Runtime::outputMutex);
+    OutputSink sink(&cout);
+    Printer(*this->currentProcessPtr->heap, sink).print(hos);
+    if (is_with_endl) {
+        sink.write('\n');
+    }
+    sink.flush();
+    cout.flush();
 }
 
 void Runtime::output(string outputStr, bool is_with_endl) {
     if (this->outputMode == OutputMode::UNBUFFERED) {
+        std::lock_guard<std::mutex> lock(Runtime::outputMutex);
         if (is_with_endl) {
             cout << outputStr << endl;
         } else {
@@ -1119,141 +1513,2030 @@ void Runtime::output(string outputStr, bool is_with_endl) {
     }
 }
 
+// (fork thunk) runs thunk in a new process and returns its pid
 void Runtime::ailFork() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("fork", 1, hoses.size());
 
-}
+    if (typeOfStr(hoses[0]) != Type::HANDLE ||
+        this->currentProcessPtr->heap->get(hoses[0])->irisObjectType != IrisObjectType::CLOSURE) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("fork", "argument", "lambda",
+                                                                    this->toType(hoses[0]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
 
-void Runtime::ailNewline() {
-    cout << "" << endl;
+    auto closurePtr = this->currentProcessPtr->getClosurePtr(hoses[0]);
+    PID pid = this->allocatePID();
+    this->addProcess(std::make_shared<Process>(pid, *this->currentProcessPtr, closurePtr));
+
+    this->currentProcessPtr->pushOperand(to_string(pid));
     this->currentProcessPtr->step();
 }
 
-void Runtime::ailRead() {
+// (send pid message) puts a copy of message in the mailbox of the process pid, and returns message
+// processes share one heap, see copyMessage for what is copied so that the receiver never shares a mutable object
+void Runtime::ailSend() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("send", 2, hoses.size());
+
+    if (typeOfStr(hoses[0]) != Type::NUMBER || !utils::double_is_int(stod(hoses[0])) ||
+        !this->scheduler->isAllocated((PID) stod(hoses[0]))) {
+        utils::raiseError("[ProcessError] send's pid " + hoses[0] + " is not a process", RUNTIME_PREFIX_TITLE);
+    }
 
+    // a stopped process never reads its mailbox, the message is dropped
+    shared_ptr<Process> receiverPtr = this->scheduler->getProcess((PID) stod(hoses[0]));
+    if (receiverPtr != nullptr && receiverPtr->state != ProcessState::STOPPED) {
+        map<HandleOrStr, HandleOrStr> copies;
+        receiverPtr->mailbox.push(this->copyMessage(hoses[1], copies));
+        this->scheduler->wake(receiverPtr.get());
+    }
+    this->currentProcessPtr->pushOperand(hoses[1]);
+    this->currentProcessPtr->step();
 }
 
-void Runtime::ailWrite() {
+// vectors, numeric vectors, hash tables and string builders are copied, and so are the lists holding them.
+// the rest is immutable (numbers, strings, quotes, lists of those) or only equal to itself (closures, futures, ports)
+// and is passed as it is. copies maps the objects already copied to their copies, so that an object reached
+// twice is copied once and a vector holding itself holds its copy
+HandleOrStr Runtime::copyMessage(const HandleOrStr &hos, map<HandleOrStr, HandleOrStr> &copies) {
+    if (hos.empty() || hos[0] != '&') {
+        return hos;
+    }
+    auto copyIt = copies.find(hos);
+    if (copyIt != copies.end()) {
+        return copyIt->second;
+    }
 
-}
+    auto &heap = this->currentProcessPtr->heap;
+    auto schemeObjPtr = heap->get(hos);
+    switch (schemeObjPtr->irisObjectType) {
+        case IrisObjectType::LIST: {
+            int offset;
+            auto listObjPtr = this->getListObjPtr(hos, offset);
+            // the handle of the copy is taken first, for a vector in the list holding the list again.
+            // the list is kept when none of its elements is copied, then nothing refers to the handle and it is freed
+            Handle handle = heap->allocateHandle(RUNTIME_PREFIX, IrisObjectType::LIST);
+            copies[hos] = handle;
+            vector<HandleOrStr> childrenHoses = listObjPtr->getChildrenHoses(offset);
+            bool isCopied = false;
+            for (auto &childHos : childrenHoses) {
+                HandleOrStr childCopy = this->copyMessage(childHos, copies);
+                isCopied = isCopied || childCopy != childHos;
+                childHos = std::move(childCopy);
+            }
+            if (!isCopied) {
+                heap->deleteHandle(handle);
+                copies[hos] = hos;
+                return hos;
+            }
 
-// blank instruction, do nothing
-void Runtime::ailNop() {
-    this->currentProcessPtr->step();
-}
+            auto copyObjPtr = std::shared_ptr<ListObject>(new ListObject(TOP_NODE_HANDLE, handle));
+            copyObjPtr->childrenHoses = std::move(childrenHoses);
+            heap->account(copyObjPtr->childrenHoses.size() * sizeof(HandleOrStr));
+            heap->set(handle, copyObjPtr);
+            return handle;
+        }
+        case IrisObjectType::VECTOR: {
+            auto elements = Runtime::copyElements(static_pointer_cast<VectorObject>(schemeObjPtr));
+            Handle handle = heap->makeVector(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+            heap->account(elements.size() * sizeof(HandleOrStr));
+            copies[hos] = handle;
+            for (auto &element : elements) {
+                element = this->copyMessage(element, copies);
+            }
+            static_pointer_cast<VectorObject>(heap->get(handle))->elements = std::move(elements);
+            return handle;
+        }
+        case IrisObjectType::F64VECTOR:
+        case IrisObjectType::S64VECTOR: {
+            Handle handle = heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE, schemeObjPtr->irisObjectType);
+            this->visitNumericVector(handle, [&](auto copyObjPtr) {
+                copyObjPtr->elements = Runtime::copyElements(static_pointer_cast<
+                        typename decltype(copyObjPtr)::element_type>(schemeObjPtr));
+                heap->account(copyObjPtr->elements.size() * sizeof(typename decltype(copyObjPtr)::element_type::value_type));
+            });
+            copies[hos] = handle;
+            return handle;
+        }
+        case IrisObjectType::HASHTABLE: {
+            auto hashTableObjPtr = static_pointer_cast<HashTableObject>(schemeObjPtr);
+            vector<pair<HandleOrStr, HandleOrStr>> entries;
+            {
+                std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+                for (auto &slot : hashTableObjPtr->slots) {
+                    if (slot.state == HashTableObject::SlotState::FULL) {
+                        entries.emplace_back(slot.key, slot.value);
+                    }
+                }
+            }
 
-void Runtime::ailPause() {
-    this->currentProcessPtr->state = ProcessState::SUSPENDED;
+            Handle handle = heap->makeHashTable(RUNTIME_PREFIX, TOP_NODE_HANDLE, hashTableObjPtr->isEqualTable);
+            auto copyObjPtr = static_pointer_cast<HashTableObject>(heap->get(handle));
+            copies[hos] = handle;
+            // a copied key has a new handle, so the keys are hashed again
+            for (auto &entry : entries) {
+                HandleOrStr key = this->copyMessage(entry.first, copies);
+                HandleOrStr value = this->copyMessage(entry.second, copies);
+                this->setHashEntry(copyObjPtr, key, this->hashKey(copyObjPtr, key), value);
+            }
+            return handle;
+        }
+        case IrisObjectType::STRINGBUILDER: {
+            auto builderObjPtr = static_pointer_cast<StringBuilderObject>(schemeObjPtr);
+            Handle handle = heap->makeStringBuilder(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+            auto copyObjPtr = static_pointer_cast<StringBuilderObject>(heap->get(handle));
+            {
+                std::lock_guard<std::mutex> lock(builderObjPtr->mutex);
+                copyObjPtr->buffer = builderObjPtr->buffer;
+            }
+            heap->account(copyObjPtr->buffer.size());
+            copies[hos] = handle;
+            return handle;
+        }
+        default:
+            return hos;
+    }
 }
 
-void Runtime::ailSetchild() {
+// (receive) or (receive timeout-ms), returns the oldest message, or #f once the timeout is over
+// with no message the process sleeps and the instruction runs again when it wakes, the arguments are popped
+// only the first time
+void Runtime::ailReceive() {
+    auto processPtr = this->currentProcessPtr;
+    auto now = std::chrono::steady_clock::now();
 
-}
+    if (!processPtr->isReceiving) {
+        auto hoses = this->popOperandsToPushend();
+        if (hoses.size() > 1) {
+            string errorMessage = utils::createArgumentsNumberErrorMessage("receive", 1, hoses.size());
+            utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+        }
 
-void Runtime::ailConcat() {
+        processPtr->receiveDeadline = std::chrono::steady_clock::time_point::max();
+        if (hoses.size() == 1) {
+            if (typeOfStr(hoses[0]) != Type::NUMBER || stod(hoses[0]) < 0) {
+                string errorMessage = utils::createArgumentTypeErrorMessage("receive", "timeout", "non-negative number",
+                                                                            this->toType(hoses[0]));
+                utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+            }
+            processPtr->receiveDeadline = now + std::chrono::microseconds((int64_t) (stod(hoses[0]) * 1000));
+        }
+        processPtr->isReceiving = true;
 
-}
+        if (processPtr->receiveDeadline != std::chrono::steady_clock::time_point::max()) {
+            this->scheduler->addTimer(processPtr->receiveDeadline, processPtr.get());
+        }
+    }
 
-void Runtime::ailDuplicate() {
+    string message;
+    if (processPtr->mailbox.pop(message)) {
+        processPtr->pushOperand(message);
+    } else if (now >= processPtr->receiveDeadline) {
+        processPtr->pushOperand("#f");
+    } else {
+        processPtr->state = ProcessState::SLEEPING;
+        return;
+    }
 
+    processPtr->isReceiving = false;
+    processPtr->step();
 }
 
-void Runtime::ailCar() {
-    auto hoses = this->popOperands(1);
-    this->checkWrongArgumentsNumberError("car", 1, hoses.size());
+void Runtime::ailCurrentPid() {
+    auto hoses = this->popOperandsToPushend();
+    this->checkWrongArgumentsNumberError("current-pid", 0, hoses.size());
+
+    this->currentProcessPtr->pushOperand(to_string(this->currentProcessPtr->pid));
+    this->currentProcessPtr->step();
+}
+
+// (yield) ends the time slice of the current process
+void Runtime::ailYield() {
+    auto hoses = this->popOperandsToPushend();
+    this->checkWrongArgumentsNumberError("yield", 0, hoses.size());
+
+    this->currentProcessPtr->state = ProcessState::READY;
+    this->currentProcessPtr->step();
+}
+
+// (sleep ms) puts the current process to sleep for ms milliseconds, the other processes keep running
+void Runtime::ailSleep() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("sleep", 1, hoses.size());
+    auto deadline = this->getDeadline("sleep", hoses[0]);
+
+    auto processPtr = this->currentProcessPtr;
+    processPtr->step();
+    processPtr->sleepDeadline = deadline;
+    this->scheduler->addTimer(deadline, processPtr.get());
+    processPtr->state = ProcessState::SLEEPING;
+}
+
+// (after ms thunk) runs thunk in a new process in ms milliseconds, and returns its pid
+void Runtime::ailAfter() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("after", 2, hoses.size());
+    auto deadline = this->getDeadline("after", hoses[0]);
+
+    if (typeOfStr(hoses[1]) != Type::HANDLE ||
+        this->currentProcessPtr->heap->get(hoses[1])->irisObjectType != IrisObjectType::CLOSURE) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("after", "argument", "lambda",
+                                                                    this->toType(hoses[1]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    auto closurePtr = this->currentProcessPtr->getClosurePtr(hoses[1]);
+    PID pid = this->allocatePID();
+    auto processPtr = std::make_shared<Process>(pid, *this->currentProcessPtr, closurePtr);
+    // its first slice puts it to sleep
+    processPtr->sleepDeadline = deadline;
+    this->scheduler->addTimer(deadline, processPtr.get());
+    this->addProcess(processPtr);
+
+    this->currentProcessPtr->pushOperand(to_string(pid));
+    this->currentProcessPtr->step();
+}
+
+std::chrono::steady_clock::time_point Runtime::getDeadline(const string &functionName, const HandleOrStr &ms) {
+    if (typeOfStr(ms) != Type::NUMBER || stod(ms) < 0) {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "argument", "non-negative number",
+                                                                    this->toType(ms));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    return std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t) (stod(ms) * 1000));
+}
+
+// (set-priority! 'high), 'normal or 'low, for the current process and the processes it forks from now on
+void Runtime::ailSetPriority() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("set-priority!", 1, hoses.size());
+
+    string level = this->toHashKey(hoses[0]);
+    if (level == "'high") {
+        this->currentProcessPtr->priority = ProcessPriority::HIGH;
+    } else if (level == "'normal") {
+        this->currentProcessPtr->priority = ProcessPriority::NORMAL;
+    } else if (level == "'low") {
+        this->currentProcessPtr->priority = ProcessPriority::LOW;
+    } else {
+        string errorMessage = utils::createArgumentTypeErrorMessage("set-priority!", "argument", "'high, 'normal or 'low",
+                                                                    level);
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->step();
+}
+
+// (set-reduction-budget! n) sets the time slice of the current process to n instructions, 0 for the runtime's
+void Runtime::ailSetReductionBudget() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("set-reduction-budget!", 1, hoses.size());
+
+    if (typeOfStr(hoses[0]) != Type::NUMBER || !utils::double_is_int(stod(hoses[0])) || stod(hoses[0]) < 0) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("set-reduction-budget!", "argument",
+                                                                    "non-negative integer", this->toType(hoses[0]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->reductionBudget = (int) stod(hoses[0]);
+    this->currentProcessPtr->step();
+}
+
+//=================================================================
+//                      Future
+//=================================================================
+
+// (future expression) starts expression in a new process and returns a future of its value at once
+// the compiler has made expression a thunk, see Transfer::transferFuture
+void Runtime::ailFuture() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("future", 1, hoses.size());
+
+    auto closurePtr = this->currentProcessPtr->getClosurePtr(hoses[0]);
+    Handle handle = this->currentProcessPtr->heap->makeFuture(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+
+    auto processPtr = make_shared<Process>(this->allocatePID(), *this->currentProcessPtr, closurePtr);
+    processPtr->futurePtr = static_pointer_cast<FutureObject>(this->currentProcessPtr->heap->get(handle));
+    this->addProcess(processPtr);
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (touch future) is the value of future, the process sleeps until it is resolved. any other value is its own value
+// like receive, the instruction runs again each time the process wakes
+void Runtime::ailTouch() {
+    auto processPtr = this->currentProcessPtr;
+
+    if (processPtr->touchedFuturePtr == nullptr) {
+        auto hoses = this->popOperands(1);
+        this->checkWrongArgumentsNumberError("touch", 1, hoses.size());
+
+        if (typeOfStr(hoses[0]) != Type::HANDLE ||
+            processPtr->heap->get(hoses[0])->irisObjectType != IrisObjectType::FUTURE) {
+            processPtr->pushOperand(hoses[0]);
+            processPtr->step();
+            return;
+        }
+        processPtr->touchedFuturePtr = static_pointer_cast<FutureObject>(processPtr->heap->get(hoses[0]));
+    }
+
+    auto futurePtr = processPtr->touchedFuturePtr;
+    {
+        std::lock_guard<std::mutex> lock(futurePtr->mutex);
+        if (!futurePtr->isResolved) {
+            if (std::find(futurePtr->waitingPids.begin(), futurePtr->waitingPids.end(), processPtr->pid) ==
+                futurePtr->waitingPids.end()) {
+                futurePtr->waitingPids.push_back(processPtr->pid);
+            }
+            processPtr->state = ProcessState::SLEEPING;
+            return;
+        }
+    }
+    if (!futurePtr->error.empty()) {
+        processPtr->touchedFuturePtr = nullptr;
+        throw ResourceLimitError("the future failed: " + futurePtr->error);
+    }
+
+    processPtr->pushOperand(futurePtr->value);
+    processPtr->touchedFuturePtr = nullptr;
+    processPtr->step();
+}
+
+void Runtime::ailIsFuture() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("future?", 1, hoses.size());
+
+    bool isFuture = typeOfStr(hoses[0]) == Type::HANDLE &&
+                    this->currentProcessPtr->heap->get(hoses[0])->irisObjectType == IrisObjectType::FUTURE;
+    this->currentProcessPtr->pushOperand(isFuture ? "#t" : "#f");
+    this->currentProcessPtr->step();
+}
+
+// called when the thunk of a future's process returns
+void Runtime::resolveFuture() {
+    auto processPtr = this->currentProcessPtr;
+    auto futurePtr = processPtr->futurePtr;
+
+    vector<int> waitingPids;
+    {
+        std::lock_guard<std::mutex> lock(futurePtr->mutex);
+        futurePtr->value = processPtr->popOperand();
+        futurePtr->isResolved = true;
+        waitingPids.swap(futurePtr->waitingPids);
+    }
+    for (PID pid : waitingPids) {
+        this->scheduler->wake(this->scheduler->getProcess(pid).get());
+    }
+
+    processPtr->futurePtr = nullptr;
+    processPtr->state = ProcessState::STOPPED;
+}
+
+// the other processes go on, what waits for this one gets the error instead of a value
+void Runtime::stopOnLimit(const string &message) {
+    auto processPtr = this->currentProcessPtr;
+    if (utils::isPrintingErrors) {
+        std::lock_guard<std::mutex> lock(Runtime::outputMutex);
+        string prefix = utils::generatePrefix(RUNTIME_PREFIX_TITLE);
+        cout << prefix << endl;
+        cout << "Description: [ResourceLimitError] " + message + ", process " + to_string(processPtr->pid) +
+                " is stopped" << endl;
+        cout << utils::generatePostfix(prefix.size()) << endl;
+    }
+    processPtr->error = message;
+    processPtr->state = ProcessState::STOPPED;
+
+    if (processPtr->futurePtr != nullptr) {
+        auto futurePtr = processPtr->futurePtr;
+        vector<int> waitingPids;
+        {
+            std::lock_guard<std::mutex> lock(futurePtr->mutex);
+            futurePtr->error = message;
+            futurePtr->isResolved = true;
+            waitingPids.swap(futurePtr->waitingPids);
+        }
+        for (PID pid : waitingPids) {
+            this->scheduler->wake(this->scheduler->getProcess(pid).get());
+        }
+        processPtr->futurePtr = nullptr;
+    }
+
+    if (processPtr->chunkJobPtr != nullptr) {
+        auto jobPtr = processPtr->chunkJobPtr;
+        {
+            std::lock_guard<std::mutex> lock(jobPtr->errorMutex);
+            if (jobPtr->error.empty()) {
+                jobPtr->error = message;
+            }
+        }
+        processPtr->chunkJobPtr = nullptr;
+        if (--jobPtr->pendingChunks == 0) {
+            this->scheduler->wake(jobPtr->parentPtr);
+        }
+    }
+}
+
+//=================================================================
+//              Parallel map and reduce (functools.pmap, functools.preduce)
+//=================================================================
+
+// (parallel-map f list) is (f x) for every x of list, in list's order
+// the list is cut into chunks, a process runs each chunk, and the workers run the processes in parallel
+void Runtime::ailParallelMap() {
+    this->runParallelJob("parallel-map", false);
+}
+
+// (parallel-reduce f list init) is (f ... (f (f init x0) x1) ... xn), f must be associative:
+// the chunks are reduced in parallel, then their results, until one is left
+void Runtime::ailParallelReduce() {
+    this->runParallelJob("parallel-reduce", true);
+}
+
+// like receive, the process sleeps until its chunks are done and runs the instruction again when it wakes
+void Runtime::runParallelJob(const string &functionName, bool isReduce) {
+    auto processPtr = this->currentProcessPtr;
+
+    if (processPtr->joinedJobPtr == nullptr) {
+        auto hoses = this->popOperands(isReduce ? 3 : 2);
+        this->checkWrongArgumentsNumberError(functionName, isReduce ? 3 : 2, hoses.size());
+
+        auto jobPtr = make_shared<ParallelJob>();
+        jobPtr->isReduce = isReduce;
+        jobPtr->parentPtr = processPtr.get();
+        if (typeOfStr(hoses[0]) == Type::HANDLE &&
+            processPtr->heap->get(hoses[0])->irisObjectType == IrisObjectType::CLOSURE) {
+            jobPtr->closurePtr = processPtr->getClosurePtr(hoses[0]);
+        } else if (typeOfStr(hoses[0]) == Type::KEYWORD) {
+            jobPtr->primitive = hoses[0];
+        } else {
+            string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "first argument",
+                                                                        "lambda or primitive", this->toType(hoses[0]));
+            utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+        }
+
+        int offset;
+        auto listObjPtr = this->getListObjPtr(hoses[1], offset);
+        if (listObjPtr == nullptr) {
+            string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "second argument", "list",
+                                                                        this->toType(hoses[1]));
+            utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+        }
+
+        // reducing init and the list together leaves init on the left of the result
+        if (isReduce) {
+            jobPtr->inputs.push_back(hoses[2]);
+        }
+        jobPtr->inputs.insert(jobPtr->inputs.end(), listObjPtr->childrenHoses.begin() + offset,
+                              listObjPtr->childrenHoses.end());
+
+        processPtr->joinedJobPtr = jobPtr;
+        if (!isReduce || jobPtr->inputs.size() > 1) {
+            this->startParallelRound(jobPtr);
+        } else {
+            jobPtr->results = jobPtr->inputs;
+        }
+    }
+
+    auto jobPtr = processPtr->joinedJobPtr;
+    if (jobPtr->pendingChunks > 0) {
+        processPtr->state = ProcessState::SLEEPING;
+        return;
+    }
+    if (!jobPtr->error.empty()) {
+        processPtr->joinedJobPtr = nullptr;
+        throw ResourceLimitError(functionName + " failed: " + jobPtr->error);
+    }
+    if (isReduce && jobPtr->results.size() > 1) {
+        jobPtr->inputs = std::move(jobPtr->results);
+        this->startParallelRound(jobPtr);
+        processPtr->state = ProcessState::SLEEPING;
+        return;
+    }
+
+    if (isReduce) {
+        processPtr->pushOperand(jobPtr->results[0]);
+    } else {
+        Handle handle = processPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+        auto listObjPtr = static_pointer_cast<ListObject>(processPtr->heap->get(handle));
+        listObjPtr->childrenHoses = std::move(jobPtr->results);
+        processPtr->pushOperand(handle);
+    }
+    processPtr->joinedJobPtr = nullptr;
+    processPtr->step();
+}
+
+// a few chunks per worker, so that a slow chunk can be balanced by the others through stealing
+void Runtime::startParallelRound(const shared_ptr<ParallelJob> &jobPtr) {
+    size_t inputCount = jobPtr->inputs.size();
+    size_t maxChunkCount = (size_t) this->scheduler->workerCount * 4;
+    // a reduce chunk of a single input would not reduce anything
+    size_t minChunkSize = jobPtr->isReduce ? 2 : 1;
+    size_t chunkSize = std::max(minChunkSize, (inputCount + maxChunkCount - 1) / maxChunkCount);
+    size_t chunkCount = (inputCount + chunkSize - 1) / chunkSize;
+
+    jobPtr->results.assign(jobPtr->isReduce ? chunkCount : inputCount, "");
+
+    vector<shared_ptr<Process>> chunkProcesses;
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+        size_t chunkBegin = chunkIndex * chunkSize;
+        size_t chunkEnd = std::min(chunkBegin + chunkSize, inputCount);
+        if (jobPtr->isReduce && chunkEnd - chunkBegin == 1) {
+            jobPtr->results[chunkIndex] = jobPtr->inputs[chunkBegin];
+            continue;
+        }
+
+        auto closurePtr = jobPtr->closurePtr ? jobPtr->closurePtr : this->currentProcessPtr->currentClosurePtr;
+        auto chunkProcessPtr = make_shared<Process>(this->allocatePID(), *this->currentProcessPtr, closurePtr);
+        chunkProcessPtr->chunkJobPtr = jobPtr;
+        chunkProcessPtr->chunkIndex = chunkIndex;
+        chunkProcessPtr->chunkBegin = chunkBegin;
+        chunkProcessPtr->chunkEnd = chunkEnd;
+        chunkProcessPtr->chunkNext = chunkBegin;
+        chunkProcesses.push_back(chunkProcessPtr);
+    }
+
+    // counted before any chunk can run and finish
+    jobPtr->pendingChunks = (int) chunkProcesses.size();
+    for (auto &chunkProcessPtr : chunkProcesses) {
+        if (jobPtr->closurePtr != nullptr) {
+            auto parentProcessPtr = this->currentProcessPtr;
+            this->currentProcessPtr = chunkProcessPtr;
+            this->startChunkCall();
+            this->currentProcessPtr = parentProcessPtr;
+        }
+        this->addProcess(chunkProcessPtr);
+    }
+}
+
+// pushes the arguments of the next call of the chunk and jumps to the closure: (f x) to map, (f accumulator x)
+// to reduce, a reduce chunk starts with its first input as the accumulator
+void Runtime::startChunkCall() {
+    auto processPtr = this->currentProcessPtr;
+    auto &jobPtr = processPtr->chunkJobPtr;
+
+    if (jobPtr->isReduce && processPtr->chunkNext == processPtr->chunkBegin) {
+        processPtr->accumulator = jobPtr->inputs[processPtr->chunkNext++];
+    }
+    processPtr->pushOperand(jobPtr->inputs[processPtr->chunkNext++]);
+    if (jobPtr->isReduce) {
+        processPtr->pushOperand(processPtr->accumulator);
+    }
+    processPtr->gotoAddress(processPtr->currentClosurePtr->instructionAddress);
+}
+
+void Runtime::finishChunkCall() {
+    auto processPtr = this->currentProcessPtr;
+    auto &jobPtr = processPtr->chunkJobPtr;
+
+    HandleOrStr result = processPtr->popOperand();
+    if (jobPtr->isReduce) {
+        processPtr->accumulator = result;
+    } else {
+        jobPtr->results[processPtr->chunkNext - 1] = result;
+    }
+
+    if (processPtr->chunkNext < processPtr->chunkEnd) {
+        this->startChunkCall();
+    } else {
+        this->finishChunk();
+    }
+}
+
+// the last chunk to finish wakes the process waiting for the job
+void Runtime::finishChunk() {
+    auto processPtr = this->currentProcessPtr;
+    auto jobPtr = processPtr->chunkJobPtr;
+
+    if (jobPtr->isReduce) {
+        jobPtr->results[processPtr->chunkIndex] = processPtr->accumulator;
+    }
+    processPtr->state = ProcessState::STOPPED;
+    processPtr->chunkJobPtr = nullptr;
+    if (--jobPtr->pendingChunks == 0) {
+        this->scheduler->wake(jobPtr->parentPtr);
+    }
+}
+
+void Runtime::runPrimitiveChunk() {
+    auto processPtr = this->currentProcessPtr;
+    auto &jobPtr = processPtr->chunkJobPtr;
+
+    size_t i = processPtr->chunkBegin;
+    if (jobPtr->isReduce) {
+        processPtr->accumulator = jobPtr->inputs[i++];
+    }
+    for (; i < processPtr->chunkEnd; ++i) {
+        if (jobPtr->isReduce) {
+            processPtr->accumulator = this->callPrimitive(jobPtr->primitive, {processPtr->accumulator, jobPtr->inputs[i]});
+        } else {
+            jobPtr->results[i] = this->callPrimitive(jobPtr->primitive, {jobPtr->inputs[i]});
+        }
+    }
+    this->finishChunk();
+}
+
+// calls the primitive the way a compiled application does: the arguments between two pushend markers
+HandleOrStr Runtime::callPrimitive(const string &primitive, const vector<HandleOrStr> &arguments) {
+    auto processPtr = this->currentProcessPtr;
+    int PC = processPtr->PC;
+
+    string pushend = PUSHEND + "." + RUNTIME_PREFIX;
+    processPtr->pushOperand(pushend);
+    for (auto it = arguments.rbegin(); it != arguments.rend(); ++it) {
+        processPtr->pushOperand(*it);
+    }
+    processPtr->pushOperand(pushend);
+    this->execute(Instruction(primitiveInstructionMap.count(primitive) ? primitiveInstructionMap[primitive] : primitive));
+
+    HandleOrStr result = processPtr->popOperand();
+    // a primitive with a fixed number of arguments leaves a pushend marker behind
+    processPtr->opStack.clear();
+    processPtr->pushendStack.clear();
+    processPtr->PC = PC;
+    return result;
+}
+
+// (newline) or (newline port)
+void Runtime::ailNewline() {
+    auto processPtr = this->currentProcessPtr;
+    bool isResuming = processPtr->isResuming;
+    auto hoses = isResuming ? this->popOperandsOrResume(0) : this->popOperandsToPushend();
+    if (hoses.size() > 1) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("newline", 1, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    if (hoses.empty()) {
+        this->output("", true);
+        processPtr->step();
+        return;
+    }
+
+    auto portObjPtr = this->getConnectionObjPtr("newline", hoses[0]);
+    if (!isResuming) {
+        portObjPtr->outputBuffer += '\n';
+    }
+    this->flushPort(portObjPtr, hoses);
+}
+
+//=================================================================
+//                      Ports
+//=================================================================
+
+// the descriptors of ports are non-blocking, an instruction that would block makes the process sleep until the
+// reactor sees the descriptor ready, and then runs again with the same operands
+
+vector<HandleOrStr> Runtime::popOperandsOrResume(int num) {
+    auto processPtr = this->currentProcessPtr;
+    if (!processPtr->isResuming) {
+        return this->popOperands(num);
+    }
+
+    processPtr->isResuming = false;
+    return std::move(processPtr->suspendedOperands);
+}
+
+void Runtime::waitForPort(const shared_ptr<PortObject> &portObjPtr, uint32_t events, vector<HandleOrStr> hoses) {
+    auto processPtr = this->currentProcessPtr;
+    processPtr->suspendedOperands = std::move(hoses);
+    processPtr->isResuming = true;
+    processPtr->state = ProcessState::SLEEPING;
+    this->scheduler->reactor.waitFor(portObjPtr->fd, events, processPtr.get());
+}
+
+bool Runtime::fillInputBuffer(const shared_ptr<PortObject> &portObjPtr) {
+    char chunk[1 << 16];
+    ssize_t size = ::read(portObjPtr->fd, chunk, sizeof(chunk));
+    if (size > 0) {
+        portObjPtr->inputBuffer.append(chunk, size);
+    } else if (size == 0) {
+        portObjPtr->isEof = true;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;
+    } else if (errno != EINTR) {
+        utils::raiseError("[IOError] cannot read: " + string(strerror(errno)), RUNTIME_PREFIX_TITLE);
+    }
+    return true;
+}
+
+// (read port) returns the characters available on port, or #f at the end of the input
+void Runtime::ailRead() {
+    auto hoses = this->popOperandsOrResume(1);
+    this->checkWrongArgumentsNumberError("read", 1, hoses.size());
+    auto portObjPtr = this->getPortObjPtr("read", hoses[0]);
+
+    while (portObjPtr->inputBuffer.empty() && !portObjPtr->isEof) {
+        if (!this->fillInputBuffer(portObjPtr)) {
+            this->waitForPort(portObjPtr, EPOLLIN, hoses);
+            return;
+        }
+    }
+
+    if (portObjPtr->inputBuffer.empty()) {
+        this->currentProcessPtr->pushOperand("#f");
+    } else {
+        string content = std::move(portObjPtr->inputBuffer);
+        portObjPtr->inputBuffer.clear();
+        this->currentProcessPtr->pushOperand(this->currentProcessPtr->heap->makeString(RUNTIME_PREFIX, std::move(content)));
+    }
+    this->currentProcessPtr->step();
+}
+
+// (read-line port) returns the next line without its newline, or #f at the end of the input
+void Runtime::ailReadLine() {
+    auto hoses = this->popOperandsOrResume(1);
+    this->checkWrongArgumentsNumberError("read-line", 1, hoses.size());
+    auto portObjPtr = this->getPortObjPtr("read-line", hoses[0]);
+
+    size_t newline;
+    while ((newline = portObjPtr->inputBuffer.find('\n')) == string::npos && !portObjPtr->isEof) {
+        if (!this->fillInputBuffer(portObjPtr)) {
+            this->waitForPort(portObjPtr, EPOLLIN, hoses);
+            return;
+        }
+    }
+
+    auto &inputBuffer = portObjPtr->inputBuffer;
+    if (newline != string::npos) {
+        string line = inputBuffer.substr(0, newline);
+        inputBuffer.erase(0, newline + 1);
+        this->currentProcessPtr->pushOperand(this->currentProcessPtr->heap->makeString(RUNTIME_PREFIX, std::move(line)));
+    } else if (!inputBuffer.empty()) {
+        // the last line has no newline
+        string line = std::move(inputBuffer);
+        inputBuffer.clear();
+        this->currentProcessPtr->pushOperand(this->currentProcessPtr->heap->makeString(RUNTIME_PREFIX, std::move(line)));
+    } else {
+        this->currentProcessPtr->pushOperand("#f");
+    }
+    this->currentProcessPtr->step();
+}
+
+// (write obj) or (write obj port), a string is written as its characters, other values as display prints them
+void Runtime::ailWrite() {
+    auto processPtr = this->currentProcessPtr;
+    bool isResuming = processPtr->isResuming;
+    auto hoses = isResuming ? this->popOperandsOrResume(0) : this->popOperandsToPushend();
+    if (hoses.empty() || hoses.size() > 2) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("write", 2, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    string content;
+    if (!isResuming) {
+        auto objPtr = typeOfStr(hoses[0]) == Type::HANDLE ? processPtr->heap->get(hoses[0]) : nullptr;
+        if (objPtr != nullptr && objPtr->irisObjectType == IrisObjectType::STRING) {
+            content = string(static_pointer_cast<StringObject>(objPtr)->content());
+        } else {
+            content = this->toStr(hoses[0]);
+        }
+    }
+
+    if (hoses.size() == 1) {
+        this->output(content, false);
+        processPtr->step();
+        return;
+    }
+
+    auto portObjPtr = this->getConnectionObjPtr("write", hoses[1]);
+    portObjPtr->outputBuffer += content;
+    this->flushPort(portObjPtr, hoses);
+}
+
+void Runtime::flushPort(const shared_ptr<PortObject> &portObjPtr, vector<HandleOrStr> hoses) {
+    auto &outputBuffer = portObjPtr->outputBuffer;
+    size_t sent = 0;
+    while (sent < outputBuffer.size()) {
+        ssize_t size = ::send(portObjPtr->fd, outputBuffer.data() + sent, outputBuffer.size() - sent, MSG_NOSIGNAL);
+        if (size >= 0) {
+            sent += size;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            outputBuffer.erase(0, sent);
+            this->waitForPort(portObjPtr, EPOLLOUT, std::move(hoses));
+            return;
+        } else if (errno != EINTR) {
+            outputBuffer.clear();
+            utils::raiseError("[IOError] cannot write: " + string(strerror(errno)), RUNTIME_PREFIX_TITLE);
+        }
+    }
+    outputBuffer.clear();
+    this->currentProcessPtr->step();
+}
+
+// (open-input-file path)
+void Runtime::ailOpenInputFile() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("open-input-file", 1, hoses.size());
+    string path(this->getStringObjPtr("open-input-file", hoses[0])->content());
+
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        utils::raiseError("[IOError] cannot open " + path + ": " + strerror(errno), RUNTIME_PREFIX_TITLE);
+    }
+
+    Handle handle = this->currentProcessPtr->heap->makePort(RUNTIME_PREFIX, TOP_NODE_HANDLE, fd,
+                                                            PortObject::PortKind::INPUT_FILE);
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+        this->getPortObjPtr("open-input-file", handle)->isPollable = false;
+    }
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (tcp-listen port-number) listens on 127.0.0.1
+void Runtime::ailTcpListen() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("tcp-listen", 1, hoses.size());
+    if (typeOfStr(hoses[0]) != Type::NUMBER || !utils::double_is_int(stod(hoses[0]))) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("tcp-listen", "argument", "integer",
+                                                                    this->toType(hoses[0]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t) stod(hoses[0]));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (sockaddr *) &address, sizeof(address)) < 0 || listen(fd, 128) < 0) {
+        string reason = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        utils::raiseError("[IOError] cannot listen on " + hoses[0] + ": " + reason, RUNTIME_PREFIX_TITLE);
+    }
+
+    Handle handle = this->currentProcessPtr->heap->makePort(RUNTIME_PREFIX, TOP_NODE_HANDLE, fd,
+                                                            PortObject::PortKind::LISTENER);
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (tcp-accept listener) returns the port of the next connection
+void Runtime::ailTcpAccept() {
+    auto hoses = this->popOperandsOrResume(1);
+    this->checkWrongArgumentsNumberError("tcp-accept", 1, hoses.size());
+    auto listenerObjPtr = this->getPortObjPtr("tcp-accept", hoses[0]);
+    if (listenerObjPtr->kind != PortObject::PortKind::LISTENER) {
+        utils::raiseError("[IOError] tcp-accept's port is not a listener", RUNTIME_PREFIX_TITLE);
+    }
+
+    int fd;
+    while ((fd = accept4(listenerObjPtr->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            this->waitForPort(listenerObjPtr, EPOLLIN, hoses);
+            return;
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            utils::raiseError("[IOError] cannot accept: " + string(strerror(errno)), RUNTIME_PREFIX_TITLE);
+        }
+    }
+
+    Handle handle = this->currentProcessPtr->heap->makePort(RUNTIME_PREFIX, TOP_NODE_HANDLE, fd,
+                                                            PortObject::PortKind::CONNECTION);
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (tcp-connect host port-number), host is "localhost" or an IPv4 address, names are not resolved since
+// resolving blocks
+// a connection in progress is kept as a third operand while the process waits
+void Runtime::ailTcpConnect() {
+    auto processPtr = this->currentProcessPtr;
+    bool isResuming = processPtr->isResuming;
+    auto hoses = isResuming ? this->popOperandsOrResume(0) : this->popOperands(2);
+
+    if (isResuming) {
+        auto portObjPtr = this->getPortObjPtr("tcp-connect", hoses[2]);
+        int error = 0;
+        socklen_t errorSize = sizeof(error);
+        getsockopt(portObjPtr->fd, SOL_SOCKET, SO_ERROR, &error, &errorSize);
+        if (error != 0) {
+            utils::raiseError("[IOError] cannot connect to " + this->toStr(hoses[0]) + ":" + hoses[1] + ": " +
+                              strerror(error), RUNTIME_PREFIX_TITLE);
+        }
+        processPtr->pushOperand(hoses[2]);
+        processPtr->step();
+        return;
+    }
+
+    this->checkWrongArgumentsNumberError("tcp-connect", 2, hoses.size());
+    string host(this->getStringObjPtr("tcp-connect", hoses[0])->content());
+    if (typeOfStr(hoses[1]) != Type::NUMBER || !utils::double_is_int(stod(hoses[1]))) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("tcp-connect", "argument", "integer",
+                                                                    this->toType(hoses[1]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t) stod(hoses[1]));
+    if (inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &address.sin_addr) != 1) {
+        utils::raiseError("[IOError] tcp-connect's host " + host + " is not an IPv4 address", RUNTIME_PREFIX_TITLE);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        utils::raiseError("[IOError] cannot create a socket: " + string(strerror(errno)), RUNTIME_PREFIX_TITLE);
+    }
+    Handle handle = processPtr->heap->makePort(RUNTIME_PREFIX, TOP_NODE_HANDLE, fd, PortObject::PortKind::CONNECTION);
+
+    if (connect(fd, (sockaddr *) &address, sizeof(address)) < 0) {
+        if (errno != EINPROGRESS) {
+            utils::raiseError("[IOError] cannot connect to " + host + ":" + hoses[1] + ": " + strerror(errno),
+                              RUNTIME_PREFIX_TITLE);
+        }
+        hoses.push_back(handle);
+        this->waitForPort(this->getPortObjPtr("tcp-connect", handle), EPOLLOUT, hoses);
+        return;
+    }
+
+    processPtr->pushOperand(handle);
+    processPtr->step();
+}
+
+// (close-port port)
+void Runtime::ailClosePort() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("close-port", 1, hoses.size());
+    auto portObjPtr = this->getPortObjPtr("close-port", hoses[0]);
+
+    if (portObjPtr->fd >= 0) {
+        if (portObjPtr->isPollable) {
+            this->scheduler->reactor.forget(portObjPtr->fd);
+        }
+        close(portObjPtr->fd);
+        portObjPtr->fd = -1;
+    }
+    this->currentProcessPtr->step();
+}
+
+// blank instruction, do nothing
+void Runtime::ailNop() {
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailPause() {
+    this->currentProcessPtr->state = ProcessState::SUSPENDED;
+}
+
+void Runtime::ailSetchild() {
+
+}
+
+// quasiquote pushes its elements followed by their count, collect them into a list
+void Runtime::ailConcat() {
+    auto countHoses = this->popOperands(1);
+    int count = stoi(countHoses[0]);
+
+    auto hoses = this->popOperands(count);
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+    listObjPtr->childrenHoses.assign(hoses.rbegin(), hoses.rend());
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailDuplicate() {
+
+}
+
+void Runtime::ailCar() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("car", 1, hoses.size());
+
+    HandleOrStr hos = hoses[0];
+    Type hosType = typeOfStr(hos);
+
+    if (hosType == Type::HANDLE) {
+        int offset;
+        shared_ptr<ListObject> listObjPtr = this->getListObjPtr(hos, offset);
+        if (listObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailCar] car's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+        } else if (listObjPtr->size(offset) <= 0) {
+            throw std::invalid_argument("[ailCar] car's argument should not be an empty List");
+        }
+        this->currentProcessPtr->pushOperand(listObjPtr->car(offset));
+
+    } else {
+        throw std::invalid_argument(
+                "[ailCar] car's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+    }
+    this->currentProcessPtr->step();
+
+}
+
+void Runtime::ailCdr() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("cdr", 1, hoses.size());
 
     HandleOrStr hos = hoses[0];
     Type hosType = typeOfStr(hos);
 
-    if (hosType == Type::HANDLE) {
-        shared_ptr<IrisObject> schemeObjectPtr = this->currentProcessPtr->heap.get(hos);
-        if (schemeObjectPtr->irisObjectType == IrisObjectType::LIST) {
-            shared_ptr<ListObject> listObjStr = static_pointer_cast<ListObject>(schemeObjectPtr);
-            this->currentProcessPtr->pushOperand(listObjStr->car());
-        } else {
-            throw std::invalid_argument(
-                    "[ailCar] car's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
-        }
+    if (hosType == Type::HANDLE) {
+        int offset;
+        shared_ptr<ListObject> listObjPtr = this->getListObjPtr(hos, offset);
+        if (listObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailCdr] cdr's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+        } else if (listObjPtr->size(offset) <= 0) {
+            throw std::invalid_argument("[ailCdr] cdr's argument should not be an empty List");
+        }
+
+        // no new list is made, the result is a view on the same list, one element further
+        this->currentProcessPtr->pushOperand(Heap::makeListView(listObjPtr->selfHandle, offset + 1));
+
+    } else {
+        throw std::invalid_argument(
+                "[ailCdr] cdr's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+    }
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailList() {
+    // create list, and push it
+    // is actually push handle_to_list
+
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+//    string argumentNum = this->currentProcessPtr->popOperand();
+
+    auto hoses = this->popOperandsToPushend();
+    for (auto hos : hoses) {
+        listObjPtr->addChild(hos);
+    }
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailCons() {
+    auto hoses = this->popOperands(2);
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    shared_ptr<ListObject> consListObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+
+    for (auto hos :hoses) {
+        int offset;
+        auto listObjPtr = this->getListObjPtr(hos, offset);
+        if (listObjPtr != nullptr) {
+            for (int i = offset; i < listObjPtr->childrenHoses.size(); i++) {
+                consListObjPtr->addChild(listObjPtr->childrenHoses[i]);
+            }
+        } else {
+            consListObjPtr->addChild(hos);
+        }
+    }
+    this->currentProcessPtr->heap->account(consListObjPtr->childrenHoses.size() * sizeof(HandleOrStr));
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+//=================================================================
+//                          Vector
+//=================================================================
+
+// (vector e0 e1 ...), also used by the #(e0 e1 ...) literal
+void Runtime::ailVector() {
+    Handle handle = this->currentProcessPtr->heap->makeVector(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto vectorObjPtr = static_pointer_cast<VectorObject>(this->currentProcessPtr->heap->get(handle));
+
+    auto hoses = this->popOperandsToPushend();
+    vectorObjPtr->elements = std::move(hoses);
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (make-vector k) or (make-vector k fill), fill is #f by default
+void Runtime::ailMakeVector() {
+    auto hoses = this->popOperandsToPushend();
+    if (hoses.empty() || hoses.size() > 2) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("make-vector", 1, 2, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    int size = this->toVectorIndex("make-vector", hoses[0], INT_MAX);
+    HandleOrStr fill = hoses.size() == 2 ? hoses[1] : "#f";
+
+    this->currentProcessPtr->heap->account(size * sizeof(HandleOrStr));
+    Handle handle = this->currentProcessPtr->heap->makeVector(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto vectorObjPtr = static_pointer_cast<VectorObject>(this->currentProcessPtr->heap->get(handle));
+    vectorObjPtr->elements.assign(size, fill);
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailVectorRef() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("vector-ref", 2, hoses.size());
+
+    bool isNumericVector = this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) {
+        int index = this->toVectorIndex("vector-ref", hoses[1], vectorObjPtr->size());
+        this->currentProcessPtr->pushOperand(this->numberToStr(vectorObjPtr->elements[index]));
+    });
+
+    if (!isNumericVector) {
+        auto vectorObjPtr = this->getVectorObjPtr(hoses[0]);
+        if (vectorObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailVectorRef] vector-ref's first argument should be a Vector, but get a " + hoses[0]);
+        }
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        int index = this->toVectorIndex("vector-ref", hoses[1], vectorObjPtr->size());
+        this->currentProcessPtr->pushOperand(vectorObjPtr->elements[index]);
+    }
+    this->currentProcessPtr->step();
+}
+
+// like set!, vector-set! leaves nothing on the stack
+void Runtime::ailVectorSet() {
+    auto hoses = this->popOperands(3);
+    this->checkWrongArgumentsNumberError("vector-set!", 3, hoses.size());
+
+    bool isNumericVector = this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) {
+        int index = this->toVectorIndex("vector-set!", hoses[1], vectorObjPtr->size());
+        this->toNumber("vector-set!", hoses[2], vectorObjPtr->elements[index]);
+    });
+
+    if (!isNumericVector) {
+        auto vectorObjPtr = this->getVectorObjPtr(hoses[0]);
+        if (vectorObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailVectorSet] vector-set!'s first argument should be a Vector, but get a " + hoses[0]);
+        }
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        int index = this->toVectorIndex("vector-set!", hoses[1], vectorObjPtr->size());
+        vectorObjPtr->elements[index] = hoses[2];
+    }
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailVectorLength() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("vector-length", 1, hoses.size());
+
+    int size = -1;
+    this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) { size = vectorObjPtr->size(); });
+
+    if (size < 0) {
+        auto vectorObjPtr = this->getVectorObjPtr(hoses[0]);
+        if (vectorObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailVectorLength] vector-length's argument should be a Vector, but get a " + hoses[0]);
+        }
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        size = vectorObjPtr->size();
+    }
+
+    this->currentProcessPtr->pushOperand(to_string(size));
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailVectorToList() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("vector->list", 1, hoses.size());
+
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+
+    bool isNumericVector = this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) {
+        for (auto number : vectorObjPtr->elements) {
+            listObjPtr->addChild(this->numberToStr(number));
+        }
+    });
+
+    if (!isNumericVector) {
+        auto vectorObjPtr = this->getVectorObjPtr(hoses[0]);
+        if (vectorObjPtr == nullptr) {
+            throw std::invalid_argument(
+                    "[ailVectorToList] vector->list's argument should be a Vector, but get a " + hoses[0]);
+        }
+        listObjPtr->childrenHoses = Runtime::copyElements(vectorObjPtr);
+    }
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailListToVector() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("list->vector", 1, hoses.size());
+
+    int offset;
+    auto listObjPtr = this->getListObjPtr(hoses[0], offset);
+    if (listObjPtr == nullptr) {
+        throw std::invalid_argument("[ailListToVector] list->vector's argument should be a List, but get a " + hoses[0]);
+    }
+
+    Handle handle = this->currentProcessPtr->heap->makeVector(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto vectorObjPtr = static_pointer_cast<VectorObject>(this->currentProcessPtr->heap->get(handle));
+    vectorObjPtr->elements = listObjPtr->getChildrenHoses(offset);
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailIsVector() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("isVector", 1, hoses.size());
+
+    this->currentProcessPtr->pushOperand(this->getVectorObjPtr(hoses[0]) != nullptr ? "#t" : "#f");
+    this->currentProcessPtr->step();
+}
+
+shared_ptr<VectorObject> Runtime::getVectorObjPtr(HandleOrStr hos) {
+    if (typeOfStr(hos) != Type::HANDLE) {
+        return nullptr;
+    }
+
+    auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+    if (schemeObjPtr->irisObjectType != IrisObjectType::VECTOR) {
+        return nullptr;
+    }
+    return static_pointer_cast<VectorObject>(schemeObjPtr);
+}
+
+// numbers are stored as strings ("2" or "2.000000"), make sure hos is an integer in [0, size)
+int Runtime::toVectorIndex(string functionName, HandleOrStr hos, int size) {
+    if (typeOfStr(hos) != Type::NUMBER || !utils::double_is_int(stod(hos))) {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "index", "integer", this->toType(hos));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    double index = stod(hos);
+    if (index < 0 || index >= size) {
+        utils::raiseError("[IndexError] " + functionName + "'s index " + hos + " is out of range", RUNTIME_PREFIX_TITLE);
+    }
+    return (int) index;
+}
+
+//=================================================================
+//                  Numeric Vector (f64vector, s64vector)
+//=================================================================
+
+// (f64vector 1 2.5 ...) or (s64vector 1 2 ...)
+void Runtime::ailNumericVector(IrisObjectType numericVectorType) {
+    auto hoses = this->popOperandsToPushend();
+    string functionName = string(numericVectorType == IrisObjectType::F64VECTOR ? "f64vector" : "s64vector");
+
+    Handle handle = this->currentProcessPtr->heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE, numericVectorType);
+    this->visitNumericVector(handle, [&](auto vectorObjPtr) {
+        vectorObjPtr->elements.resize(hoses.size());
+        for (int i = 0; i < hoses.size(); ++i) {
+            this->toNumber(functionName, hoses[i], vectorObjPtr->elements[i]);
+        }
+    });
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// (make-f64vector k) or (make-f64vector k fill), fill is 0 by default
+void Runtime::ailMakeNumericVector(IrisObjectType numericVectorType) {
+    auto hoses = this->popOperandsToPushend();
+    string functionName = "make-" + string(numericVectorType == IrisObjectType::F64VECTOR ? "f64vector" : "s64vector");
+    if (hoses.empty() || hoses.size() > 2) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage(functionName, 1, 2, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    int size = this->toVectorIndex(functionName, hoses[0], INT_MAX);
+
+    this->currentProcessPtr->heap->account(size * sizeof(double));
+    Handle handle = this->currentProcessPtr->heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE, numericVectorType);
+    this->visitNumericVector(handle, [&](auto vectorObjPtr) {
+        typename decltype(vectorObjPtr)::element_type::value_type fill = 0;
+        if (hoses.size() == 2) {
+            this->toNumber(functionName, hoses[1], fill);
+        }
+        vectorObjPtr->elements.assign(size, fill);
+    });
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailListToNumericVector(IrisObjectType numericVectorType) {
+    auto hoses = this->popOperands(1);
+    string functionName = "list->" + string(numericVectorType == IrisObjectType::F64VECTOR ? "f64vector" : "s64vector");
+    this->checkWrongArgumentsNumberError(functionName, 1, hoses.size());
+
+    int offset;
+    auto listObjPtr = this->getListObjPtr(hoses[0], offset);
+    if (listObjPtr == nullptr) {
+        throw std::invalid_argument("[ailListToNumericVector] " + functionName + "'s argument should be a List, but get a " + hoses[0]);
+    }
+
+    Handle handle = this->currentProcessPtr->heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE, numericVectorType);
+    this->visitNumericVector(handle, [&](auto vectorObjPtr) {
+        vectorObjPtr->elements.resize(listObjPtr->size(offset));
+        for (int i = 0; i < vectorObjPtr->size(); ++i) {
+            this->toNumber(functionName, listObjPtr->childrenHoses[offset + i], vectorObjPtr->elements[i]);
+        }
+    });
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailNumericVectorArithmetic(string functionName, NumericKernels::Op op) {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError(functionName, 2, hoses.size());
+
+    this->currentProcessPtr->pushOperand(this->numericVectorArithmetic(functionName, op, hoses[0], hoses[1]));
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailNumericVectorCompare(string functionName, NumericKernels::Cmp cmp) {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError(functionName, 2, hoses.size());
+
+    this->currentProcessPtr->pushOperand(this->numericVectorCompare(functionName, cmp, hoses[0], hoses[1]));
+    this->currentProcessPtr->step();
+}
+
+// s64 op s64 stays a s64vector, except for '/', everything else is computed as a f64vector
+// a number operand is broadcast to the size of the vector operand
+Handle Runtime::numericVectorArithmetic(string functionName, NumericKernels::Op op, HandleOrStr hos1, HandleOrStr hos2) {
+    size_t size = this->getBulkSize(functionName, hos1, hos2);
+    bool isS64 = op != NumericKernels::Op::DIV && this->isS64Operand(hos1) && this->isS64Operand(hos2);
+    IrisObjectType resultType = isS64 ? IrisObjectType::S64VECTOR : IrisObjectType::F64VECTOR;
+
+    this->currentProcessPtr->heap->account(size * sizeof(double));
+    Handle handle = this->currentProcessPtr->heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE, resultType);
+    this->visitNumericVector(handle, [&](auto resultObjPtr) {
+        typedef typename decltype(resultObjPtr)::element_type::value_type T;
+        resultObjPtr->elements.resize(size);
+        this->runNumericKernel<T>(functionName, hos1, hos2, size, [&](const T *data1, const T *data2) {
+            NumericKernels::binary(op, data1, data2, resultObjPtr->elements.data(), size);
+        });
+    });
+    return handle;
+}
+
+// the result is a s64vector mask, 1 where the comparison holds and 0 elsewhere
+Handle Runtime::numericVectorCompare(string functionName, NumericKernels::Cmp cmp, HandleOrStr hos1, HandleOrStr hos2) {
+    size_t size = this->getBulkSize(functionName, hos1, hos2);
+
+    this->currentProcessPtr->heap->account(size * sizeof(int64_t));
+    Handle handle = this->currentProcessPtr->heap->makeNumericVector(RUNTIME_PREFIX, TOP_NODE_HANDLE,
+                                                                    IrisObjectType::S64VECTOR);
+    auto resultObjPtr = static_pointer_cast<S64VectorObject>(this->currentProcessPtr->heap->get(handle));
+    resultObjPtr->elements.resize(size);
+
+    auto compare = [&](const auto *data1, const auto *data2) {
+        NumericKernels::compare(cmp, data1, data2, resultObjPtr->elements.data(), size);
+    };
+    if (this->isS64Operand(hos1) && this->isS64Operand(hos2)) {
+        this->runNumericKernel<int64_t>(functionName, hos1, hos2, size, compare);
+    } else {
+        this->runNumericKernel<double>(functionName, hos1, hos2, size, compare);
+    }
+    return handle;
+}
+
+void Runtime::ailVectorSum() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("vector-sum", 1, hoses.size());
+
+    bool isNumericVector = this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) {
+        auto sum = NumericKernels::sum(vectorObjPtr->elements.data(), vectorObjPtr->elements.size());
+        this->currentProcessPtr->pushOperand(this->numberToStr(sum));
+    });
+
+    if (!isNumericVector) {
+        string errorMessage = utils::createArgumentTypeErrorMessage("vector-sum", "argument", "numeric vector",
+                                                                    this->toType(hoses[0]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailVectorDot() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("vector-dot", 2, hoses.size());
+
+    size_t size = this->getBulkSize("vector-dot", hoses[0], hoses[1]);
+    auto dot = [&](const auto *data1, const auto *data2) {
+        this->currentProcessPtr->pushOperand(this->numberToStr(NumericKernels::dot(data1, data2, size)));
+    };
+    if (this->isS64Operand(hoses[0]) && this->isS64Operand(hoses[1])) {
+        this->runNumericKernel<int64_t>("vector-dot", hoses[0], hoses[1], size, dot);
+    } else {
+        this->runNumericKernel<double>("vector-dot", hoses[0], hoses[1], size, dot);
+    }
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailVectorMinMax(bool isMin) {
+    string functionName = isMin ? "vector-min" : "vector-max";
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError(functionName, 1, hoses.size());
+
+    bool isNumericVector = this->visitNumericVector(hoses[0], [&](auto vectorObjPtr) {
+        if (vectorObjPtr->elements.empty()) {
+            utils::raiseError("[IndexError] " + functionName + " of an empty vector", RUNTIME_PREFIX_TITLE);
+        }
+        auto data = vectorObjPtr->elements.data();
+        auto size = vectorObjPtr->elements.size();
+        this->currentProcessPtr->pushOperand(
+                this->numberToStr(isMin ? NumericKernels::min(data, size) : NumericKernels::max(data, size)));
+    });
+
+    if (!isNumericVector) {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "argument", "numeric vector",
+                                                                    this->toType(hoses[0]));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->step();
+}
+
+// (vector-map op v1 v2), op is one of the primitives + - * / = < > <= >=
+void Runtime::ailVectorMap() {
+    auto hoses = this->popOperands(3);
+    this->checkWrongArgumentsNumberError("vector-map", 3, hoses.size());
+
+    static const map<string, NumericKernels::Op> ops = {
+            {"+", NumericKernels::Op::ADD},
+            {"-", NumericKernels::Op::SUB},
+            {"*", NumericKernels::Op::MUL},
+            {"/", NumericKernels::Op::DIV},
+    };
+    static const map<string, NumericKernels::Cmp> cmps = {
+            {"=",  NumericKernels::Cmp::EQ},
+            {"<",  NumericKernels::Cmp::LT},
+            {">",  NumericKernels::Cmp::GT},
+            {"<=", NumericKernels::Cmp::LE},
+            {">=", NumericKernels::Cmp::GE},
+    };
+
+    string primitive = hoses[0];
+    if (ops.count(primitive)) {
+        this->currentProcessPtr->pushOperand(
+                this->numericVectorArithmetic("vector-map", ops.at(primitive), hoses[1], hoses[2]));
+    } else if (cmps.count(primitive)) {
+        this->currentProcessPtr->pushOperand(
+                this->numericVectorCompare("vector-map", cmps.at(primitive), hoses[1], hoses[2]));
+    } else {
+        string errorMessage = utils::createArgumentTypeErrorMessage("vector-map", "first argument",
+                                                                    "primitive (+ - * / = < > <= >=)", hoses[0]);
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->step();
+}
+
+// calls f with the F64VectorObject or S64VectorObject behind hos, returns false if hos is not a numeric vector
+// f runs with the lock of the vector held, it must not lock another vector that is already shared
+template<typename F>
+bool Runtime::visitNumericVector(HandleOrStr hos, F f) {
+    if (typeOfStr(hos) != Type::HANDLE) {
+        return false;
+    }
+
+    auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+    if (schemeObjPtr->irisObjectType == IrisObjectType::F64VECTOR) {
+        auto vectorObjPtr = static_pointer_cast<F64VectorObject>(schemeObjPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        f(vectorObjPtr);
+        return true;
+    } else if (schemeObjPtr->irisObjectType == IrisObjectType::S64VECTOR) {
+        auto vectorObjPtr = static_pointer_cast<S64VectorObject>(schemeObjPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        f(vectorObjPtr);
+        return true;
+    }
+    return false;
+}
+
+template<typename VectorObjectType>
+decltype(VectorObjectType::elements) Runtime::copyElements(const shared_ptr<VectorObjectType> &vectorObjPtr) {
+    std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+    return vectorObjPtr->elements;
+}
+
+// the elements of a bulk operand as T, converted, or the number broadcast, into buffer
+template<typename T>
+const T *Runtime::getNumericData(string functionName, HandleOrStr hos, size_t size, vector<T> &buffer) {
+    const T *data = nullptr;
+    bool isNumericVector = this->visitNumericVector(hos, [&](auto vectorObjPtr) {
+        buffer.assign(vectorObjPtr->elements.begin(), vectorObjPtr->elements.end());
+        data = buffer.data();
+    });
 
+    if (!isNumericVector) {
+        T number;
+        this->toNumber(functionName, hos, number);
+        buffer.assign(size, number);
+        data = buffer.data();
+    }
+    return data;
+}
+
+// calls kernel(data1, data2) with the elements of both operands as T. the elements of a vector of T are used in place,
+// with the locks of both vectors held, only a vector of the other type or a number is copied into a buffer first
+template<typename T, typename Kernel>
+void Runtime::runNumericKernel(string functionName, HandleOrStr hos1, HandleOrStr hos2, size_t size, Kernel kernel) {
+    auto getVectorObjPtr = [&](const HandleOrStr &hos) -> shared_ptr<NumericVectorObject<T>> {
+        IrisObjectType vectorType = std::is_same_v<T, double> ? IrisObjectType::F64VECTOR : IrisObjectType::S64VECTOR;
+        if (typeOfStr(hos) != Type::HANDLE) {
+            return nullptr;
+        }
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+        if (schemeObjPtr->irisObjectType != vectorType) {
+            return nullptr;
+        }
+        return static_pointer_cast<NumericVectorObject<T>>(schemeObjPtr);
+    };
+    auto vectorObjPtr1 = getVectorObjPtr(hos1);
+    auto vectorObjPtr2 = getVectorObjPtr(hos2);
+
+    vector<T> buffer1, buffer2;
+    const T *data1 = vectorObjPtr1 != nullptr ? nullptr : this->getNumericData(functionName, hos1, size, buffer1);
+    const T *data2 = vectorObjPtr2 != nullptr ? nullptr : this->getNumericData(functionName, hos2, size, buffer2);
+
+    if (vectorObjPtr1 != nullptr && vectorObjPtr2 != nullptr && vectorObjPtr1 != vectorObjPtr2) {
+        std::scoped_lock lock(vectorObjPtr1->mutex, vectorObjPtr2->mutex);
+        kernel(vectorObjPtr1->elements.data(), vectorObjPtr2->elements.data());
+    } else if (vectorObjPtr1 != nullptr) {
+        // the same vector may be both operands
+        std::lock_guard<std::mutex> lock(vectorObjPtr1->mutex);
+        kernel(vectorObjPtr1->elements.data(), vectorObjPtr2 != nullptr ? vectorObjPtr1->elements.data() : data2);
+    } else if (vectorObjPtr2 != nullptr) {
+        std::lock_guard<std::mutex> lock(vectorObjPtr2->mutex);
+        kernel(data1, vectorObjPtr2->elements.data());
     } else {
-        throw std::invalid_argument(
-                "[ailCar] car's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+        kernel(data1, data2);
+    }
+}
+
+// both vector operands must have the same size, at least one operand must be a vector
+size_t Runtime::getBulkSize(string functionName, HandleOrStr hos1, HandleOrStr hos2) {
+    int size1 = -1, size2 = -1;
+    this->visitNumericVector(hos1, [&](auto vectorObjPtr) { size1 = vectorObjPtr->size(); });
+    this->visitNumericVector(hos2, [&](auto vectorObjPtr) { size2 = vectorObjPtr->size(); });
+
+    if (size1 < 0 && size2 < 0) {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "first argument", "numeric vector",
+                                                                    this->toType(hos1));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    if (size1 >= 0 && size2 >= 0 && size1 != size2) {
+        utils::raiseError("[SizeError] " + functionName + " expects vectors of the same size, " + to_string(size1) +
+                          " and " + to_string(size2) + " are given", RUNTIME_PREFIX_TITLE);
+    }
+    return size1 >= 0 ? size1 : size2;
+}
+
+bool Runtime::isS64Operand(HandleOrStr hos) {
+    if (typeOfStr(hos) == Type::NUMBER) {
+        return hos.find('.') == string::npos;
+    }
+    return typeOfStr(hos) == Type::HANDLE &&
+           this->currentProcessPtr->heap->get(hos)->irisObjectType == IrisObjectType::S64VECTOR;
+}
+
+void Runtime::toNumber(string functionName, HandleOrStr hos, double &number) {
+    char *end = nullptr;
+    if (!hos.empty() && (isdigit(hos[0]) || hos[0] == '-')) {
+        number = strtod(hos.c_str(), &end);
+    }
+    if (end == nullptr || *end != '\0') {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "element", "number", this->toType(hos));
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+}
+
+void Runtime::toNumber(string functionName, HandleOrStr hos, int64_t &number) {
+    double value;
+    this->toNumber(functionName, hos, value);
+    if (!utils::double_is_int(value)) {
+        string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "element", "integer", hos);
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+    // parse again as an integer, so that large integers don't lose precision through the double
+    number = hos.find('.') == string::npos ? strtoll(hos.c_str(), nullptr, 10) : (int64_t) value;
+}
+
+string Runtime::numberToStr(double number) {
+    return this->doubleToStr(number);
+}
+
+string Runtime::numberToStr(int64_t number) {
+    return to_string(number);
+}
+
+//=================================================================
+//                          String
+//=================================================================
+
+void Runtime::ailStringAppend() {
+    auto hoses = this->popOperandsToPushend();
+
+    vector<shared_ptr<StringObject>> stringObjPtrs;
+    size_t length = 0;
+    for (auto &hos : hoses) {
+        stringObjPtrs.push_back(this->getStringObjPtr("string-append", hos));
+        length += stringObjPtrs.back()->length;
+    }
+
+    string content;
+    content.reserve(length);
+    for (auto &stringObjPtr : stringObjPtrs) {
+        content += stringObjPtr->content();
     }
+
+    this->currentProcessPtr->pushOperand(this->currentProcessPtr->heap->makeString(RUNTIME_PREFIX, std::move(content)));
     this->currentProcessPtr->step();
+}
+
+// (substring s start) or (substring s start end), the result shares the characters of s
+void Runtime::ailSubstring() {
+    auto hoses = this->popOperandsToPushend();
+    if (hoses.size() != 2 && hoses.size() != 3) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("substring", 2, 3, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    auto stringObjPtr = this->getStringObjPtr("substring", hoses[0]);
+    int length = stringObjPtr->length;
+    int start = this->toVectorIndex("substring", hoses[1], length + 1);
+    int end = hoses.size() == 3 ? this->toVectorIndex("substring", hoses[2], length + 1) : length;
+    if (end < start) {
+        utils::raiseError("[IndexError] substring's end " + to_string(end) + " is before its start " + to_string(start),
+                          RUNTIME_PREFIX_TITLE);
+    }
 
+    Handle handle = this->currentProcessPtr->heap->makeSubstring(RUNTIME_PREFIX, stringObjPtr, start, end - start);
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
 }
 
-void Runtime::ailCdr() {
+void Runtime::ailStringLength() {
     auto hoses = this->popOperands(1);
-    this->checkWrongArgumentsNumberError("cdr", 1, hoses.size());
+    this->checkWrongArgumentsNumberError("string-length", 1, hoses.size());
 
-    HandleOrStr hos = hoses[0];
-    Type hosType = typeOfStr(hos);
+    auto stringObjPtr = this->getStringObjPtr("string-length", hoses[0]);
+    this->currentProcessPtr->pushOperand(to_string(stringObjPtr->length));
+    this->currentProcessPtr->step();
+}
 
-    if (hosType == Type::HANDLE) {
-        shared_ptr<IrisObject> schemeObjectPtr = this->currentProcessPtr->heap.get(hos);
-        if (schemeObjectPtr->irisObjectType == IrisObjectType::LIST) {
-            shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(schemeObjectPtr);
+// there is no character type, the character is a string of length 1
+void Runtime::ailStringRef() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("string-ref", 2, hoses.size());
 
+    auto stringObjPtr = this->getStringObjPtr("string-ref", hoses[0]);
+    int index = this->toVectorIndex("string-ref", hoses[1], stringObjPtr->length);
 
-            Handle newListHandle = this->currentProcessPtr->heap.makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
-            auto newListObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(newListHandle));
+    Handle handle = this->currentProcessPtr->heap->makeSubstring(RUNTIME_PREFIX, stringObjPtr, index, 1);
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
 
-            if (listObjPtr->isFake) {
-                newListObjPtr->pointTo(listObjPtr->realListObjPtr, listObjPtr->currentIndex + 1);
-            } else {
-                newListObjPtr->pointTo(listObjPtr, 1);
-            }
+// (string-contains s pattern) or (string-contains s pattern start), the index of the first match or #f
+void Runtime::ailStringContains() {
+    auto hoses = this->popOperandsToPushend();
+    if (hoses.size() != 2 && hoses.size() != 3) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("string-contains", 2, 3, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    auto stringObjPtr = this->getStringObjPtr("string-contains", hoses[0]);
+    auto patternObjPtr = this->getStringObjPtr("string-contains", hoses[1]);
+    int start = hoses.size() == 3 ? this->toVectorIndex("string-contains", hoses[2], stringObjPtr->length + 1) : 0;
+
+    size_t index = stringObjPtr->content().find(patternObjPtr->content(), start);
+    this->currentProcessPtr->pushOperand(index == string_view::npos ? "#f" : to_string(index));
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailIsString() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("string?", 1, hoses.size());
+
+    bool isString = typeOfStr(hoses[0]) == Type::HANDLE &&
+                    this->currentProcessPtr->heap->get(hoses[0])->irisObjectType == IrisObjectType::STRING;
+    this->currentProcessPtr->pushOperand(isString ? "#t" : "#f");
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailMakeStringBuilder() {
+    auto hoses = this->popOperandsToPushend();
+    this->checkWrongArgumentsNumberError("make-string-builder", 0, hoses.size());
+
+    Handle handle = this->currentProcessPtr->heap->makeStringBuilder(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
 
-            this->currentProcessPtr->pushOperand(newListHandle);
+// (string-builder-append! builder x ...), strings are appended as they are, other values as they are displayed
+void Runtime::ailStringBuilderAppend() {
+    auto hoses = this->popOperandsToPushend();
+    if (hoses.empty()) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("string-builder-append!", 2, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
 
+    auto builderObjPtr = this->getStringBuilderObjPtr("string-builder-append!", hoses[0]);
+    // the values are displayed before the builder is locked, displaying one may lock a vector or a table
+    string pieces;
+    for (int i = 1; i < hoses.size(); ++i) {
+        if (typeOfStr(hoses[i]) == Type::HANDLE &&
+            this->currentProcessPtr->heap->get(hoses[i])->irisObjectType == IrisObjectType::STRING) {
+            pieces += static_pointer_cast<StringObject>(this->currentProcessPtr->heap->get(hoses[i]))->content();
         } else {
-            throw std::invalid_argument(
-                    "[ailCdr] cdr's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+            pieces += this->toStr(hoses[i]);
         }
+    }
 
-    } else {
-        throw std::invalid_argument(
-                "[ailCdr] cdr's argument should be a List, but get a " + hos + " (" + TypeStrMap[hosType] + ") ");
+    this->currentProcessPtr->heap->account(pieces.size());
+    std::lock_guard<std::mutex> lock(builderObjPtr->mutex);
+    builderObjPtr->buffer += pieces;
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailStringBuilderLength() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("string-builder-length", 1, hoses.size());
+
+    auto builderObjPtr = this->getStringBuilderObjPtr("string-builder-length", hoses[0]);
+    size_t length;
+    {
+        std::lock_guard<std::mutex> lock(builderObjPtr->mutex);
+        length = builderObjPtr->buffer.size();
     }
+    this->currentProcessPtr->pushOperand(to_string(length));
     this->currentProcessPtr->step();
 }
 
-void Runtime::ailList() {
-    // create list, and push it
-    // is actually push handle_to_list
+// the buffer is moved into the new string, the builder is left empty and can be reused
+void Runtime::ailBuilderToString() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("builder->string", 1, hoses.size());
 
-    Handle handle = this->currentProcessPtr->heap.makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
-    shared_ptr<ListObject> listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(handle));
-//    string argumentNum = this->currentProcessPtr->popOperand();
+    auto builderObjPtr = this->getStringBuilderObjPtr("builder->string", hoses[0]);
+    string buffer;
+    {
+        std::lock_guard<std::mutex> lock(builderObjPtr->mutex);
+        buffer.swap(builderObjPtr->buffer);
+    }
+    Handle handle = this->currentProcessPtr->heap->makeString(RUNTIME_PREFIX, std::move(buffer));
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+shared_ptr<StringObject> Runtime::getStringObjPtr(string functionName, HandleOrStr hos) {
+    if (typeOfStr(hos) == Type::HANDLE) {
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+        if (schemeObjPtr->irisObjectType == IrisObjectType::STRING) {
+            return static_pointer_cast<StringObject>(schemeObjPtr);
+        }
+    }
+
+    string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "argument", "string", this->toType(hos));
+    utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    return nullptr;
+}
+
+shared_ptr<PortObject> Runtime::getPortObjPtr(string functionName, HandleOrStr hos) {
+    if (typeOfStr(hos) == Type::HANDLE) {
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+        if (schemeObjPtr->irisObjectType == IrisObjectType::PORT) {
+            auto portObjPtr = static_pointer_cast<PortObject>(schemeObjPtr);
+            if (portObjPtr->fd < 0) {
+                utils::raiseError("[IOError] " + functionName + "'s port is closed", RUNTIME_PREFIX_TITLE);
+            }
+            return portObjPtr;
+        }
+    }
+
+    string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "argument", "port", this->toType(hos));
+    utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    return nullptr;
+}
+
+shared_ptr<PortObject> Runtime::getConnectionObjPtr(string functionName, HandleOrStr hos) {
+    auto portObjPtr = this->getPortObjPtr(functionName, hos);
+    if (portObjPtr->kind != PortObject::PortKind::CONNECTION) {
+        utils::raiseError("[IOError] " + functionName + "'s port is not a connection", RUNTIME_PREFIX_TITLE);
+    }
+    return portObjPtr;
+}
+
+shared_ptr<StringBuilderObject> Runtime::getStringBuilderObjPtr(string functionName, HandleOrStr hos) {
+    if (typeOfStr(hos) == Type::HANDLE) {
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+        if (schemeObjPtr->irisObjectType == IrisObjectType::STRINGBUILDER) {
+            return static_pointer_cast<StringBuilderObject>(schemeObjPtr);
+        }
+    }
+
+    string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "first argument", "string builder",
+                                                                this->toType(hos));
+    utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    return nullptr;
+}
+
+//=================================================================
+//                          Hash Table
+//=================================================================
 
+// (make-hash-table) or (make-hash-table 'equal) compares keys with eq?, which walks lists and vectors,
+// (make-hash-table 'eq) compares keys by identity
+void Runtime::ailMakeHashTable() {
     auto hoses = this->popOperandsToPushend();
-    for (auto hos : hoses) {
-        listObjPtr->addChild(hos);
+    if (hoses.size() > 1) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("make-hash-table", 1, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    bool isEqualTable = true;
+    if (hoses.size() == 1) {
+        hoses[0] = this->toHashKey(hoses[0]);
+        if (hoses[0] != "'eq" && hoses[0] != "'equal") {
+            string errorMessage = utils::createArgumentTypeErrorMessage("make-hash-table", "argument", "'eq or 'equal",
+                                                                        hoses[0]);
+            utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+        }
+        isEqualTable = hoses[0] == "'equal";
     }
 
+    Handle handle = this->currentProcessPtr->heap->makeHashTable(RUNTIME_PREFIX, TOP_NODE_HANDLE, isEqualTable);
     this->currentProcessPtr->pushOperand(handle);
     this->currentProcessPtr->step();
 }
 
-void Runtime::ailCons() {
+// (hash-ref table key) or (hash-ref table key default)
+void Runtime::ailHashRef() {
+    auto hoses = this->popOperandsToPushend();
+    if (hoses.size() != 2 && hoses.size() != 3) {
+        string errorMessage = utils::createArgumentsNumberErrorMessage("hash-ref", 2, 3, hoses.size());
+        utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    }
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-ref", hoses[0]);
+    hoses[1] = this->toHashKey(hoses[1]);
+    size_t hash = this->hashKey(hashTableObjPtr, hoses[1]);
+
+    bool isFound = false;
+    HandleOrStr value;
+    {
+        std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+        auto slotPtr = hashTableObjPtr->find(hoses[1], hash, [&](const HandleOrStr &key1, const HandleOrStr &key2) {
+            return this->isHashKeyEqual(hashTableObjPtr, key1, key2);
+        });
+        if (slotPtr != nullptr) {
+            isFound = true;
+            value = slotPtr->value;
+        }
+    }
+
+    if (isFound) {
+        this->currentProcessPtr->pushOperand(value);
+    } else if (hoses.size() == 3) {
+        this->currentProcessPtr->pushOperand(hoses[2]);
+    } else {
+        utils::raiseError("[KeyError] hash-ref: no value found for key " + this->toStr(hoses[1]), RUNTIME_PREFIX_TITLE);
+    }
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailHashSet() {
+    auto hoses = this->popOperands(3);
+    this->checkWrongArgumentsNumberError("hash-set!", 3, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-set!", hoses[0]);
+    hoses[1] = this->toHashKey(hoses[1]);
+    size_t hash = this->hashKey(hashTableObjPtr, hoses[1]);
+
+    this->setHashEntry(hashTableObjPtr, hoses[1], hash, hoses[2]);
+    this->currentProcessPtr->step();
+}
+
+// the slots a table grows by and the entries it gains count against the heap limit
+void Runtime::setHashEntry(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key, size_t hash,
+                           const HandleOrStr &value) {
+    std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+    size_t slotCount = hashTableObjPtr->slots.size();
+    size_t count = hashTableObjPtr->count;
+    hashTableObjPtr->set(key, hash, value, [&](const HandleOrStr &key1, const HandleOrStr &key2) {
+        return this->isHashKeyEqual(hashTableObjPtr, key1, key2);
+    });
+    size_t bytes = (hashTableObjPtr->slots.size() - slotCount) * sizeof(HashTableObject::Slot);
+    if (hashTableObjPtr->count > count) {
+        bytes += key.size() + value.size();
+    }
+    this->currentProcessPtr->heap->account(bytes);
+}
+
+void Runtime::ailHashRemove() {
     auto hoses = this->popOperands(2);
-    Handle handle = this->currentProcessPtr->heap.makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
-    shared_ptr<ListObject> consListObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(handle));
+    this->checkWrongArgumentsNumberError("hash-remove!", 2, hoses.size());
 
-    for (auto hos :hoses) {
-        Type hosType = typeOfStr(hos);
-        if (hosType == Type::HANDLE) {
-            auto schemeObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(hos));
-            if (schemeObjPtr->irisObjectType == IrisObjectType::LIST) {
-                auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap.get(hos));
-                for (int i = listObjPtr->currentIndex; i < listObjPtr->realListObjPtr->childrenHoses.size(); i++) {
-                    consListObjPtr->addChild(listObjPtr->childrenHoses[i]);
-                }
-            } else {
-                consListObjPtr->addChild(hos);
-            }
-        } else {
-            consListObjPtr->addChild(hos);
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-remove!", hoses[0]);
+    hoses[1] = this->toHashKey(hoses[1]);
+    size_t hash = this->hashKey(hashTableObjPtr, hoses[1]);
+
+    std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+    hashTableObjPtr->remove(hoses[1], hash, [&](const HandleOrStr &key1, const HandleOrStr &key2) {
+        return this->isHashKeyEqual(hashTableObjPtr, key1, key2);
+    });
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailHashCount() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("hash-count", 1, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-count", hoses[0]);
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+        count = hashTableObjPtr->count;
+    }
+    this->currentProcessPtr->pushOperand(to_string(count));
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailHashContains() {
+    auto hoses = this->popOperands(2);
+    this->checkWrongArgumentsNumberError("hash-contains?", 2, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-contains?", hoses[0]);
+    hoses[1] = this->toHashKey(hoses[1]);
+    size_t hash = this->hashKey(hashTableObjPtr, hoses[1]);
+
+    bool isFound;
+    {
+        std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+        isFound = hashTableObjPtr->find(hoses[1], hash, [&](const HandleOrStr &key1, const HandleOrStr &key2) {
+            return this->isHashKeyEqual(hashTableObjPtr, key1, key2);
+        }) != nullptr;
+    }
+    this->currentProcessPtr->pushOperand(isFound ? "#t" : "#f");
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailHashKeys() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("hash-keys", 1, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-keys", hoses[0]);
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+    std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+    for (auto &slot : hashTableObjPtr->slots) {
+        if (slot.state == HashTableObject::SlotState::FULL) {
+            listObjPtr->addChild(slot.key);
+        }
+    }
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+void Runtime::ailHashValues() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("hash-values", 1, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash-values", hoses[0]);
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+    std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+    for (auto &slot : hashTableObjPtr->slots) {
+        if (slot.state == HashTableObject::SlotState::FULL) {
+            listObjPtr->addChild(slot.value);
+        }
+    }
+
+    this->currentProcessPtr->pushOperand(handle);
+    this->currentProcessPtr->step();
+}
+
+// a list of (key value) lists, in the same order as hash-keys and hash-values
+void Runtime::ailHashToList() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("hash->list", 1, hoses.size());
+
+    auto hashTableObjPtr = this->getHashTableObjPtr("hash->list", hoses[0]);
+    Handle handle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+    auto listObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(handle));
+    std::lock_guard<std::mutex> lock(hashTableObjPtr->mutex);
+    for (auto &slot : hashTableObjPtr->slots) {
+        if (slot.state == HashTableObject::SlotState::FULL) {
+            Handle entryHandle = this->currentProcessPtr->heap->makeList(RUNTIME_PREFIX, TOP_NODE_HANDLE);
+            auto entryObjPtr = static_pointer_cast<ListObject>(this->currentProcessPtr->heap->get(entryHandle));
+            entryObjPtr->addChild(slot.key);
+            entryObjPtr->addChild(slot.value);
+            listObjPtr->addChild(entryHandle);
         }
     }
 
@@ -1261,6 +3544,167 @@ void Runtime::ailCons() {
     this->currentProcessPtr->step();
 }
 
+void Runtime::ailIsHashTable() {
+    auto hoses = this->popOperands(1);
+    this->checkWrongArgumentsNumberError("hash-table?", 1, hoses.size());
+
+    bool isHashTable = typeOfStr(hoses[0]) == Type::HANDLE &&
+                       this->currentProcessPtr->heap->get(hoses[0])->irisObjectType == IrisObjectType::HASHTABLE;
+    this->currentProcessPtr->pushOperand(isHashTable ? "#t" : "#f");
+    this->currentProcessPtr->step();
+}
+
+shared_ptr<HashTableObject> Runtime::getHashTableObjPtr(string functionName, HandleOrStr hos) {
+    if (typeOfStr(hos) == Type::HANDLE) {
+        auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+        if (schemeObjPtr->irisObjectType == IrisObjectType::HASHTABLE) {
+            return static_pointer_cast<HashTableObject>(schemeObjPtr);
+        }
+    }
+
+    string errorMessage = utils::createArgumentTypeErrorMessage(functionName, "first argument", "hash table",
+                                                                this->toType(hos));
+    utils::raiseError(errorMessage, RUNTIME_PREFIX_TITLE);
+    return nullptr;
+}
+
+// a quoted symbol is a fresh QUOTE object at each place it is written, use the symbol itself as the key
+// so that 'a is the same key everywhere and never needs a heap lookup
+HandleOrStr Runtime::toHashKey(const HandleOrStr &hos) {
+    if (hos.empty() || hos[0] != '&') {
+        return hos;
+    }
+
+    auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+    if (schemeObjPtr->irisObjectType == IrisObjectType::QUOTE) {
+        auto &childrenHoses = static_pointer_cast<QuoteObject>(schemeObjPtr)->childrenHoses;
+        if (childrenHoses.size() == 1 && childrenHoses[0].size() > 1 && childrenHoses[0][1] != '&') {
+            return childrenHoses[0];
+        }
+    }
+    return hos;
+}
+
+// symbols, strings and numbers are compared as they are written, so only handles need a structural hash
+size_t Runtime::hashKey(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key) {
+    if (hashTableObjPtr->isEqualTable && !key.empty() && key[0] == '&') {
+        return this->equalHash(key);
+    }
+
+    // fixnum fast path, small integers are mixed directly instead of hashing their digits
+    if (!key.empty() && key.size() <= 18 && isdigit(key[0])) {
+        uint64_t number = 0;
+        bool isFixnum = true;
+        for (char c : key) {
+            if (!isdigit(c)) {
+                isFixnum = false;
+                break;
+            }
+            number = number * 10 + (c - '0');
+        }
+        if (isFixnum) {
+            number ^= number >> 33;
+            number *= 0xff51afd7ed558ccdULL;
+            number ^= number >> 33;
+            return number;
+        }
+    }
+
+    return std::hash<string>()(key);
+}
+
+// must agree with isEq: equal lists, quotes and vectors hash the same
+size_t Runtime::equalHash(const HandleOrStr &hos) {
+    if (hos.empty() || hos[0] != '&') {
+        return std::hash<string>()(hos);
+    }
+
+    auto schemeObjPtr = this->currentProcessPtr->heap->get(hos);
+    if (schemeObjPtr->irisObjectType == IrisObjectType::LIST) {
+        int offset;
+        auto listObjPtr = this->getListObjPtr(hos, offset);
+        return this->listHash(listObjPtr, offset);
+    }
+
+    size_t hash = (size_t) schemeObjPtr->irisObjectType;
+    auto combine = [&hash](size_t elementHash) {
+        hash ^= elementHash + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    };
+
+    if (schemeObjPtr->irisObjectType == IrisObjectType::STRING) {
+        combine(std::hash<string_view>()(static_pointer_cast<StringObject>(schemeObjPtr)->content()));
+    } else if (schemeObjPtr->irisObjectType == IrisObjectType::QUOTE) {
+        for (auto &childHos : IrisObject::getChildrenHosesOrBodies(schemeObjPtr)) {
+            combine(this->equalHash(childHos));
+        }
+    } else if (schemeObjPtr->irisObjectType == IrisObjectType::VECTOR) {
+        // vectors are mutable and may contain themselves, only their size and their plain elements are hashed
+        auto vectorObjPtr = static_pointer_cast<VectorObject>(schemeObjPtr);
+        std::lock_guard<std::mutex> lock(vectorObjPtr->mutex);
+        auto &elements = vectorObjPtr->elements;
+        combine(elements.size());
+        for (auto &element : elements) {
+            if (element.empty() || element[0] != '&') {
+                combine(std::hash<string>()(element));
+            }
+        }
+    } else if (schemeObjPtr->irisObjectType == IrisObjectType::F64VECTOR) {
+        for (auto element : Runtime::copyElements(static_pointer_cast<F64VectorObject>(schemeObjPtr))) {
+            combine(std::hash<double>()(element));
+        }
+    } else if (schemeObjPtr->irisObjectType == IrisObjectType::S64VECTOR) {
+        for (auto element : Runtime::copyElements(static_pointer_cast<S64VectorObject>(schemeObjPtr))) {
+            combine(std::hash<int64_t>()(element));
+        }
+    } else {
+        // closures, hash tables, ... are only equal to themselves
+        return std::hash<string>()(hos);
+    }
+    return hash;
+}
+
+// lists are never modified once built, so the hashes of all of their views are computed in one pass
+// from the end of the list and kept in the list, see listElementHash for the elements that may change
+size_t Runtime::listHash(const shared_ptr<ListObject> &listObjPtr, int offset) {
+    auto suffixHashesPtr = listObjPtr->suffixHashes.load();
+    if (!suffixHashesPtr) {
+        auto &childrenHoses = listObjPtr->childrenHoses;
+        auto suffixHashes = make_shared<vector<size_t>>(childrenHoses.size() + 1);
+
+        size_t hash = (size_t) IrisObjectType::LIST;
+        suffixHashes->back() = hash;
+        for (int i = childrenHoses.size() - 1; i >= 0; --i) {
+            hash ^= this->listElementHash(childrenHoses[i]) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            (*suffixHashes)[i] = hash;
+        }
+        // a worker racing on the same list computes the same hashes, either copy may win
+        listObjPtr->suffixHashes.store(suffixHashes);
+        suffixHashesPtr = suffixHashes;
+    }
+    return (*suffixHashesPtr)[offset];
+}
+
+// the hash a list keeps must stay valid: a vector may be set after the list is hashed, so only its type counts,
+// equal vectors still hash the same
+size_t Runtime::listElementHash(const HandleOrStr &hos) {
+    if (!hos.empty() && hos[0] == '&') {
+        IrisObjectType type = this->currentProcessPtr->heap->get(hos)->irisObjectType;
+        if (type == IrisObjectType::VECTOR || type == IrisObjectType::F64VECTOR ||
+            type == IrisObjectType::S64VECTOR) {
+            return (size_t) type;
+        }
+    }
+    return this->equalHash(hos);
+}
+
+bool Runtime::isHashKeyEqual(const shared_ptr<HashTableObject> &hashTableObjPtr, const HandleOrStr &key1,
+                             const HandleOrStr &key2) {
+    if (key1 == key2) {
+        return true;
+    }
+    return hashTableObjPtr->isEqualTable && key1[0] == '&' && key2[0] == '&' && this->isEq(key1, key2);
+}
+
 void Runtime::ailIfTrue() {
     auto hoses = this->popOperands(1);
     this->checkWrongArgumentsNumberError("iftrue", 1, hoses.size());
@@ -1279,7 +3723,7 @@ void Runtime::ailIfTrue() {
         string label = argument;
 //
         if (predicate == "#t") {
-            int targetAddress = this->currentProcessPtr->labelAddressMap[label];
+            int targetAddress = this->currentProcessPtr->image->labelAddressMap.at(label);
             this->currentProcessPtr->gotoAddress(targetAddress);
         } else {
             this->currentProcessPtr->step();
@@ -1307,7 +3751,7 @@ void Runtime::ailIfFalse() {
         string label = argument;
 
         if (predicate == "#f") {
-            int targetAddress = this->currentProcessPtr->labelAddressMap[label];
+            int targetAddress = this->currentProcessPtr->image->labelAddressMap.at(label);
             this->currentProcessPtr->gotoAddress(targetAddress);
         } else {
             this->currentProcessPtr->step();
@@ -1323,7 +3767,7 @@ void Runtime::ailGoto() {
     Type argumentType = typeOfStr(argument);
     if (argumentType == Type::LABEL) {
         string label = argument;
-        int targetAddress = this->currentProcessPtr->labelAddressMap[label];
+        int targetAddress = this->currentProcessPtr->image->labelAddressMap.at(label);
         this->currentProcessPtr->gotoAddress(targetAddress);
     } else {
         throw std::invalid_argument("[ailGoto] argument should be Label");
@@ -1365,11 +3809,11 @@ vector<HandleOrStr> Runtime::popOperandsToPushend() {
 }
 
 bool Runtime::matchPushendStack(string pushendStr) {
-    if (this->pushendStack.empty() || this->pushendStack.back() != pushendStr) {
-        this->pushendStack.push_back(pushendStr);
+    if (this->currentProcessPtr->pushendStack.empty() || this->currentProcessPtr->pushendStack.back() != pushendStr) {
+        this->currentProcessPtr->pushendStack.push_back(pushendStr);
         return false;
     } else {
-        this->pushendStack.pop_back();
+        this->currentProcessPtr->pushendStack.pop_back();
         return true;
     }
 }
@@ -1378,15 +3822,25 @@ void Runtime::ailBegin() {
     this->currentProcessPtr->step();
 }
 
+// returns the list behind a list handle or a list view (nullptr if hos is not a list), and sets the view's offset
+shared_ptr<ListObject> Runtime::getListObjPtr(HandleOrStr hos, int &offset) {
+    offset = 0;
+    if (typeOfStr(hos) != Type::HANDLE) {
+        return nullptr;
+    }
+
+    Handle listHandle = Heap::splitListView(hos, offset);
+    auto schemeObjPtr = this->currentProcessPtr->heap->get(listHandle);
+    if (schemeObjPtr->irisObjectType != IrisObjectType::LIST) {
+        return nullptr;
+    }
+    return static_pointer_cast<ListObject>(schemeObjPtr);
+}
+
 void Runtime::checkWrongArgumentsNumberError(string functionName, int expectedNum, int actualNum) {
     if (expectedNum != actualNum) {
-        string be = actualNum > 1 ? " are " : " is ";
-        string add_s = expectedNum > 1 ? "s" : "";
-        cout << this->ERROR_PREFIX;
-        cout << "[" + functionName + "] expects " + to_string(expectedNum) + " argument" + add_s +
-                ", " +
-                to_string(actualNum) + be + "given" << endl;
-        cout << this->ERROR_POSTFIX << endl;
+        utils::raiseError(utils::createArgumentsNumberErrorMessage(functionName, expectedNum, actualNum),
+                          RUNTIME_PREFIX_TITLE);
     }
 }
 
@@ -0,0 +1,551 @@
+//
+// Scheduler: runs processes on a pool of worker threads, each owning a work-stealing deque
+//
+
+#ifndef TYPED_SCHEME_SCHEDULER_HPP
+#define TYPED_SCHEME_SCHEDULER_HPP
+
+#include "Process.hpp"
+#include "Reactor.hpp"
+#include "TimerWheel.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// Chase-Lev deque: the owner pushes at the bottom, items are stolen from the top
+// the owner steals from its own deque too, processes then run round robin instead of the last pushed
+// one running again and again
+// T must be trivially copyable, the scheduler stores Process pointers owned by its process pool
+template<typename T>
+class WorkStealingDeque {
+public:
+    WorkStealingDeque() : array(new Array(64)) {};
+
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // owner only
+    void push(T item);
+
+    // any thread, returns false when the deque is empty or another thread won the race
+    bool steal(T &item);
+
+    bool empty() const;
+
+private:
+    struct Array {
+        explicit Array(int64_t capacity) : capacity(capacity), items(new std::atomic<T>[capacity]) {};
+
+        ~Array() { delete[] this->items; };
+
+        int64_t capacity;
+        std::atomic<T> *items;
+
+        T get(int64_t index) { return this->items[index & (this->capacity - 1)].load(std::memory_order_relaxed); };
+
+        void put(int64_t index, T item) {
+            this->items[index & (this->capacity - 1)].store(item, std::memory_order_relaxed);
+        };
+    };
+
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<Array *> array;
+    // arrays replaced by a grow may still be read by a thief, they are freed with the deque
+    vector<Array *> retiredArrays;
+};
+
+template<typename T>
+WorkStealingDeque<T>::~WorkStealingDeque() {
+    delete this->array.load();
+    for (auto retiredArray : this->retiredArrays) {
+        delete retiredArray;
+    }
+}
+
+template<typename T>
+void WorkStealingDeque<T>::push(T item) {
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+    Array *a = this->array.load(std::memory_order_relaxed);
+
+    if (b - t > a->capacity - 1) {
+        Array *grownArray = new Array(a->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            grownArray->put(i, a->get(i));
+        }
+        this->retiredArrays.push_back(a);
+        this->array.store(grownArray, std::memory_order_release);
+        a = grownArray;
+    }
+
+    a->put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::steal(T &item) {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return false;
+    }
+
+    Array *a = this->array.load(std::memory_order_acquire);
+    item = a->get(t);
+    return this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool WorkStealingDeque<T>::empty() const {
+    return this->bottom.load(std::memory_order_acquire) <= this->top.load(std::memory_order_acquire);
+}
+
+
+// M:N scheduler, M processes on N worker threads
+// a worker runs the processes of its own deques, steals from the other workers when it runs dry,
+// and parks when there is nothing to steal. the calling thread of run() is worker 0
+// every worker has one deque per ProcessPriority, a higher priority queue is served first
+class Scheduler {
+public:
+    // workerCount <= 0 reads IRISWORKERS, and falls back to the number of cores
+    explicit Scheduler(int workerCount = 0);
+
+    int workerCount;
+
+    // processes waiting for I/O register their descriptors here, see Runtime::waitForPort
+    Reactor reactor;
+
+    PID allocatePID();
+
+    // registers a new process and makes it runnable
+    void addProcess(std::shared_ptr<Process> processPtr);
+
+    // registers a new process that the calling thread runs itself outside of run(), it goes to a run queue
+    // once endSlice is called for it, see Runtime::runProcess
+    void addRunningProcess(std::shared_ptr<Process> processPtr);
+
+    // what a worker does with a process at the end of its slice: queues it again when it ran out of budget
+    // or yielded, parks it when it sleeps, lets it go when it stopped
+    void endSlice(Process *processPtr);
+
+    // the processes registered and not stopped yet
+    int liveProcessCount() const { return this->liveProcesses; };
+
+    // nullptr once the process has stopped, see processStopped
+    std::shared_ptr<Process> getProcess(PID pid);
+
+    // whether pid was handed out, a process that has stopped since is no longer found by getProcess
+    bool isAllocated(PID pid);
+
+    // puts a process in a run queue: the deque of the calling worker, or the shared injection queue
+    // when called from outside the workers
+    void makeRunnable(Process *processPtr);
+
+    // called when a process reaches ProcessState::STOPPED, the pool lets it go
+    // nothing that outlives the process points to it: timers hold its pid, and what it waits for is done
+    void processStopped(Process *processPtr);
+
+    // makes a sleeping process runnable again, a process that is not asleep yet will not fall asleep
+    // at the end of its slice. any thread may wake any process
+    void wake(Process *processPtr);
+
+    // wakes processPtr at deadline, unless it has stopped by then
+    void addTimer(std::chrono::steady_clock::time_point deadline, Process *processPtr);
+
+    // runs until every process has stopped, or every process left sleeps with nothing to wake it
+    // runSlice(workerIndex, process) runs process for one time slice on the given worker
+    // the scheduler can run again with new processes
+    void run(const function<void(int, Process &)> &runSlice);
+
+private:
+    std::mutex poolMutex;
+    map<PID, std::shared_ptr<Process>> processPool;
+    std::atomic<PID> nextPID{0};
+    std::atomic<int> liveProcesses{0};
+
+    static const int PRIORITY_COUNT = 3;
+    // a worker looks at the queues from the lowest priority up once every AGING_PERIOD picks,
+    // so that a busy high priority queue doesn't starve the others
+    static const int AGING_PERIOD = 16;
+
+    // deques[workerIndex][priority]
+    vector<vector<std::unique_ptr<WorkStealingDeque<Process *>>>> deques;
+
+    std::mutex injectionMutex;
+    std::deque<Process *> injectionQueues[PRIORITY_COUNT];
+
+    std::mutex parkMutex;
+    std::condition_variable parkCondition;
+    std::atomic<int> parkedWorkers{0};
+    std::atomic<bool> isStopping{false};
+    // one worker at a time polls the reactor, a parked one blocks in it
+    std::atomic<bool> isPolling{false};
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    std::mutex timerMutex;
+    // by pid, a process may stop before its timer fires
+    TimerWheel<PID> timers;
+    // lets fireTimers skip timerMutex, written under it
+    std::atomic<int64_t> nextTimerDeadline{INT64_MAX};
+
+    inline static thread_local int currentWorkerIndex = -1;
+
+    void workerLoop(int workerIndex, const function<void(int, Process &)> &runSlice);
+
+    Process *findWork(int workerIndex, std::minstd_rand &random, bool isLowestFirst);
+
+    Process *findWork(int workerIndex, std::minstd_rand &random, int priority);
+
+    bool hasVisibleWork();
+
+    // called by the worker of a process that went to sleep in its slice
+    void park(Process *processPtr);
+
+    void fireTimers();
+
+    // returns false when another worker is polling already
+    bool pollReactor(int timeoutMs);
+
+    void wakeWorker();
+
+    void stop();
+};
+
+Scheduler::Scheduler(int workerCount) {
+    if (workerCount <= 0) {
+        const char *workersEnv = std::getenv("IRISWORKERS");
+        workerCount = workersEnv != nullptr ? std::atoi(workersEnv) : (int) std::thread::hardware_concurrency();
+    }
+    this->workerCount = std::max(workerCount, 1);
+
+    this->deques.resize(this->workerCount);
+    for (auto &workerDeques : this->deques) {
+        for (int priority = 0; priority < PRIORITY_COUNT; ++priority) {
+            workerDeques.emplace_back(new WorkStealingDeque<Process *>());
+        }
+    }
+}
+
+PID Scheduler::allocatePID() {
+    return this->nextPID++;
+}
+
+void Scheduler::addProcess(std::shared_ptr<Process> processPtr) {
+    {
+        std::lock_guard<std::mutex> lock(this->poolMutex);
+        this->processPool.emplace(processPtr->pid, processPtr);
+    }
+    this->liveProcesses++;
+    this->makeRunnable(processPtr.get());
+}
+
+void Scheduler::addRunningProcess(std::shared_ptr<Process> processPtr) {
+    processPtr->state = ProcessState::RUNNING;
+    processPtr->parkFlag.state = ParkState::RUNNABLE;
+    {
+        std::lock_guard<std::mutex> lock(this->poolMutex);
+        this->processPool.emplace(processPtr->pid, processPtr);
+    }
+    this->liveProcesses++;
+}
+
+void Scheduler::endSlice(Process *processPtr) {
+    // RUNNING when the budget ran out, READY when the process yielded
+    // a worker takes the process back itself, no other worker is woken for it
+    if (processPtr->state == ProcessState::RUNNING || processPtr->state == ProcessState::READY) {
+        if (currentWorkerIndex >= 0) {
+            processPtr->state = ProcessState::READY;
+            this->deques[currentWorkerIndex][(int) processPtr->priority]->push(processPtr);
+        } else {
+            this->makeRunnable(processPtr);
+        }
+    } else if (processPtr->state == ProcessState::SLEEPING) {
+        this->park(processPtr);
+    } else if (processPtr->state == ProcessState::STOPPED) {
+        this->processStopped(processPtr);
+    }
+}
+
+std::shared_ptr<Process> Scheduler::getProcess(PID pid) {
+    std::lock_guard<std::mutex> lock(this->poolMutex);
+    auto it = this->processPool.find(pid);
+    return it != this->processPool.end() ? it->second : nullptr;
+}
+
+void Scheduler::makeRunnable(Process *processPtr) {
+    processPtr->state = ProcessState::READY;
+    int priority = (int) processPtr->priority;
+    if (currentWorkerIndex >= 0) {
+        this->deques[currentWorkerIndex][priority]->push(processPtr);
+    } else {
+        std::lock_guard<std::mutex> lock(this->injectionMutex);
+        this->injectionQueues[priority].push_back(processPtr);
+    }
+    this->wakeWorker();
+}
+
+bool Scheduler::isAllocated(PID pid) {
+    return pid >= 0 && pid < this->nextPID;
+}
+
+void Scheduler::processStopped(Process *processPtr) {
+    {
+        std::lock_guard<std::mutex> lock(this->poolMutex);
+        this->processPool.erase(processPtr->pid);
+    }
+    if (--this->liveProcesses == 0) {
+        this->stop();
+    }
+}
+
+void Scheduler::wake(Process *processPtr) {
+    if (processPtr == nullptr) {
+        return;
+    }
+    if (processPtr->parkFlag.state.exchange(ParkState::NOTIFIED) == ParkState::PARKED) {
+        this->makeRunnable(processPtr);
+    }
+}
+
+// a wake that came in during the slice leaves NOTIFIED behind, the process then runs again instead of parking
+void Scheduler::park(Process *processPtr) {
+    auto expected = ParkState::RUNNABLE;
+    if (!processPtr->parkFlag.state.compare_exchange_strong(expected, ParkState::PARKED)) {
+        this->makeRunnable(processPtr);
+    }
+}
+
+// called by a running worker, which looks at the timers again before it parks
+void Scheduler::addTimer(std::chrono::steady_clock::time_point deadline, Process *processPtr) {
+    std::lock_guard<std::mutex> lock(this->timerMutex);
+    this->timers.add(deadline, processPtr->pid);
+    this->nextTimerDeadline = this->timers.nextDeadline().time_since_epoch().count();
+}
+
+void Scheduler::fireTimers() {
+    auto now = std::chrono::steady_clock::now();
+    if (now.time_since_epoch().count() < this->nextTimerDeadline) {
+        return;
+    }
+
+    vector<PID> expiredPids;
+    {
+        std::lock_guard<std::mutex> lock(this->timerMutex);
+        this->timers.advance(now, expiredPids);
+        this->nextTimerDeadline = this->timers.nextDeadline().time_since_epoch().count();
+    }
+
+    // a timer may outlive the sleep it was set for, a process woken for nothing goes back to sleep,
+    // and a stopped one is not found
+    for (PID pid : expiredPids) {
+        this->wake(this->getProcess(pid).get());
+    }
+}
+
+bool Scheduler::pollReactor(int timeoutMs) {
+    if (this->isPolling.exchange(true)) {
+        return false;
+    }
+    this->reactor.poll(timeoutMs, [this](Process *processPtr) { this->wake(processPtr); });
+    this->isPolling = false;
+    return true;
+}
+
+void Scheduler::run(const function<void(int, Process &)> &runSlice) {
+    if (this->liveProcesses == 0) {
+        return;
+    }
+    this->isStopping = false;
+
+    vector<std::thread> threads;
+    for (int i = 1; i < this->workerCount; ++i) {
+        threads.emplace_back([this, i, &runSlice]() {
+            try {
+                this->workerLoop(i, runSlice);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(this->errorMutex);
+                if (!this->error) {
+                    this->error = std::current_exception();
+                }
+                this->stop();
+            }
+        });
+    }
+
+    try {
+        this->workerLoop(0, runSlice);
+    } catch (...) {
+        this->stop();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        throw;
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (this->error) {
+        std::rethrow_exception(this->error);
+    }
+
+    // a stopped process can't be woken, its timers are useless
+    if (this->liveProcesses == 0) {
+        std::scoped_lock lock(this->poolMutex, this->timerMutex);
+        this->processPool.clear();
+        this->timers = TimerWheel<PID>();
+        this->nextTimerDeadline = INT64_MAX;
+    }
+}
+
+void Scheduler::workerLoop(int workerIndex, const function<void(int, Process &)> &runSlice) {
+    currentWorkerIndex = workerIndex;
+    std::minstd_rand random(workerIndex + 1);
+    int pickCount = 0;
+
+    while (!this->isStopping) {
+        this->fireTimers();
+        if (this->reactor.hasWaiters()) {
+            this->pollReactor(0);
+        }
+
+        Process *processPtr = this->findWork(workerIndex, random, ++pickCount % AGING_PERIOD == 0);
+        if (processPtr == nullptr) {
+            // announce the park before the last look for work, so that a producer either sees
+            // parkedWorkers > 0 and notifies, or its work is seen by the look below
+            std::unique_lock<std::mutex> lock(this->parkMutex);
+            this->parkedWorkers++;
+            if (!this->isStopping && !this->hasVisibleWork()) {
+                std::unique_lock<std::mutex> timerLock(this->timerMutex);
+                bool hasTimers = !this->timers.empty();
+                auto deadline = this->timers.nextDeadline();
+                timerLock.unlock();
+
+                // isPolling is taken under parkMutex, wakeWorker then sees it and interrupts the poll
+                if (this->reactor.hasWaiters() && !this->isPolling.exchange(true)) {
+                    int timeoutMs = -1;
+                    if (hasTimers) {
+                        auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+                                deadline - std::chrono::steady_clock::now());
+                        timeoutMs = (int) std::max<int64_t>(timeout.count(), 0);
+                    }
+                    lock.unlock();
+                    this->reactor.poll(timeoutMs, [this](Process *processPtr) { this->wake(processPtr); });
+                    this->isPolling = false;
+                    lock.lock();
+                } else if (hasTimers) {
+                    this->parkCondition.wait_until(lock, deadline);
+                } else if (this->parkedWorkers == this->workerCount && !this->reactor.hasWaiters()) {
+                    // every process is asleep with nothing left to wake it, none of them can run again
+                    this->isStopping = true;
+                    this->parkCondition.notify_all();
+                } else {
+                    this->parkCondition.wait(lock);
+                }
+            }
+            this->parkedWorkers--;
+            continue;
+        }
+
+        processPtr->state = ProcessState::RUNNING;
+        processPtr->parkFlag.state = ParkState::RUNNABLE;
+        runSlice(workerIndex, *processPtr);
+        this->endSlice(processPtr);
+    }
+    currentWorkerIndex = -1;
+}
+
+Process *Scheduler::findWork(int workerIndex, std::minstd_rand &random, bool isLowestFirst) {
+    for (int i = 0; i < PRIORITY_COUNT; ++i) {
+        int priority = isLowestFirst ? PRIORITY_COUNT - 1 - i : i;
+        Process *processPtr = this->findWork(workerIndex, random, priority);
+        if (processPtr != nullptr) {
+            return processPtr;
+        }
+    }
+    return nullptr;
+}
+
+Process *Scheduler::findWork(int workerIndex, std::minstd_rand &random, int priority) {
+    Process *processPtr = nullptr;
+    auto &ownDeque = this->deques[workerIndex][priority];
+    while (!ownDeque->empty()) {
+        if (ownDeque->steal(processPtr)) {
+            return processPtr;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->injectionMutex);
+        auto &injectionQueue = this->injectionQueues[priority];
+        if (!injectionQueue.empty()) {
+            processPtr = injectionQueue.front();
+            injectionQueue.pop_front();
+            return processPtr;
+        }
+    }
+
+    // one round over the other workers, starting from a random victim
+    int start = random() % this->workerCount;
+    for (int i = 0; i < this->workerCount; ++i) {
+        int victim = (start + i) % this->workerCount;
+        if (victim != workerIndex && this->deques[victim][priority]->steal(processPtr)) {
+            return processPtr;
+        }
+    }
+    return nullptr;
+}
+
+bool Scheduler::hasVisibleWork() {
+    for (auto &workerDeques : this->deques) {
+        for (auto &deque : workerDeques) {
+            if (!deque->empty()) {
+                return true;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(this->injectionMutex);
+    for (auto &injectionQueue : this->injectionQueues) {
+        if (!injectionQueue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::wakeWorker() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->parkedWorkers > 0) {
+        std::lock_guard<std::mutex> lock(this->parkMutex);
+        this->parkCondition.notify_one();
+        if (this->isPolling) {
+            this->reactor.interrupt();
+        }
+    }
+}
+
+void Scheduler::stop() {
+    std::lock_guard<std::mutex> lock(this->parkMutex);
+    this->isStopping = true;
+    this->parkCondition.notify_all();
+    this->reactor.interrupt();
+}
+
+#endif //TYPED_SCHEME_SCHEDULER_HPP
@@ -0,0 +1,186 @@
+//
+// TimerWheel: hierarchical timing wheel, the timers of the scheduler
+//
+
+#ifndef TYPED_SCHEME_TIMERWHEEL_HPP
+#define TYPED_SCHEME_TIMERWHEEL_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+// LEVEL_COUNT wheels of SLOT_COUNT slots, a slot of level 0 lasts one tick (a millisecond), a slot of level L
+// lasts SLOT_COUNT^L ticks. a timer goes to the lowest level whose current span holds its tick, and moves down
+// a level each time the wheel reaches its slot, so adding is O(1) and a timer moves at most LEVEL_COUNT times
+// a timer beyond the top level waits in an overflow list
+// a bitmap per level finds the next occupied slot without walking the empty ones, time jumps over them
+// not thread safe, the scheduler guards it with its timerMutex
+template<typename T>
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // deadlines are counted in ticks from startTime
+    explicit TimerWheel(Clock::time_point startTime = Clock::now()) : startTime(startTime) {};
+
+    // a deadline that is over already fires with the next advance
+    void add(Clock::time_point deadline, T item);
+
+    // moves the wheel to now and appends the items of the expired timers to expiredItems
+    void advance(Clock::time_point now, vector<T> &expiredItems);
+
+    bool empty() const { return this->timerCount == 0; };
+
+    // no later than the tick of the earliest timer, it can be earlier when that timer is still in a higher
+    // level, waking then moves it down. time_point::max() when there is no timer
+    Clock::time_point nextDeadline() const;
+
+private:
+    static const int LEVEL_COUNT = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOT_COUNT = 1 << SLOT_BITS;
+
+    struct Timer {
+        int64_t tick;
+        T item;
+    };
+
+    Clock::time_point startTime;
+    // every tick up to currentTick has expired
+    int64_t currentTick = 0;
+    size_t timerCount = 0;
+
+    vector<Timer> slots[LEVEL_COUNT][SLOT_COUNT];
+    uint64_t occupiedSlots[LEVEL_COUNT] = {};
+    // timers added with a tick that is over already
+    vector<Timer> dueTimers;
+    // timers beyond the span of the top level, placed again when the wheel enters the next span
+    vector<Timer> overflowTimers;
+
+    void place(Timer timer);
+
+    // the first tick of the earliest occupied slot, INT64_MAX when the wheel is empty
+    int64_t nextOccupiedTick() const;
+
+    void expireSlot(vector<T> &expiredItems);
+};
+
+template<typename T>
+void TimerWheel<T>::add(Clock::time_point deadline, T item) {
+    // rounded up, a timer never fires before its deadline
+    auto duration = std::chrono::ceil<std::chrono::milliseconds>(deadline - this->startTime);
+    this->place(Timer{std::max<int64_t>(duration.count(), 0), item});
+    this->timerCount++;
+}
+
+template<typename T>
+void TimerWheel<T>::place(Timer timer) {
+    if (timer.tick <= this->currentTick) {
+        this->dueTimers.push_back(timer);
+        return;
+    }
+
+    int level = 0;
+    while ((timer.tick >> (SLOT_BITS * (level + 1))) != (this->currentTick >> (SLOT_BITS * (level + 1)))) {
+        if (++level == LEVEL_COUNT) {
+            this->overflowTimers.push_back(timer);
+            return;
+        }
+    }
+    int slot = (int) ((timer.tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1));
+    this->slots[level][slot].push_back(timer);
+    this->occupiedSlots[level] |= uint64_t(1) << slot;
+}
+
+template<typename T>
+int64_t TimerWheel<T>::nextOccupiedTick() const {
+    if (!this->dueTimers.empty()) {
+        return this->currentTick;
+    }
+
+    int64_t nextTick = std::numeric_limits<int64_t>::max();
+    if (!this->overflowTimers.empty()) {
+        nextTick = ((this->currentTick >> (SLOT_BITS * LEVEL_COUNT)) + 1) << (SLOT_BITS * LEVEL_COUNT);
+    }
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        int shift = SLOT_BITS * level;
+        int currentSlot = (int) ((this->currentTick >> shift) & (SLOT_COUNT - 1));
+        // the occupied slots of a level are all after its current slot
+        uint64_t laterSlots = currentSlot == SLOT_COUNT - 1 ? 0 : this->occupiedSlots[level] >> (currentSlot + 1);
+        if (laterSlots == 0) {
+            continue;
+        }
+
+        int slot = currentSlot + 1 + __builtin_ctzll(laterSlots);
+        int64_t spanStart = (this->currentTick >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+        nextTick = std::min(nextTick, spanStart + ((int64_t) slot << shift));
+    }
+    return nextTick;
+}
+
+template<typename T>
+void TimerWheel<T>::advance(Clock::time_point now, vector<T> &expiredItems) {
+    int64_t nowTick = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->startTime).count();
+
+    while (this->timerCount > 0) {
+        int64_t nextTick = this->nextOccupiedTick();
+        if (nextTick > nowTick) {
+            break;
+        }
+        this->currentTick = nextTick;
+
+        if ((this->currentTick & ((int64_t(1) << (SLOT_BITS * LEVEL_COUNT)) - 1)) == 0) {
+            vector<Timer> timers = std::move(this->overflowTimers);
+            this->overflowTimers.clear();
+            for (auto &timer : timers) {
+                this->place(timer);
+            }
+        }
+
+        // the higher levels first, their timers may move down to a slot that is emptied next
+        for (int level = LEVEL_COUNT - 1; level > 0; --level) {
+            int shift = SLOT_BITS * level;
+            if ((this->currentTick & ((int64_t(1) << shift) - 1)) != 0) {
+                continue;
+            }
+
+            int slot = (int) ((this->currentTick >> shift) & (SLOT_COUNT - 1));
+            vector<Timer> timers = std::move(this->slots[level][slot]);
+            this->slots[level][slot].clear();
+            this->occupiedSlots[level] &= ~(uint64_t(1) << slot);
+            for (auto &timer : timers) {
+                this->place(timer);
+            }
+        }
+        this->expireSlot(expiredItems);
+    }
+    this->currentTick = std::max(this->currentTick, nowTick);
+}
+
+template<typename T>
+void TimerWheel<T>::expireSlot(vector<T> &expiredItems) {
+    int slot = (int) (this->currentTick & (SLOT_COUNT - 1));
+    vector<Timer> timers = std::move(this->slots[0][slot]);
+    this->slots[0][slot].clear();
+    this->occupiedSlots[0] &= ~(uint64_t(1) << slot);
+    timers.insert(timers.end(), this->dueTimers.begin(), this->dueTimers.end());
+    this->dueTimers.clear();
+
+    for (auto &timer : timers) {
+        expiredItems.push_back(timer.item);
+    }
+    this->timerCount -= timers.size();
+}
+
+template<typename T>
+typename TimerWheel<T>::Clock::time_point TimerWheel<T>::nextDeadline() const {
+    if (this->timerCount == 0) {
+        return Clock::time_point::max();
+    }
+    return this->startTime + std::chrono::milliseconds(this->nextOccupiedTick());
+}
+
+#endif //TYPED_SCHEME_TIMERWHEEL_HPP
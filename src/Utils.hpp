@@ -7,6 +7,7 @@
 
 #include <stdexcept>
 #include <fstream>
+#include <iostream>
 #include <vector>
 #include <stdarg.h>
 #include <set>
@@ -23,6 +24,15 @@ using namespace std;
 namespace utils {
     bool log_flag = true;
 
+    // set by ./iris and the REPL, see main.cpp. off in libiris, whose host gets the description in the exception
+    inline bool isPrintingErrors = false;
+
+    // thrown by raiseError, what() is the description
+    class ScriptError : public std::runtime_error {
+    public:
+        explicit ScriptError(const string &message) : std::runtime_error(message) {};
+    };
+
     inline std::string trim(const std::string &s) {
         auto wsfront = std::find_if_not(s.begin(), s.end(), [](int c) { return std::isspace(c); });
         auto wsback = std::find_if_not(s.rbegin(), s.rend(), [](int c) { return std::isspace(c); }).base();
@@ -133,6 +143,14 @@ namespace utils {
         return message;
     }
 
+    // for functions with an optional last argument
+    string createArgumentsNumberErrorMessage(string functionName, int minNum, int maxNum, int actualNum) {
+        string be = actualNum > 1 ? " are " : " is ";
+        string message = "[ArgumentNumberError] " + functionName + " expects " + to_string(minNum) + " or " +
+                         to_string(maxNum) + " arguments, " + to_string(actualNum) + be + "given";
+        return message;
+    }
+
     string createArgumentTypeErrorMessage(string functionName, string whichArgument, string expectedType,
                                           string actualType) {
         string message =
@@ -167,22 +185,27 @@ namespace utils {
     }
 
     void raiseError(AST &ast, Handle handle, string message, string prefixTitle) {
-        string prefix = utils::generatePrefix(prefixTitle);
-        string postfix = utils::generatePostfix(prefix.size());
+        if (utils::isPrintingErrors) {
+            string prefix = utils::generatePrefix(prefixTitle);
+            string postfix = utils::generatePostfix(prefix.size());
 
-        cout << prefix << endl;
-        utils::coutContext(ast, handle, message);
-        cout << postfix;
-        throw std::runtime_error("");
+            cout << prefix << endl;
+            utils::coutContext(ast, handle, message);
+            cout << postfix;
+        }
+        throw ScriptError(message + ", happened in " + ast.sourceCodeMapper.getModuleName(handle) + " " +
+                          ast.sourceCodeMapper.getPath(handle));
     }
 
     void raiseError(string message, string prefixTitle) {
-        string prefix = utils::generatePrefix(prefixTitle);
-        string postfix = utils::generatePostfix(prefix.size());
-        cout << prefix << endl;
-        cout << "Description: " + message << endl;
-        cout << postfix;
-        throw std::runtime_error("");
+        if (utils::isPrintingErrors) {
+            string prefix = utils::generatePrefix(prefixTitle);
+            string postfix = utils::generatePostfix(prefix.size());
+            cout << prefix << endl;
+            cout << "Description: " + message << endl;
+            cout << postfix;
+        }
+        throw ScriptError(message);
     }
 
     string getActualTypeStr(AST &ast, HandleOrStr hos) {
@@ -241,6 +264,15 @@ namespace utils {
         double absolute = abs( trouble );
         return absolute == floor(absolute);
     }
+
+    // integers print without a fraction, the way the runtime writes numbers
+    string doubleToStr(double trouble) {
+        if (double_is_int(trouble) && std::fabs(trouble) < 1e18) {
+            return to_string((long long) trouble);
+        } else {
+            return to_string(trouble);
+        }
+    }
 }
 
 #endif //TYPED_SCHEME_UTILS_HPP
@@ -0,0 +1,11 @@
+;; should stop with a ResourceLimitError and exit with 1
+;; IRISMAXHEAPBYTES=100000 ./iris test/heap-limit.scm
+(define b (make-string-builder))
+(define s "0123456789012345678901234567890123456789012345678901234567890123456789")
+(define fill
+  (lambda (i)
+    (if (< i 100000)
+        (begin (string-builder-append! b s) (fill (+ i 1)))
+        i)))
+(fill 0)
+(display "not reached")
@@ -0,0 +1,70 @@
+//
+// a host program of libiris: loads Iris code, calls it, binds a native and bounds a call
+// exits with 1 at the first check that fails
+//
+
+#include "Iris.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int failures = 0;
+
+void check(bool isPassing, const std::string &what) {
+    if (!isPassing) {
+        std::cerr << "failed: " << what << std::endl;
+        failures += 1;
+    }
+}
+
+iris::Value area(const std::vector<iris::Value> &arguments) {
+    return arguments[0].asNumber() * arguments[1].asNumber();
+}
+
+int main() {
+    iris::bindNative("geometry.area", 2, area);
+
+    auto program = iris::Program::fromCode(R"(
+(native geometry)
+(define add (lambda (a b) (+ a b)))
+(define greet (lambda (name) (string-append "hi " name)))
+(define square-area (lambda (w) (geometry.area w w)))
+(define first (lambda (l) (car l)))
+(define forever (lambda (i) (forever (+ i 1))))
+)");
+
+    check(program.hasFunction("add"), "add is defined");
+    check(!program.hasFunction("nope"), "nope is not defined");
+
+    auto add = program.getFunction("add");
+    check(add({1, 2.5}).asNumber() == 3.5, "(add 1 2.5)");
+    check(program.call("add", {3, 4}).asNumber() == 7, "(add 3 4)");
+    check(program.call("greet", {"iris"}).asString() == "hi iris", "(greet \"iris\")");
+    check(program.call("square-area", {3}).asNumber() == 9, "(square-area 3) through a native");
+
+    auto list = program.call("first", {iris::Value(std::vector<iris::Value>{std::vector<iris::Value>{1, 2}, 3})});
+    check(list.asList().size() == 2 && list.asList()[1].asNumber() == 2, "(first ((1 2) 3))");
+
+    // an error of the Iris code is thrown with its description, and the program can still be called
+    try {
+        program.call("first", {5});
+        check(false, "(first 5) throws");
+    } catch (iris::Error &e) {
+        check(std::string(e.what()).find("car") != std::string::npos, "the error of (first 5) names car");
+    }
+    check(add({3, 4}).asNumber() == 7, "(add 3 4) after an error");
+
+    iris::Limits limits;
+    limits.maxInstructions = 5000;
+    program.setLimits(limits);
+    try {
+        program.call("forever", {0});
+        check(false, "(forever 0) is stopped");
+    } catch (iris::Error &e) {
+        check(std::string(e.what()).find("ResourceLimitError") != std::string::npos,
+              "(forever 0) is stopped by the limit");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,4 @@
+;; should stop with a ResourceLimitError and exit with 1
+;; IRISMAXINSTRUCTIONS=5000 ./iris test/instruction-limit.scm
+(define forever (lambda (i) (forever (+ i 1))))
+(forever 0)